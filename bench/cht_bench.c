@@ -0,0 +1,179 @@
+/*
+ * measures the throughput of a read mostly workload on a ConcurrentHashTable
+ * and on a HashTable behind a single mutex, from 1 to N threads.
+ *
+ * usage: cht_bench [max threads]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../src/concurrent_hashtable.h"
+#include "../src/hashtable.h"
+#include "../src/hashing.h"
+#include "../src/utils.h"
+
+#define N_KEYS 1000000
+#define N_OPS_PER_THREAD 2000000
+/* one in this many operations is a write */
+#define WRITE_RATIO 20
+#define DEFAULT_MAX_THREADS 32
+
+typedef struct BenchArgs BenchArgs;
+
+struct BenchArgs
+{
+    ConcurrentHashTable *cht;
+    HashTable *ht;
+    pthread_mutex_t *htLock;
+    uint64_t seed;
+    size_t found;
+};
+
+static volatile size_t sink;
+
+static uint64_t
+nextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static double
+getTime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *
+runConcurrent(void *arg)
+{
+    BenchArgs *args;
+    int readerID;
+    size_t key;
+    size_t value;
+
+    args = arg;
+    if ((readerID = registerReaderConcurrentHashTable(args->cht)) < 0)
+        die("registerReaderConcurrentHashTable() failed\n");
+    for (size_t i = 0; i < N_OPS_PER_THREAD; i++) {
+        key = nextRandom(&args->seed) % N_KEYS;
+        if (!(i % WRITE_RATIO)) {
+            if (putConcurrentHashTable(args->cht, (uint8_t *)&key,
+                sizeof(key), (uint8_t *)&key, sizeof(key)))
+                die("putConcurrentHashTable() failed\n");
+        } else if (!getConcurrentHashTable(args->cht, readerID,
+            (uint8_t *)&key, sizeof(key), &value, sizeof(value), NULL)) {
+            args->found += value == key;
+        }
+    }
+    unregisterReaderConcurrentHashTable(args->cht, readerID);
+    return NULL;
+}
+
+static void *
+runLocked(void *arg)
+{
+    BenchArgs *args;
+    size_t key;
+    int kvIndex;
+
+    args = arg;
+    for (size_t i = 0; i < N_OPS_PER_THREAD; i++) {
+        key = nextRandom(&args->seed) % N_KEYS;
+        pthread_mutex_lock(args->htLock);
+        if (!(i % WRITE_RATIO)) {
+            if (updateHashTable(args->ht, (uint8_t *)&key, sizeof(key),
+                (uint8_t *)&key, sizeof(key)) < 0)
+                die("updateHashTable() failed\n");
+        } else if ((kvIndex = getHashTable(args->ht, (uint8_t *)&key,
+            sizeof(key))) >= 0) {
+            args->found += *(size_t *)getValueByKVIndexHashTable(args->ht,
+                kvIndex) == key;
+        }
+        pthread_mutex_unlock(args->htLock);
+    }
+    return NULL;
+}
+
+static double
+runThreads(void *(*func)(void *), ConcurrentHashTable *cht, HashTable *ht,
+    pthread_mutex_t *htLock, int nThreads)
+{
+    pthread_t *threads;
+    BenchArgs *args;
+    double start;
+    double end;
+
+    threads = malloc(sizeof(pthread_t) * nThreads);
+    args = malloc(sizeof(BenchArgs) * nThreads);
+    if (!threads || !args)
+        die("malloc() failed\n");
+    start = getTime();
+    for (int i = 0; i < nThreads; i++) {
+        args[i] = (BenchArgs) {
+            .cht = cht,
+            .ht = ht,
+            .htLock = htLock,
+            .seed = 88172645463325252u + i,
+            .found = 0,
+        };
+        if (pthread_create(&threads[i], NULL, func, &args[i]))
+            die("pthread_create() failed\n");
+    }
+    for (int i = 0; i < nThreads; i++) {
+        pthread_join(threads[i], NULL);
+        sink += args[i].found;
+    }
+    end = getTime();
+    free(threads);
+    free(args);
+    return (double)N_OPS_PER_THREAD * nThreads / (end - start) * 1e-6;
+}
+
+int
+main(int argc, char **argv)
+{
+    int maxThreads;
+    ConcurrentHashTable *cht;
+    HashTable *ht;
+    pthread_mutex_t htLock;
+
+    maxThreads = argc > 1 ? atoi(argv[1]) : DEFAULT_MAX_THREADS;
+    if (maxThreads <= 0)
+        die("usage: cht_bench [max threads]\n");
+    if (!(cht = newConcurrentHashTable(crc32, 6, maxThreads)))
+        die("newConcurrentHashTable() failed\n");
+    if (!(ht = newHashTableWithFlags(crc32, -1, 0.75,
+        HashTableFlags_openAddressing)))
+        die("newHashTableWithFlags() failed\n");
+    pthread_mutex_init(&htLock, NULL);
+    for (size_t i = 0; i < N_KEYS; i++) {
+        if (putConcurrentHashTable(cht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&i, sizeof(i))
+            || insertHashTable(ht, (uint8_t *)&i, sizeof(i), (uint8_t *)&i,
+            sizeof(i)) < 0)
+            die("filling the tables failed\n");
+    }
+    printf("%d%% writes, %d ops per thread\n", 100 / WRITE_RATIO,
+        N_OPS_PER_THREAD);
+    printf("%8s %22s %22s\n", "threads", "ConcurrentHashTable",
+        "HashTable + mutex");
+    for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+        printf("%8d %16.2f Mop/s %16.2f Mop/s\n", nThreads,
+            runThreads(runConcurrent, cht, NULL, NULL, nThreads),
+            runThreads(runLocked, NULL, ht, &htLock, nThreads));
+    }
+    pthread_mutex_destroy(&htLock);
+    deleteHashTable(ht);
+    deleteConcurrentHashTable(cht);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * measures the throughput of checksumming a file with the streaming CRC-32
+ * API, from 1 to N threads. Each thread checksums one contiguous piece of
+ * the file and the pieces are merged with crc32Combine().
+ * If no file is given, a temporary file of random bytes is checksummed.
+ *
+ * usage: crc_file_bench [file] [max threads]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../src/hashing.h"
+#include "../src/utils.h"
+
+#define BUFFER_SIZE ((size_t)1 << 20)
+#define TMP_FILE_SIZE ((off_t)1 << 28)
+#define DEFAULT_MAX_THREADS 8
+
+typedef struct BenchArgs BenchArgs;
+
+struct BenchArgs
+{
+    const char *path;
+    off_t offset;
+    off_t n;
+    uint32_t crc;
+};
+
+static double
+getTime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* checksums args->n bytes of the file starting at args->offset */
+static void *
+checksumPiece(void *arg)
+{
+    BenchArgs *args;
+    FILE *fp;
+    uint8_t *buf;
+    CRC32Context ctx;
+    size_t n;
+    off_t left;
+
+    args = arg;
+    if (!(buf = malloc(BUFFER_SIZE)))
+        die("malloc() failed\n");
+    if (!(fp = fopen(args->path, "rb"))
+        || fseeko(fp, args->offset, SEEK_SET))
+        die("could not open the file\n");
+    crc32Init(&ctx);
+    for (left = args->n; left > 0; left -= n) {
+        if (!(n = fread(buf, 1, MIN((off_t)BUFFER_SIZE, left), fp)))
+            die("fread() failed\n");
+        crc32Update(&ctx, buf, n);
+    }
+    args->crc = crc32Final(&ctx);
+    fclose(fp);
+    free(buf);
+    return NULL;
+}
+
+/* checksums the n byte long file at path using nThreads threads */
+static uint32_t
+checksumFile(const char *path, off_t n, int nThreads)
+{
+    pthread_t *threads;
+    BenchArgs *args;
+    off_t pieceSize;
+    uint32_t ret;
+
+    threads = malloc(sizeof(pthread_t) * nThreads);
+    args = malloc(sizeof(BenchArgs) * nThreads);
+    if (!threads || !args)
+        die("malloc() failed\n");
+    pieceSize = n / nThreads;
+    for (int i = 0; i < nThreads; i++) {
+        args[i] = (BenchArgs) {
+            .path = path,
+            .offset = pieceSize * i,
+            /* the last piece gets the remainder */
+            .n = i == nThreads - 1 ? n - pieceSize * i : pieceSize,
+        };
+        if (pthread_create(&threads[i], NULL, checksumPiece, &args[i]))
+            die("pthread_create() failed\n");
+    }
+    ret = 0;
+    for (int i = 0; i < nThreads; i++) {
+        pthread_join(threads[i], NULL);
+        ret = crc32Combine(ret, args[i].crc, args[i].n);
+    }
+    free(threads);
+    free(args);
+    return ret;
+}
+
+/* writes TMP_FILE_SIZE random bytes to a new file and returns its path */
+static const char *
+makeTmpFile()
+{
+    static char path[] = "crc_file_bench.tmp";
+    FILE *fp;
+    uint8_t *buf;
+    uint64_t state;
+
+    if (!(buf = malloc(BUFFER_SIZE)) || !(fp = fopen(path, "wb")))
+        die("could not make the temporary file\n");
+    state = 88172645463325252u;
+    for (off_t i = 0; i < TMP_FILE_SIZE; i += BUFFER_SIZE) {
+        for (size_t j = 0; j < BUFFER_SIZE; j++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            buf[j] = state;
+        }
+        if (fwrite(buf, 1, BUFFER_SIZE, fp) != BUFFER_SIZE)
+            die("fwrite() failed\n");
+    }
+    fclose(fp);
+    free(buf);
+    return path;
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *path;
+    int maxThreads;
+    FILE *fp;
+    off_t n;
+    uint32_t expected;
+    uint32_t crc;
+    double start;
+    double time;
+
+    path = argc > 1 ? argv[1] : makeTmpFile();
+    maxThreads = argc > 2 ? atoi(argv[2]) : DEFAULT_MAX_THREADS;
+    if (maxThreads <= 0)
+        die("usage: crc_file_bench [file] [max threads]\n");
+    if (!(fp = fopen(path, "rb")) || fseeko(fp, 0, SEEK_END))
+        die("could not open the file\n");
+    if ((n = ftello(fp)) < 0)
+        die("ftello() failed\n");
+    fclose(fp);
+    printf("%lld bytes\n%8s %12s %10s\n", (long long)n, "threads", "crc32",
+        "GB/s");
+    expected = 0;
+    for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+        start = getTime();
+        crc = checksumFile(path, n, nThreads);
+        time = getTime() - start;
+        if (nThreads == 1)
+            expected = crc;
+        else if (crc != expected)
+            die("the combined crc32 does not match\n");
+        printf("%8d     %08x %10.2f\n", nThreads, crc, n / time * 1e-9);
+    }
+    if (argc <= 1)
+        remove(path);
+    return 0;
+}
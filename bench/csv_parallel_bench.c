@@ -0,0 +1,136 @@
+/*
+ * measures the throughput of splitting csv text into rows with
+ * newCSVRows(), from 1 to N threads, and of the streaming CSVParser.
+ * If no file is given, csv text with random plain and quoted fields is
+ * generated.
+ *
+ * usage: csv_parallel_bench [file] [max threads]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/csv.h"
+#include "../src/utils.h"
+
+#define N_BYTES ((size_t)1 << 28)
+#define DEFAULT_MAX_THREADS 8
+/* the longest generated field */
+#define MAX_FIELD_SIZE 16
+
+static size_t nStreamedFields;
+
+static double
+getTime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int
+onField(void *ctx, const char *field, size_t n)
+{
+    (void)ctx;
+    (void)field;
+    (void)n;
+    nStreamedFields++;
+    return 0;
+}
+
+/*
+ * comma separated fields of letters with a newline every 8 fields, where
+ * every 16th field is quoted and has a comma, an escaped quote or a newline
+ */
+static char *
+makeText(size_t n)
+{
+    char *ret;
+    uint64_t state;
+    size_t fieldSize;
+    size_t i;
+
+    if (!(ret = malloc(n)))
+        die("malloc() failed\n");
+    state = 88172645463325252u;
+    i = 0;
+    for (size_t field = 0; i + MAX_FIELD_SIZE + 4 < n; field++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        fieldSize = state % MAX_FIELD_SIZE;
+        if (field % 16 == 5) {
+            ret[i++] = '"';
+            for (size_t j = 0; j < fieldSize; j++, i++)
+                ret[i] = 'a' + (state >> (j + 8)) % 26;
+            if (field % 3 == 1)
+                ret[i++] = '"';
+            ret[i++] = ",\"\n"[field % 3];
+            ret[i++] = '"';
+        } else {
+            for (size_t j = 0; j < fieldSize; j++, i++)
+                ret[i] = 'a' + (state >> (j + 8)) % 26;
+        }
+        ret[i++] = field % 8 == 7 ? '\n' : ',';
+    }
+    memset(ret + i, 'z', n - i);
+    return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+    MappedFile *file;
+    char *text;
+    CSVRows *rows;
+    CSVParser *parser;
+    int maxThreads;
+    size_t n;
+    size_t nFields;
+    double start;
+    double time;
+
+    file = NULL;
+    if (argc > 1) {
+        if (!(file = mapFile(argv[1], MapFileFlags_sequential)))
+            die("could not read the file\n");
+        text = (char *)file->data;
+        n = file->size;
+    } else {
+        n = N_BYTES;
+        text = makeText(n);
+    }
+    maxThreads = argc > 2 ? atoi(argv[2]) : DEFAULT_MAX_THREADS;
+    if (maxThreads <= 0)
+        die("usage: csv_parallel_bench [file] [max threads]\n");
+    if (!(parser = newCSVParser(',', 0, onField, NULL, NULL)))
+        die("newCSVParser() failed\n");
+    start = getTime();
+    if (feedCSVParser(parser, text, n) || finishCSVParser(parser))
+        die("the text is not valid csv\n");
+    time = getTime() - start;
+    printf("%zu bytes, %zu rows, %zu fields\n%8s %10s\n", n,
+        getRowCountCSVParser(parser), nStreamedFields, "threads", "GB/s");
+    printf("%8s %10.2f\n", "stream", n / time * 1e-9);
+    deleteCSVParser(parser);
+    for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+        start = getTime();
+        if (!(rows = newCSVRows(text, n, ',', nThreads)))
+            die("newCSVRows() failed\n");
+        time = getTime() - start;
+        nFields = getCountArray(rows->fields);
+        if (nFields != nStreamedFields)
+            die("the field count does not match the streaming parser\n");
+        printf("%8d %10.2f\n", nThreads, n / time * 1e-9);
+        deleteCSVRows(rows);
+    }
+    if (file)
+        unmapFile(file);
+    else
+        free(text);
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * formats numbers into a StringBuilder: by snprintf()ing each number to
+ * the stack and pushing the string, and with stringBuilderPushInt() and
+ * stringBuilderPushDouble(), for a column of ints, of prices (2 decimals)
+ * and of ratios (which need 17 digits). Then builds rows of all of them
+ * with one snprintf() or one stringBuilderPushFmt() per row.
+ *
+ * usage: format_bench
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/string_builder.h"
+#include "../src/utils.h"
+
+#define N_ROWS 1000000
+
+typedef struct Row Row;
+
+struct Row
+{
+    int64_t id;
+    int64_t count;
+    double mean;
+    double ratio;
+};
+
+static double
+msSince(clock_t start)
+{
+    return (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+static void
+report(const char *name, clock_t start, StringBuilder *sb)
+{
+    fprintf(stderr, "%-30s %8.2f ms (%ld bytes)\n", name, msSince(start),
+        stringBuilderGetSize(sb));
+    deleteStringBuilder(sb);
+}
+
+static StringBuilder *
+newSB()
+{
+    StringBuilder *ret;
+
+    if (!(ret = newStringBuilder()))
+        die("newStringBuilder() failed\n");
+    return ret;
+}
+
+int
+main(void)
+{
+    StringBuilder *sb;
+    Row *rows;
+    char buffer[128];
+    uint64_t state;
+    clock_t start;
+
+    if (!(rows = malloc(N_ROWS * sizeof(Row))))
+        die("malloc() failed\n");
+    state = 88172645463325252u;
+    for (size_t i = 0; i < N_ROWS; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        rows[i] = (Row) {
+            .id = i,
+            .count = state % 100000,
+            /* prices, and ratios that need all 17 digits */
+            .mean = (double)(state >> 40 & 0xfffff) / 100,
+            .ratio = (double)(state >> 11) / (1ull << 53),
+        };
+    }
+
+    /* each kind of number, in a column of its own */
+    sb = newSB();
+    start = clock();
+    for (size_t i = 0; i < N_ROWS; i++) {
+        snprintf(buffer, sizeof(buffer), "%lld", (long long)rows[i].count);
+        stringBuilderPushStr(sb, buffer);
+        stringBuilderPushChar(sb, '\n');
+    }
+    report("ints, snprintf + PushStr:", start, sb);
+    sb = newSB();
+    start = clock();
+    for (size_t i = 0; i < N_ROWS; i++) {
+        stringBuilderPushInt(sb, rows[i].count);
+        stringBuilderPushChar(sb, '\n');
+    }
+    report("ints, PushInt:", start, sb);
+    sb = newSB();
+    start = clock();
+    for (size_t i = 0; i < N_ROWS; i++) {
+        snprintf(buffer, sizeof(buffer), "%.15g", rows[i].mean);
+        stringBuilderPushStr(sb, buffer);
+        stringBuilderPushChar(sb, '\n');
+    }
+    report("prices, snprintf + PushStr:", start, sb);
+    sb = newSB();
+    start = clock();
+    for (size_t i = 0; i < N_ROWS; i++) {
+        stringBuilderPushDouble(sb, rows[i].mean);
+        stringBuilderPushChar(sb, '\n');
+    }
+    report("prices, PushDouble:", start, sb);
+    sb = newSB();
+    start = clock();
+    for (size_t i = 0; i < N_ROWS; i++) {
+        /* the shortest of %.15g, %.16g and %.17g that round trips */
+        for (int precision = 15; precision <= 17; precision++) {
+            snprintf(buffer, sizeof(buffer), "%.*g", precision,
+                rows[i].ratio);
+            if (strtod(buffer, NULL) == rows[i].ratio)
+                break;
+        }
+        stringBuilderPushStr(sb, buffer);
+        stringBuilderPushChar(sb, '\n');
+    }
+    report("ratios, snprintf + PushStr:", start, sb);
+    sb = newSB();
+    start = clock();
+    for (size_t i = 0; i < N_ROWS; i++) {
+        stringBuilderPushDouble(sb, rows[i].ratio);
+        stringBuilderPushChar(sb, '\n');
+    }
+    report("ratios, PushDouble:", start, sb);
+
+    /* whole rows */
+    sb = newSB();
+    start = clock();
+    for (size_t i = 0; i < N_ROWS; i++) {
+        snprintf(buffer, sizeof(buffer), "%lld,n=%lld,mean=%.17g,r=%.17g\n",
+            (long long)rows[i].id, (long long)rows[i].count, rows[i].mean,
+            rows[i].ratio);
+        stringBuilderPushStr(sb, buffer);
+    }
+    report("snprintf row + PushStr:", start, sb);
+
+    sb = newSB();
+    start = clock();
+    for (size_t i = 0; i < N_ROWS; i++) {
+        stringBuilderPushFmt(sb, "%lld,n=%lld,mean=%.17g,r=%.17g\n",
+            (long long)rows[i].id, (long long)rows[i].count, rows[i].mean,
+            rows[i].ratio);
+    }
+    report("PushFmt row:", start, sb);
+
+    free(rows);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * compares inserting and removing short strings near a moving cursor (like
+ * typing in an editor) in a VLArray and in a GapVLArray.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/gap_vlarray.h"
+#include "../src/vlarray.h"
+#include "../src/utils.h"
+
+#define N_EDITS 100000
+/* every this many edits, the cursor jumps to a random index */
+#define JUMP_PERIOD 1000
+
+/*
+ * returns the index of the next edit: next to the last one, or a random
+ * index every JUMP_PERIOD edits
+ */
+static size_t
+nextIndex(size_t i, size_t last, size_t count)
+{
+    if (i % JUMP_PERIOD == 0)
+        return rand() % (count + 1);
+    return MIN(last + 1, count);
+}
+
+static void
+runVLArray(void)
+{
+    VLArray *arr;
+    clock_t start;
+    size_t index;
+
+    if (!(arr = newVLArrayPacked(-1, -1, 1)))
+        die("newVLArrayPacked() failed\n");
+    srand(1);
+    index = 0;
+    start = clock();
+    for (size_t i = 0; i < N_EDITS; i++) {
+        index = nextIndex(i, index, getCountVLArray(arr));
+        if (i % 4 == 3 && index < getCountVLArray(arr))
+            removeAtVLArray(arr, NULL, index);
+        else if (!(arr = insertVLArray(arr, "word ", 5, index)))
+            die("insertVLArray() failed\n");
+    }
+    printf("%-12s %10.2f ms\n", "VLArray",
+        (double)(clock() - start) * 1e3 / CLOCKS_PER_SEC);
+    deleteVLArray(arr);
+}
+
+static void
+runGapVLArray(void)
+{
+    GapVLArray *arr;
+    clock_t start;
+    size_t index;
+
+    if (!(arr = newGapVLArray(-1, -1)))
+        die("newGapVLArray() failed\n");
+    srand(1);
+    index = 0;
+    start = clock();
+    for (size_t i = 0; i < N_EDITS; i++) {
+        index = nextIndex(i, index, getCountGapVLArray(arr));
+        if (i % 4 == 3 && index < getCountGapVLArray(arr))
+            removeAtGapVLArray(arr, NULL, index);
+        else if (insertGapVLArray(arr, "word ", 5, index))
+            die("insertGapVLArray() failed\n");
+    }
+    printf("%-12s %10.2f ms\n", "GapVLArray",
+        (double)(clock() - start) * 1e3 / CLOCKS_PER_SEC);
+    deleteGapVLArray(arr);
+}
+
+int
+main(void)
+{
+    runVLArray();
+    runGapVLArray();
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * measures the throughput of the hash functions in hashing.c for short
+ * (hash table key sized) and long inputs.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "../src/hashing.h"
+#include "../src/utils.h"
+
+#define N_BYTES ((size_t)1 << 26)
+
+typedef uint32_t (*HashFunc)(const uint8_t *data, size_t n);
+
+static volatile uint32_t sink;
+
+/* the byte at a time CRC-32 that crc32() used to be */
+static uint32_t
+crc32Bytewise(const uint8_t *data, size_t n)
+{
+    static uint32_t table[256];
+    uint32_t ret;
+
+    if (!table[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            ret = i;
+            for (int j = 0; j < 8; j++)
+                ret = ret & 1 ? (ret >> 1) ^ 0xedb88320u : ret >> 1;
+            table[i] = ret;
+        }
+    }
+    ret = ~(uint32_t)0;
+    for (size_t i = 0; i < n; i++)
+        ret = (ret >> 8) ^ table[(ret ^ data[i]) & 0xff];
+    return ~ret;
+}
+
+/* mixHash64() with a fixed seed, folded to 32 bits like mixHash() */
+static uint32_t
+mixHash64Seeded(const uint8_t *data, size_t n)
+{
+    uint64_t ret;
+
+    ret = mixHash64(data, n, 0x9e3779b97f4a7c15u);
+    return ret ^ ret >> 32;
+}
+
+static void
+hashChunks(HashFunc hashFunc, const uint8_t *data, size_t chunkSize)
+{
+    uint32_t sum;
+
+    sum = 0;
+    for (size_t i = 0; i + chunkSize <= N_BYTES; i += chunkSize)
+        sum += hashFunc(data + i, chunkSize);
+    sink = sum;
+}
+
+static void
+runBench(const char *name, HashFunc hashFunc, const uint8_t *data)
+{
+    static const size_t chunkSizes[] = { 8, 32, 256, 4096, N_BYTES };
+    double time;
+
+    printf("%-16s", name);
+    for (size_t i = 0; i < LEN(chunkSizes); i++) {
+        getExecTime(hashChunks(hashFunc, data, chunkSizes[i]), &time);
+        printf(" %8.2f", N_BYTES / time * 1e-9);
+    }
+    printf("\n");
+}
+
+int
+main(void)
+{
+    uint8_t *data;
+
+    if (!(data = malloc(N_BYTES)))
+        die("malloc() failed\n");
+    for (size_t i = 0; i < N_BYTES; i++)
+        data[i] = i * 2654435761u >> 24;
+    printf("GB/s by input size\n%-16s %8s %8s %8s %8s %8s\n", "", "8", "32",
+        "256", "4096", "64M");
+    runBench("crc32 bytewise", crc32Bytewise, data);
+    runBench("crc32", crc32, data);
+    runBench("crc32c portable", crc32cPortable, data);
+    runBench("crc32c", crc32c, data);
+    runBench("mixHash", mixHash, data);
+    runBench("mixHash64", mixHash64Seeded, data);
+    free(data);
+    return 0;
+}
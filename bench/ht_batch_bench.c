@@ -0,0 +1,105 @@
+/*
+ * compares a loop of getHashTable() calls with getManyHashTable() on tables
+ * that are larger than the last level cache.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "../src/hashtable.h"
+#include "../src/hashing.h"
+#include "../src/utils.h"
+
+#define N_KEYS 2000000
+#define N_PROBES 4000000
+
+static volatile size_t sink;
+
+static HashTable *
+fillHashTable(int flags, size_t n)
+{
+    HashTable *ht;
+
+    if (!(ht = newHashTableWithFlags(crc32, -1, 0.75, flags)))
+        die("newHashTableWithFlags() failed\n");
+    for (size_t i = 0; i < n; i++) {
+        if (insertHashTable(ht, (uint8_t *)&i, sizeof(i), (uint8_t *)&i,
+            sizeof(i)) < 0)
+            die("insertHashTable() failed\n");
+    }
+    return ht;
+}
+
+static void
+benchSingle(const HashTable *ht, const uint8_t *const *keys,
+    const size_t *nKeys, int *kvIndexes, size_t n)
+{
+    size_t found;
+
+    found = 0;
+    for (size_t i = 0; i < n; i++) {
+        kvIndexes[i] = getHashTable(ht, keys[i], nKeys[i]);
+        found += kvIndexes[i] >= 0;
+    }
+    sink = found;
+}
+
+static void
+benchMany(const HashTable *ht, const uint8_t *const *keys,
+    const size_t *nKeys, int *kvIndexes, size_t n)
+{
+    sink = getManyHashTable(ht, keys, nKeys, n, kvIndexes);
+}
+
+static void
+runBench(const char *name, int flags, const uint8_t *const *keys,
+    const size_t *nKeys, int *kvIndexes)
+{
+    HashTable *ht;
+    double singleTime;
+    double manyTime;
+
+    ht = fillHashTable(flags, N_KEYS);
+    getExecTime(benchSingle(ht, keys, nKeys, kvIndexes, N_PROBES),
+        &singleTime);
+    getExecTime(benchMany(ht, keys, nKeys, kvIndexes, N_PROBES), &manyTime);
+    printf("%-18s getHashTable %7.2f ns/key  getManyHashTable %7.2f ns/key"
+        "  speedup %.2fx\n", name, singleTime * 1e9 / N_PROBES,
+        manyTime * 1e9 / N_PROBES, singleTime / manyTime);
+    deleteHashTable(ht);
+}
+
+int
+main(void)
+{
+    size_t *keys;
+    const uint8_t **keyPtrs;
+    size_t *nKeys;
+    int *kvIndexes;
+    uint64_t state;
+
+    keys = malloc(sizeof(size_t) * N_PROBES);
+    keyPtrs = malloc(sizeof(uint8_t *) * N_PROBES);
+    nKeys = malloc(sizeof(size_t) * N_PROBES);
+    kvIndexes = malloc(sizeof(int) * N_PROBES);
+    if (!keys || !keyPtrs || !nKeys || !kvIndexes)
+        die("malloc() failed\n");
+    /* random probes, so consecutive keys do not share cache lines */
+    state = 88172645463325252u;
+    for (size_t i = 0; i < N_PROBES; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        keys[i] = state % N_KEYS;
+        keyPtrs[i] = (const uint8_t *)&keys[i];
+        nKeys[i] = sizeof(keys[i]);
+    }
+    runBench("chained", HashTableFlags_pow2Buckets, keyPtrs, nKeys,
+        kvIndexes);
+    runBench("open addressing", HashTableFlags_openAddressing, keyPtrs, nKeys,
+        kvIndexes);
+    free(keys);
+    free(keyPtrs);
+    free(nKeys);
+    free(kvIndexes);
+    return 0;
+}
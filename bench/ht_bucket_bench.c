@@ -0,0 +1,89 @@
+/*
+ * compares HASH % bucketCount bucket selection with the fibonacci
+ * multiply-shift used by HashTableFlags_pow2Buckets.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "../src/hashtable.h"
+#include "../src/hashing.h"
+#include "../src/utils.h"
+
+#define N_KEYS 1000000
+#define N_ROUNDS 20
+
+static volatile size_t sink;
+
+static void
+benchBucketIDs(const HashTable *ht, const uint32_t *hashes, size_t n)
+{
+    size_t sum;
+
+    sum = 0;
+    for (size_t r = 0; r < N_ROUNDS; r++)
+        for (size_t i = 0; i < n; i++)
+            sum += getBucketIDHashTable(ht, hashes[i]);
+    sink = sum;
+}
+
+static void
+benchLookups(const HashTable *ht, size_t n)
+{
+    size_t sum;
+
+    sum = 0;
+    for (size_t i = 0; i < n; i++)
+        sum += getHashTable(ht, (uint8_t *)&i, sizeof(i));
+    sink = sum;
+}
+
+static HashTable *
+fillHashTable(int flags, size_t n)
+{
+    HashTable *ht;
+
+    if (!(ht = newHashTableWithFlags(crc32, -1, 0.75, flags)))
+        die("newHashTableWithFlags() failed\n");
+    for (size_t i = 0; i < n; i++) {
+        if (insertHashTable(ht, (uint8_t *)&i, sizeof(i), (uint8_t *)&i,
+            sizeof(i)) < 0)
+            die("insertHashTable() failed\n");
+    }
+    return ht;
+}
+
+static void
+runBench(const char *name, int flags, const uint32_t *hashes)
+{
+    HashTable *ht;
+    double fillTime;
+    double selectTime;
+    double lookupTime;
+
+    getExecTime(ht = fillHashTable(flags, N_KEYS), &fillTime);
+    getExecTime(benchBucketIDs(ht, hashes, N_KEYS), &selectTime);
+    getExecTime(benchLookups(ht, N_KEYS), &lookupTime);
+    printf("%-18s buckets %9zu  insert %7.2f ns/key  select %5.2f ns/hash"
+        "  lookup %7.2f ns/key\n", name,
+        isOpenAddressingHashTable(ht) ? getSlotCountHashTable(ht)
+        : getBucketCountHashTable(ht),
+        fillTime * 1e9 / N_KEYS, selectTime * 1e9 / (N_KEYS * N_ROUNDS),
+        lookupTime * 1e9 / N_KEYS);
+    deleteHashTable(ht);
+}
+
+int
+main(void)
+{
+    uint32_t *hashes;
+
+    if (!(hashes = malloc(sizeof(uint32_t) * N_KEYS)))
+        die("malloc() failed\n");
+    for (size_t i = 0; i < N_KEYS; i++)
+        hashes[i] = crc32((uint8_t *)&i, sizeof(i));
+    runBench("modulo", HashTableFlags_none, hashes);
+    runBench("pow2 fibonacci", HashTableFlags_pow2Buckets, hashes);
+    runBench("open addressing", HashTableFlags_openAddressing, hashes);
+    free(hashes);
+    return 0;
+}
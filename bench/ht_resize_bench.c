@@ -0,0 +1,49 @@
+/*
+ * compares the worst case latency of insertHashTable() for stop the world
+ * and incremental resizing.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/hashtable.h"
+#include "../src/hashing.h"
+#include "../src/utils.h"
+
+#define N_KEYS 1000000
+
+static void
+runBench(const char *name, int flags)
+{
+    HashTable *ht;
+    clock_t start;
+    clock_t end;
+    clock_t worst;
+    double total;
+
+    if (!(ht = newHashTableWithFlags(crc32, -1, 0.75, flags)))
+        die("newHashTableWithFlags() failed\n");
+    worst = 0;
+    total = 0;
+    for (size_t i = 0; i < N_KEYS; i++) {
+        start = clock();
+        if (insertHashTable(ht, (uint8_t *)&i, sizeof(i), (uint8_t *)&i,
+            sizeof(i)) < 0)
+            die("insertHashTable() failed\n");
+        end = clock();
+        worst = MAX(worst, end - start);
+        total += end - start;
+    }
+    printf("%-28s total %8.2f ms  worst insert %8.3f ms\n", name,
+        total * 1e3 / CLOCKS_PER_SEC, (double)worst * 1e3 / CLOCKS_PER_SEC);
+    deleteHashTable(ht);
+}
+
+int
+main(void)
+{
+    runBench("stop the world", HashTableFlags_pow2Buckets);
+    runBench("incremental", HashTableFlags_pow2Buckets
+        | HashTableFlags_incrementalResize);
+    return 0;
+}
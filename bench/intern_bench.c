@@ -0,0 +1,110 @@
+/*
+ * interns every whitespace separated token of a log and reports the memory
+ * that interning saves over storing every token (in a packed VLArray).
+ * If no file is given, an access log with a few hosts, paths, methods and
+ * status codes is generated.
+ *
+ * usage: intern_bench [file]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/intern_pool.h"
+#include "../src/utils.h"
+
+#define N_LINES 1000000
+
+static const char *methods[] = { "GET", "GET", "GET", "POST", "PUT" };
+static const char *paths[] = {
+    "/", "/index.html", "/api/v1/users", "/api/v1/orders", "/static/app.js",
+    "/static/style.css", "/favicon.ico", "/login",
+};
+static const char *statuses[] = { "200", "200", "200", "304", "404", "500" };
+
+/* lines like "10.0.3.17 - - GET /login HTTP/1.1 200 5120\n" */
+static char *
+makeLog(size_t *outN)
+{
+    char *ret;
+    size_t n;
+    uint64_t state;
+
+    if (!(ret = malloc((size_t)N_LINES * 80)))
+        die("malloc() failed\n");
+    state = 88172645463325252u;
+    n = 0;
+    for (size_t i = 0; i < N_LINES; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        n += sprintf(ret + n, "10.0.%d.%d - - %s %s HTTP/1.1 %s %d\n",
+            (int)(state % 4), (int)(state >> 8 & 63),
+            methods[state >> 16 & 3], paths[(state >> 20) % LEN(paths)],
+            statuses[(state >> 24) % LEN(statuses)],
+            (int)(state >> 32 & 1023) * 16);
+    }
+    *outN = n;
+    return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+    MappedFile *file;
+    InternPool *pool;
+    const char *text;
+    char *generated;
+    size_t n;
+    size_t nTokens;
+    size_t tokenStart;
+    size_t copyBytes;
+    size_t idBytes;
+    clock_t start;
+
+    file = NULL;
+    generated = NULL;
+    if (argc > 1) {
+        if (!(file = mapFile(argv[1], MapFileFlags_sequential)))
+            die("could not read the file\n");
+        text = file->data;
+        n = file->size;
+    } else {
+        text = generated = makeLog(&n);
+    }
+    if (!(pool = newInternPool(-1)))
+        die("newInternPool() failed\n");
+    nTokens = 0;
+    tokenStart = 0;
+    start = clock();
+    for (size_t i = 0; i <= n; i++) {
+        if (i < n && text[i] != ' ' && text[i] != '\n' && text[i] != '\t')
+            continue;
+        if (i > tokenStart) {
+            if (internStr(pool, text + tokenStart, i - tokenStart) < 0)
+                die("internStr() failed\n");
+            nTokens++;
+        }
+        tokenStart = i + 1;
+    }
+    /* a packed VLArray with a copy of every token */
+    copyBytes = pool->internedBytes + nTokens * sizeof(VLArrayEntry);
+    printf("%zu bytes, %zu tokens, %zu distinct, %.2f ms\n", n, nTokens,
+        (size_t)getCountInternPool(pool),
+        (double)(clock() - start) * 1e3 / CLOCKS_PER_SEC);
+    idBytes = nTokens * sizeof(uint32_t);
+    printf("%-16s %12zu\n", "token bytes", pool->internedBytes);
+    printf("%-16s %12zu\n", "distinct bytes",
+        getSizeVLArray(pool->strs->keys));
+    printf("%-16s %12zu\n", "copied", copyBytes);
+    printf("%-16s %12zu (pool) + %zu (ids)\n", "interned",
+        getUsedBytesInternPool(pool), idBytes);
+    printf("%-16s %11.1f%%\n", "saved", 100.0 * (1.0
+        - (double)(getUsedBytesInternPool(pool) + idBytes) / copyBytes));
+    deleteInternPool(pool);
+    if (file)
+        unmapFile(file);
+    free(generated);
+    return 0;
+}
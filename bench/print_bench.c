@@ -0,0 +1,90 @@
+/*
+ * prints a string built from a million short pieces to stdout: one stdio
+ * call per piece (as the print functions used to), and through an IOSink
+ * (for a StringBuilder and a LWStringBuilder). Reports the time of each,
+ * and the number of writes that the sinks made.
+ *
+ * usage: print_bench > /dev/null (or a file)
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/string_builder.h"
+#include "../src/lw_string_builder.h"
+#include "../src/utils.h"
+
+#define N_PIECES 1000000
+
+static const char *words[] = {
+    "GET", "POST", "/", "/index.html", "/api/v1/users", "200", "404", " ",
+    "\n", ",", "10.0.0.1", "-", "HTTP/1.1",
+};
+
+static double
+msSince(clock_t start)
+{
+    return (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+int
+main(void)
+{
+    StringBuilder *sb;
+    LWStringBuilder *lwsb;
+    IOSink *sink;
+    const char **pieces;
+    uint64_t state;
+    clock_t start;
+
+    if (!(pieces = malloc(N_PIECES * sizeof(char *))))
+        die("malloc() failed\n");
+    if (!(sb = newStringBuilder()) || !(lwsb = newLWStringBuilder()))
+        die("constructor failed\n");
+    state = 88172645463325252u;
+    for (size_t i = 0; i < N_PIECES; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        pieces[i] = words[state % LEN(words)];
+        if (stringBuilderPushStr(sb, pieces[i])
+            || LWStringBuilderPushStr(lwsb, pieces[i]))
+            die("push failed\n");
+    }
+
+    start = clock();
+    for (size_t i = 0; i < N_PIECES; i++)
+        printf("%s", pieces[i]);
+    fflush(stdout);
+    fprintf(stderr, "printf per piece:             %8.2f ms\n",
+        msSince(start));
+
+    start = clock();
+    if (!(sink = newFILEIOSink(stdout)) || LWStringBuilderWriteSink(lwsb, sink)
+        || flushIOSink(sink))
+        die("LWStringBuilderWriteSink() failed\n");
+    fprintf(stderr, "LWStringBuilder, IOSink:      %8.2f ms, %ld writes\n",
+        msSince(start), sink->nWrites);
+    deleteIOSink(sink);
+
+    start = clock();
+    if (!(sink = newFILEIOSink(stdout)) || stringBuilderWriteSink(sb, sink)
+        || flushIOSink(sink))
+        die("stringBuilderWriteSink() failed\n");
+    fprintf(stderr, "StringBuilder, IOSink:        %8.2f ms, %ld writes\n",
+        msSince(start), sink->nWrites);
+    deleteIOSink(sink);
+
+    start = clock();
+    LWStringBuilderPrintInplace(lwsb);
+    fflush(stdout);
+    fprintf(stderr, "LWStringBuilderPrintInplace:  %8.2f ms\n",
+        msSince(start));
+
+    fprintf(stderr, "(%ld bytes printed by each)\n",
+        LWStringBuilderGetSize(lwsb));
+    deleteLWStringBuilder(lwsb);
+    deleteStringBuilder(sb);
+    free(pieces);
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * measures the throughput of counting commas and of splitting csv text into
+ * spans, byte at a time and with the SIMD kernels of scan.h.
+ * If no file is given, csv text with random fields is generated.
+ *
+ * usage: scan_bench [file]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/csv.h"
+#include "../src/scan.h"
+#include "../src/utils.h"
+
+#define N_BYTES ((size_t)1 << 28)
+/* the longest generated field */
+#define MAX_FIELD_SIZE 16
+
+static volatile size_t sink;
+
+/* the byte at a time charCount() */
+static size_t
+charCountBytewise(const char *src, size_t n, char b)
+{
+    size_t ret;
+
+    ret = 0;
+    for (size_t i = 0; i < n; i++)
+        ret += src[i] == b;
+    return ret;
+}
+
+/* the byte at a time field loop of the old newCSVRaw() */
+static Array *
+newCSVSpansBytewise(const char *csvtext, size_t n)
+{
+    Array *ret;
+    size_t start;
+
+    if (!(ret = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1, 64,
+        sizeof(CSVSpan), 0)))
+        die("newArrayWithPolicy() failed\n");
+    start = 0;
+    for (size_t i = 0; i <= n; i++) {
+        if (i < n && csvtext[i] != ',')
+            continue;
+        if (!tryPushArray(&ret, &(CSVSpan) {
+            .offset = start,
+            .length = i - start,
+        }))
+            die("tryPushArray() failed\n");
+        start = i + 1;
+    }
+    return ret;
+}
+
+static void
+countCommas(size_t (*func)(const void *, size_t, char), const char *text,
+    size_t n)
+{
+    sink = func(text, n, ',');
+}
+
+static size_t
+countCommasBytewise(const void *src, size_t n, char b)
+{
+    return charCountBytewise(src, n, b);
+}
+
+static void
+splitText(Array *(*func)(const void *, size_t), const char *text, size_t n)
+{
+    Array *spans;
+
+    if (!(spans = func(text, n)))
+        die("splitting failed\n");
+    sink = getCountArray(spans);
+    deleteArray(spans);
+}
+
+static Array *
+splitBytewise(const void *text, size_t n)
+{
+    return newCSVSpansBytewise(text, n);
+}
+
+/* comma separated fields of letters, with a newline every 8 fields */
+static char *
+makeText(size_t n)
+{
+    char *ret;
+    uint64_t state;
+    size_t fieldSize;
+
+    if (!(ret = malloc(n)))
+        die("malloc() failed\n");
+    state = 88172645463325252u;
+    for (size_t i = 0, field = 0; i < n; field++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        fieldSize = state % MAX_FIELD_SIZE;
+        for (size_t j = 0; j < fieldSize && i < n; j++, i++)
+            ret[i] = 'a' + (state >> (j + 8)) % 26;
+        if (i < n)
+            ret[i++] = field % 8 == 7 ? '\n' : ',';
+    }
+    return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+    MappedFile *file;
+    char *text;
+    size_t n;
+    double time;
+
+    file = NULL;
+    if (argc > 1) {
+        if (!(file = mapFile(argv[1], MapFileFlags_sequential)))
+            die("could not read the file\n");
+        text = (char *)file->data;
+        n = file->size;
+    } else {
+        n = N_BYTES;
+        text = makeText(n);
+    }
+    printf("%zu bytes, %s kernel\n%-24s %8s\n", n, getKernelNameScan(), "",
+        "GB/s");
+    getExecTime(countCommas(countCommasBytewise, text, n), &time);
+    printf("%-24s %8.2f\n", "charCount bytewise", n / time * 1e-9);
+    getExecTime(countCommas(charCount, text, n), &time);
+    printf("%-24s %8.2f\n", "charCount", n / time * 1e-9);
+    getExecTime(splitText(splitBytewise, text, n), &time);
+    printf("%-24s %8.2f\n", "newCSVSpans bytewise", n / time * 1e-9);
+    getExecTime(splitText(newCSVSpans, text, n), &time);
+    printf("%-24s %8.2f\n", "newCSVSpans", n / time * 1e-9);
+    if (file)
+        unmapFile(file);
+    else
+        free(text);
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * compares the memory that short keys take in framed and packed VLArrays,
+ * and the time it takes to push them.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/vlarray.h"
+#include "../src/utils.h"
+
+#define N_KEYS 1000000
+/* keys are "k" followed by up to this many digits */
+#define MAX_KEY_DIGITS 12
+
+static void
+runBench(const char *name, VLArray *arr)
+{
+    char key[MAX_KEY_DIGITS + 2];
+    clock_t start;
+    size_t payload;
+    int n;
+
+    if (!arr)
+        die("could not make the VLArray\n");
+    start = clock();
+    for (size_t i = 0; i < N_KEYS; i++) {
+        n = sprintf(key, "k%zu", i * 7919 % ((size_t)1 << (i % 40)));
+        if (!tryPushVLArray(&arr, key, n))
+            die("pushVLArray() failed\n");
+    }
+    payload = getSizeVLArray(arr);
+    printf("%-12s %8.2f ms %12zu %12zu %12zu %8.2f\n", name,
+        (double)(clock() - start) * 1e3 / CLOCKS_PER_SEC, payload,
+        getUsedBytesVLArray(arr), getAllocatedBytesVLArray(arr),
+        (double)getUsedBytesVLArray(arr) / payload);
+    deleteVLArray(arr);
+}
+
+int
+main(void)
+{
+    printf("%-12s %11s %12s %12s %12s %8s\n", "layout", "push", "payload",
+        "used", "allocated", "used/payload");
+    runBench("frames 64", newVLArray(-1, -1, 64));
+    runBench("frames 16", newVLArray(-1, -1, 16));
+    runBench("packed 16", newVLArrayPacked(-1, -1, 16));
+    runBench("packed 8", newVLArrayPacked(-1, -1, 8));
+    runBench("packed 1", newVLArrayPacked(-1, -1, 1));
+    return 0;
+}
@@ -6,9 +6,11 @@
 #include <stdint.h>
 
 #include "array.h"
+#include "utils.h"
 
 #define DEFAULT_CAPACITY 32
 #define DEFAULT_BLOCK_SIZE 32
+#define DEFAULT_GROWTH_FACTOR 2.0f
 #define MAXWORD uint64_t
 
 /*
@@ -19,7 +21,7 @@
  * none
  *
  * EFFECTS
- * Constructs a new array.
+ * Constructs a new array that grows linearly.
  *
  * blockSize = the number of elements that will be added to the capacity when 
  * the array is resized.
@@ -37,6 +39,32 @@
  */
 Array *
 newArray(int blockSize, int capacity, size_t elementSize)
+{
+    return newArrayWithPolicy(ArrayGrowthPolicy_linear, blockSize, capacity,
+        elementSize, 0);
+}
+
+/*
+ * REQUIRES
+ * none
+ *
+ * MODIFIES
+ * none
+ *
+ * EFFECTS
+ * Constructs a new array that is resized according to policy.
+ *
+ * growthFactor = the capacity multiplier used by geometric arrays.
+ * if growthFactor <= 1, then the default growthFactor is used.
+ *
+ * (blockSize, capacity & elementSize) see newArray().
+ * geometric arrays grow by at least blockSize elements.
+ *
+ * returns null on error.
+ */
+Array *
+newArrayWithPolicy(ArrayGrowthPolicy policy, int blockSize, int capacity,
+    size_t elementSize, float growthFactor)
 {
     Array *ret;
     size_t vectorSize;
@@ -47,6 +75,7 @@ newArray(int blockSize, int capacity, size_t elementSize)
      */
     capacity = capacity < 0 ? DEFAULT_CAPACITY : capacity;
     blockSize = blockSize <= 0 ? DEFAULT_BLOCK_SIZE : blockSize;
+    growthFactor = growthFactor <= 1 ? DEFAULT_GROWTH_FACTOR : growthFactor;
     vectorSize = sizeof(Array) + elementSize * capacity;
     if (!(ret = malloc(vectorSize)))
         return NULL;
@@ -54,7 +83,36 @@ newArray(int blockSize, int capacity, size_t elementSize)
     ret->capacity = capacity;
     ret->blockSize = blockSize;
     ret->elementSize = elementSize;
+    ret->growthPolicy = policy;
+    ret->growthFactor = growthFactor;
+    ret->first = (uint8_t *)ret + sizeof(Array);
+    return ret;
+}
+
+/*
+ * REQUIRES
+ * array is valid
+ * capacity >= array.count
+ *
+ * MODIFIES
+ * array
+ *
+ * EFFECTS
+ * Reallocates array so that it can store capacity elements.
+ * See expandArray() for details about how the return value should be 
+ * handled.
+ * Returns NULL on error.
+ */
+static Array *
+resizeArray(Array *array, size_t capacity)
+{
+    Array *ret;
+
+    ret = realloc(array, sizeof(Array) + array->elementSize * capacity);
+    if (!ret)
+        return NULL;
     ret->first = (uint8_t *)ret + sizeof(Array);
+    ret->capacity = capacity;
     return ret;
 }
 
@@ -70,23 +128,17 @@ newArray(int blockSize, int capacity, size_t elementSize)
  * On success, this returns a pointer to the resized array. This value may 
  * differ from the array point argument, so the array pointer argument is not
  * valid after a successful call to this function.
+ * Fixed arrays are never resized.
  * Returns NULL on error.
  */
 Array *
 expandArray(Array *array, size_t blockCount)
 {
-    Array *ret;
-
-    if (!array->blockSize || !blockCount)
+    if (!array->blockSize || !blockCount
+        || array->growthPolicy == ArrayGrowthPolicy_fixed)
         return array;
-    ret = array;
-    ret = realloc(ret, sizeof(Array) + array->elementSize * (array->capacity 
-        + array->blockSize * blockCount));
-    if (!ret)
-        return NULL;
-    ret->first = (uint8_t *)ret + sizeof(Array);
-    ret->capacity += ret->blockSize * blockCount;
-    return ret;
+    return resizeArray(array, array->capacity 
+        + array->blockSize * blockCount);
 }
 
 /*
@@ -380,7 +432,11 @@ searchArray(const Array *array, const void *restrict element)
  * EFFECTS
  * make space for n more elements.
  * resizes the array if needed.
- * returns NULL on error.
+ * linear arrays grow by a multiple of blockSize, so pushing n elements takes
+ * O(n^2) time in total.
+ * geometric arrays grow by growthFactor, so pushing n elements takes O(n)
+ * time in total.
+ * returns NULL on error, or if a fixed array does not have enough capacity.
  * takes O(n) if the array is resized. 
  * See expandArray() for details about how the return value should be 
  * handled.
@@ -388,11 +444,23 @@ searchArray(const Array *array, const void *restrict element)
 Array *
 growArray(Array *array, size_t n)
 {
-    if (array->count + n >= array->capacity) {
-        return !array->blockSize ? NULL :
-            expandArray(array, 1 + n / array->blockSize);
+    size_t newCapacity;
+
+    if (array->count + n <= array->capacity)
+        return array;
+    switch (array->growthPolicy) {
+        case ArrayGrowthPolicy_geometric:
+            newCapacity = array->capacity * array->growthFactor;
+            newCapacity = MAX(newCapacity, array->capacity + array->blockSize);
+            newCapacity = MAX(newCapacity, array->count + n + 1);
+            return resizeArray(array, newCapacity);
+        case ArrayGrowthPolicy_linear:
+            return !array->blockSize ? NULL :
+                expandArray(array, 1 + n / array->blockSize);
+        case ArrayGrowthPolicy_fixed:
+        default:
+            return NULL;
     }
-    return array;
 }
 
 /*
@@ -514,7 +582,7 @@ removeContinuousRangeArray(Array *array, void *outElements, size_t index,
         array->count -= n;
     } else if (index + n - 1 == array->count - 1) {
         /* pop operation */ 
-        array->count = index + n - 1;
+        array->count = index;
     } else {
         return -1;
     }
@@ -11,6 +11,14 @@
 #include <stddef.h>
 #include <stdint.h>
 
+enum ArrayGrowthPolicy
+{
+    ArrayGrowthPolicy_linear,
+    ArrayGrowthPolicy_geometric,
+    ArrayGrowthPolicy_fixed,
+};
+
+typedef enum ArrayGrowthPolicy ArrayGrowthPolicy;
 typedef struct Array Array;
 typedef Array * (*ArrayRelocateFunc)();
 
@@ -29,6 +37,8 @@ int removeContinuousRangeArray(Array *array, void *outElements, size_t index,
 Array *cloneArray(const Array *array);
 Array *expandArray(Array *array, size_t blockCount);
 Array *newArray(int blockSize, int capacity, size_t elementSize);
+Array *newArrayWithPolicy(ArrayGrowthPolicy policy, int blockSize,
+    int capacity, size_t elementSize, float growthFactor);
 Array *pushArray(Array *array, const void *element);
 Array *tryPushArray(Array **array, const void *element);
 Array *insertArray(Array *array, const void *element, size_t index);
@@ -59,7 +69,15 @@ Array *forwardShiftRangeArray(Array *array, size_t index, size_t n);
  * automatically resized.
  *
  * blockSize = the number of elements that will be added to the capacity when 
- * the array is resized.
+ * the array is resized. Geometric arrays grow by at least this many elements.
+ *
+ * growthPolicy = how the capacity grows when the array is resized:
+ *   linear: capacity grows by a multiple of blockSize (the default).
+ *   geometric: capacity is multiplied by growthFactor, so pushing n elements
+ *   costs O(n) in total.
+ *   fixed: the array is never resized; pushing into a full array fails.
+ *
+ * growthFactor = the capacity multiplier used by geometric arrays.
  *
  * elementSize = the actual size of each element in bytes.
  *
@@ -88,6 +106,8 @@ struct Array
     size_t capacity;
     size_t blockSize;
     size_t elementSize;
+    ArrayGrowthPolicy growthPolicy;
+    float growthFactor;
     void *first;
 };
 
@@ -0,0 +1,481 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "./concurrent_hashtable.h"
+#include "./utils.h"
+
+#define CONCURRENT_HASH_TABLE_DEFAULT_SHARD_BITS 4
+#define CONCURRENT_HASH_TABLE_MAX_SHARD_BITS 16
+#define CONCURRENT_HASH_TABLE_DEFAULT_READERS 64
+#define CONCURRENT_HASH_TABLE_LOAD_FACTOR 0.75f
+/* readers look up shards at the same time, so they keep no lookup stats */
+#define CONCURRENT_HASH_TABLE_FLAGS \
+    (HashTableFlags_openAddressing | HashTableFlags_noStats)
+
+typedef struct RetiredHashTable RetiredHashTable;
+
+struct RetiredHashTable
+{
+    HashTable *ht;
+    size_t epoch;
+};
+
+static void reclaimConcurrentHashTable(ConcurrentHashTable *cht);
+
+/*
+ * REQUIRES
+ * hashFunc is a valid hash function
+ *
+ * EFFECTS
+ * initializes a new concurrent hash table with 2^shardBits shards, that can
+ * be read by at most maxReaders registered threads at once.
+ * negative shardBits or maxReaders select the defaults.
+ * returns NULL on error
+ */
+ConcurrentHashTable *
+newConcurrentHashTable(HashFunc hashFunc, int shardBits, int maxReaders)
+{
+    ConcurrentHashTable *ret;
+    size_t shardCount;
+    size_t shardsInitialized;
+
+    if (shardBits < 0)
+        shardBits = CONCURRENT_HASH_TABLE_DEFAULT_SHARD_BITS;
+    if (maxReaders <= 0)
+        maxReaders = CONCURRENT_HASH_TABLE_DEFAULT_READERS;
+    if (shardBits > CONCURRENT_HASH_TABLE_MAX_SHARD_BITS)
+        goto error1;
+    if (!(ret = malloc(sizeof(ConcurrentHashTable))))
+        goto error1;
+    ret->shardBits = shardBits;
+    ret->maxReaders = maxReaders;
+    ret->maxLoadFactor = CONCURRENT_HASH_TABLE_LOAD_FACTOR;
+    ret->hashFunc = hashFunc;
+    /* epoch 0 means that a reader is not inside the table */
+    ret->epoch = 1;
+    shardCount = getShardCountConcurrentHashTable(ret);
+    if (!(ret->readers = calloc(maxReaders,
+        sizeof(ConcurrentHashTableReader))))
+        goto error2;
+    if (!(ret->retired = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        -1, sizeof(RetiredHashTable), 0)))
+        goto error3;
+    if (pthread_mutex_init(&ret->retireLock, NULL))
+        goto error4;
+    if (!(ret->shards = calloc(shardCount, sizeof(ConcurrentHashTableShard))))
+        goto error5;
+    for (shardsInitialized = 0; shardsInitialized < shardCount;
+        shardsInitialized++) {
+        if (!(ret->shards[shardsInitialized].ht = newHashTableWithFlags(
+            hashFunc, -1, ret->maxLoadFactor, CONCURRENT_HASH_TABLE_FLAGS)))
+            goto error6;
+        if (pthread_mutex_init(&ret->shards[shardsInitialized].writeLock,
+            NULL)) {
+            deleteHashTable(ret->shards[shardsInitialized].ht);
+            goto error6;
+        }
+    }
+    return ret;
+error6:;
+    while (shardsInitialized--) {
+        deleteHashTable(ret->shards[shardsInitialized].ht);
+        pthread_mutex_destroy(&ret->shards[shardsInitialized].writeLock);
+    }
+    free(ret->shards);
+error5:;
+    pthread_mutex_destroy(&ret->retireLock);
+error4:;
+    deleteArray(ret->retired);
+error3:;
+    free(ret->readers);
+error2:;
+    free(ret);
+error1:;
+    return NULL;
+}
+
+/*
+ * REQUIRES
+ * no thread is using cht
+ *
+ * MODIFIES
+ * cht
+ *
+ * EFFECTS
+ * deletes cht
+ */
+void
+deleteConcurrentHashTable(ConcurrentHashTable *cht)
+{
+    if (!cht)
+        return;
+    for (size_t i = 0; i < getShardCountConcurrentHashTable(cht); i++) {
+        deleteHashTable(cht->shards[i].ht);
+        pthread_mutex_destroy(&cht->shards[i].writeLock);
+    }
+    for (size_t i = 0; i < getCountArray(cht->retired); i++)
+        deleteHashTable(((RetiredHashTable *)getElementArray(cht->retired,
+            i))->ht);
+    deleteArray(cht->retired);
+    pthread_mutex_destroy(&cht->retireLock);
+    free(cht->shards);
+    free(cht->readers);
+    free(cht);
+}
+
+/*
+ * MODIFIES
+ * cht
+ *
+ * EFFECTS
+ * claims a reader slot for the calling thread.
+ * the returned readerID is passed to getConcurrentHashTable().
+ * returns negative if all maxReaders slots are in use.
+ */
+int
+registerReaderConcurrentHashTable(ConcurrentHashTable *cht)
+{
+    int isRegistered;
+
+    for (int i = 0; i < cht->maxReaders; i++) {
+        isRegistered = 0;
+        if (__atomic_compare_exchange_n(&cht->readers[i].isRegistered,
+            &isRegistered, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * REQUIRES
+ * readerID was returned by registerReaderConcurrentHashTable() and the
+ * reader is not inside getConcurrentHashTable().
+ *
+ * MODIFIES
+ * cht
+ *
+ * EFFECTS
+ * releases a reader slot.
+ */
+void
+unregisterReaderConcurrentHashTable(ConcurrentHashTable *cht, int readerID)
+{
+    __atomic_store_n(&cht->readers[readerID].isRegistered, 0,
+        __ATOMIC_RELEASE);
+}
+
+static ConcurrentHashTableShard *
+getShardConcurrentHashTable(const ConcurrentHashTable *cht, uint32_t hash)
+{
+    return &cht->shards[getShardIDConcurrentHashTable(cht, hash)];
+}
+
+/*
+ * the writer of a shard brackets in place modifications with these, so
+ * readers can tell that they raced with a write.
+ */
+static void
+beginWriteShard(ConcurrentHashTableShard *shard)
+{
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static void
+endWriteShard(ConcurrentHashTableShard *shard)
+{
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * REQUIRES
+ * the caller holds the writeLock of shard
+ *
+ * MODIFIES
+ * cht
+ *
+ * EFFECTS
+ * makes ht the HashTable of shard, and queues the old HashTable (that 
+ * readers may still be looking at) for deletion. Then deletes the retired
+ * HashTables that no reader can see anymore.
+ * returns non-zero on error, in which case shard is unchanged.
+ */
+static int
+publishShardConcurrentHashTable(ConcurrentHashTable *cht,
+    ConcurrentHashTableShard *shard, HashTable *ht)
+{
+    RetiredHashTable retired;
+
+    pthread_mutex_lock(&cht->retireLock);
+    /* make room first, so the old HashTable can always be retired */
+    if (!tryPushArray(&cht->retired, NULL)) {
+        pthread_mutex_unlock(&cht->retireLock);
+        return -1;
+    }
+    retired.ht = shard->ht;
+    __atomic_store_n(&shard->ht, ht, __ATOMIC_SEQ_CST);
+    /*
+     * ht was published before the epoch is advanced, so readers that enter
+     * at a later epoch cannot see the old HashTable. Both are SEQ_CST, to
+     * order them with the epoch store and ht load of readers (see
+     * getConcurrentHashTable()).
+     */
+    retired.epoch = __atomic_fetch_add(&cht->epoch, 1, __ATOMIC_SEQ_CST);
+    *(RetiredHashTable *)getLastArray(cht->retired) = retired;
+    reclaimConcurrentHashTable(cht);
+    pthread_mutex_unlock(&cht->retireLock);
+    return 0;
+}
+
+/*
+ * REQUIRES
+ * the caller holds cht->retireLock
+ *
+ * MODIFIES
+ * cht
+ *
+ * EFFECTS
+ * deletes the retired HashTables that were retired before the oldest epoch
+ * that a reader is inside at.
+ */
+static void
+reclaimConcurrentHashTable(ConcurrentHashTable *cht)
+{
+    size_t oldestEpoch;
+    size_t epoch;
+    RetiredHashTable *retired;
+
+    oldestEpoch = SIZE_MAX;
+    for (int i = 0; i < cht->maxReaders; i++) {
+        epoch = __atomic_load_n(&cht->readers[i].epoch, __ATOMIC_SEQ_CST);
+        if (epoch)
+            oldestEpoch = MIN(oldestEpoch, epoch);
+    }
+    for (size_t i = 0; i < getCountArray(cht->retired);) {
+        retired = (RetiredHashTable *)getElementArray(cht->retired, i);
+        if (retired->epoch >= oldestEpoch) {
+            i++;
+            continue;
+        }
+        deleteHashTable(retired->ht);
+        /* the order of the retired list does not matter */
+        *retired = *(RetiredHashTable *)getLastArray(cht->retired);
+        popArray(cht->retired, NULL);
+    }
+}
+
+/*
+ * REQUIRES
+ * the caller holds the writeLock of shard
+ * key and value do not point into cht
+ *
+ * MODIFIES
+ * cht
+ *
+ * EFFECTS
+ * copies the live pairs of shard into a larger HashTable, puts the pair into
+ * the copy and publishes it.
+ * returns the kvIndex of the pair in the copy.
+ * returns negative on error, in which case shard is unchanged.
+ */
+static int
+growShardConcurrentHashTable(ConcurrentHashTable *cht,
+    ConcurrentHashTableShard *shard, const uint8_t *key, size_t nKey,
+    const uint8_t *value, size_t nValue)
+{
+    HashTable *old;
+    HashTable *new;
+    size_t capacity;
+    int ret;
+
+    old = shard->ht;
+    capacity = 2 * (getCountHashTable(old) + 1);
+    if (!(new = newHashTableWithFlags(cht->hashFunc, capacity,
+        cht->maxLoadFactor, CONCURRENT_HASH_TABLE_FLAGS)))
+        goto error1;
+    for (size_t i = 0; i < getKVCountHashTable(old); i++) {
+        if (isDeadHashTable(old, i))
+            continue;
+        if (insertHashTable(new, getKeyHashTable(old, i),
+            getSizeofKeyHashTable(old, i), getValueByKVIndexHashTable(old, i),
+            getSizeofValueHashTable(old, i)) < 0)
+            goto error2;
+    }
+    /* leave room for the shard to double before it is copied again */
+    if (reserveHashTable(new, capacity - getCountHashTable(new)))
+        goto error2;
+    if ((ret = updateHashTable(new, key, nKey, value, nValue)) < 0)
+        goto error2;
+    if (publishShardConcurrentHashTable(cht, shard, new))
+        goto error2;
+    return ret;
+error2:;
+    deleteHashTable(new);
+error1:;
+    return -1;
+}
+
+/*
+ * REQUIRES
+ * key and value are nKey and nValue bytes long.
+ *
+ * MODIFIES
+ * cht
+ *
+ * EFFECTS
+ * associates value with key, inserting the pair if key is not in cht.
+ * safe to call from any number of threads at once.
+ * returns non-zero on error
+ */
+int
+putConcurrentHashTable(ConcurrentHashTable *cht, const uint8_t *key,
+    size_t nKey, const uint8_t *value, size_t nValue)
+{
+    uint32_t hash;
+    int kvIndex;
+    int ret;
+    ConcurrentHashTableShard *shard;
+    HashTable *ht;
+
+    hash = cht->hashFunc(key, nKey);
+    shard = getShardConcurrentHashTable(cht, hash);
+    pthread_mutex_lock(&shard->writeLock);
+    ht = shard->ht;
+    kvIndex = getByHashHashTable(ht, hash, key, nKey);
+    if ((kvIndex >= 0
+        && nValue <= getElementCapacityVLArray(ht->values, kvIndex))
+        || hasRoomHashTable(ht, nKey, nValue)) {
+        /* nothing is relocated, so readers can keep using ht */
+        beginWriteShard(shard);
+        ret = updateHashTable(ht, key, nKey, value, nValue);
+        endWriteShard(shard);
+    } else {
+        ret = growShardConcurrentHashTable(cht, shard, key, nKey, value,
+            nValue);
+    }
+    pthread_mutex_unlock(&shard->writeLock);
+    return ret < 0 ? -1 : 0;
+}
+
+/*
+ * REQUIRES
+ * key is nKey bytes long.
+ *
+ * MODIFIES
+ * cht
+ *
+ * EFFECTS
+ * removes a key value pair from cht.
+ * safe to call from any number of threads at once.
+ * returns negative if key is not in cht.
+ */
+int
+removeConcurrentHashTable(ConcurrentHashTable *cht, const uint8_t *key,
+    size_t nKey)
+{
+    int ret;
+    ConcurrentHashTableShard *shard;
+
+    shard = getShardConcurrentHashTable(cht, cht->hashFunc(key, nKey));
+    pthread_mutex_lock(&shard->writeLock);
+    /* removing only moves slots around, so it is done in place */
+    beginWriteShard(shard);
+    ret = removeHashTable(shard->ht, key, nKey);
+    endWriteShard(shard);
+    pthread_mutex_unlock(&shard->writeLock);
+    return ret < 0 ? -1 : 0;
+}
+
+/*
+ * REQUIRES
+ * readerID was returned by registerReaderConcurrentHashTable() to the
+ * calling thread.
+ * key is nKey bytes long.
+ * outValue has room for nOutValue bytes.
+ *
+ * MODIFIES
+ * outValue, outValueSize
+ *
+ * EFFECTS
+ * copies (at most nOutValue bytes of) the value associated with key into
+ * outValue, and sets *outValueSize to the size of the value if outValueSize
+ * is not NULL.
+ * does not take any locks: the read is retried if a writer modified the
+ * shard in the meantime.
+ * returns negative if key is not in cht.
+ */
+int
+getConcurrentHashTable(ConcurrentHashTable *cht, int readerID,
+    const uint8_t *key, size_t nKey, void *outValue, size_t nOutValue,
+    size_t *outValueSize)
+{
+    uint32_t hash;
+    int kvIndex;
+    size_t seq;
+    size_t valueSize;
+    ConcurrentHashTableShard *shard;
+    ConcurrentHashTableReader *reader;
+    const HashTable *ht;
+
+    hash = cht->hashFunc(key, nKey);
+    shard = getShardConcurrentHashTable(cht, hash);
+    reader = &cht->readers[readerID];
+    /* enter the current epoch before looking at any HashTable */
+    __atomic_store_n(&reader->epoch,
+        __atomic_load_n(&cht->epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    valueSize = 0;
+    for (;;) {
+        seq = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            /* a writer is modifying the shard */
+            sched_yield();
+            continue;
+        }
+        /*
+         * SEQ_CST pairs this load (after the SEQ_CST store of the epoch)
+         * with the SEQ_CST store of shard->ht and fetch_add of cht->epoch
+         * in publishShardConcurrentHashTable(): either the reclaimer sees
+         * the epoch of this reader, or this reader sees the new ht. An
+         * acquire load could be ordered before the epoch store, and read
+         * an old ht that is deleted under it.
+         */
+        ht = __atomic_load_n(&shard->ht, __ATOMIC_SEQ_CST);
+        if ((kvIndex = getByHashHashTable(ht, hash, key, nKey)) >= 0) {
+            valueSize = getSizeofValueHashTable(ht, kvIndex);
+            memcpy(outValue, getValueByKVIndexHashTable(ht, kvIndex),
+                MIN(valueSize, nOutValue));
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shard->seq, __ATOMIC_RELAXED) == seq)
+            break;
+    }
+    __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+    if (kvIndex < 0)
+        return -1;
+    if (outValueSize)
+        *outValueSize = valueSize;
+    return 0;
+}
+
+/*
+ * EFFECTS
+ * returns the number of pairs in cht.
+ * the count of each shard is exact, but other threads may change the
+ * shards that were already counted.
+ */
+size_t
+getCountConcurrentHashTable(ConcurrentHashTable *cht)
+{
+    size_t ret;
+
+    ret = 0;
+    for (size_t i = 0; i < getShardCountConcurrentHashTable(cht); i++) {
+        pthread_mutex_lock(&cht->shards[i].writeLock);
+        ret += getCountHashTable(cht->shards[i].ht);
+        pthread_mutex_unlock(&cht->shards[i].writeLock);
+    }
+    return ret;
+}
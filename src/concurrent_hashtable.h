@@ -0,0 +1,103 @@
+#ifndef ALIB_CONCURRENT_HASH_TABLE_H
+#define ALIB_CONCURRENT_HASH_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "./array.h"
+#include "./hashtable.h"
+
+/* cache line size used to keep shards and readers from false sharing */
+#define CONCURRENT_HASH_TABLE_CACHE_LINE 64
+
+typedef struct ConcurrentHashTable ConcurrentHashTable;
+typedef struct ConcurrentHashTableShard ConcurrentHashTableShard;
+typedef struct ConcurrentHashTableReader ConcurrentHashTableReader;
+
+/*
+ * CONCURRENT HASH TABLE DETAILS AND FIELDS
+ *
+ * A HashTable that can be read by many threads while other threads write to
+ * it. Readers never take a lock.
+ *
+ * shards = the table is split into 2^shardBits open addressing HashTables.
+ * The shard of a key is selected by the high bits of its hash, so writers
+ * to different shards do not contend.
+ *
+ * writeLock = writers to a shard hold its lock.
+ *
+ * seq = a sequence lock for readers of a shard. Writers make seq odd while
+ * they modify a shard in place and make it even again when they are done.
+ * Readers copy the value out and retry if seq was odd or has changed, so a
+ * torn read is never returned. A write is only done in place if it does not
+ * relocate any memory of the shard (see hasRoomHashTable()), so readers
+ * that race with a writer only ever read valid (if stale) memory.
+ *
+ * ht = the HashTable of a shard. When a write needs more memory, the writer
+ * copies the live pairs of ht into a larger HashTable, writes to the copy and
+ * then publishes it by swapping ht. The old HashTable is retired instead of
+ * deleted, since readers may still be looking at it. Copying drops removed
+ * pairs, so shards are compacted as they grow.
+ *
+ * epoch, readers, retired = epoch based reclamation of retired HashTables.
+ * Each reader thread registers a reader slot. While a reader is inside
+ * getConcurrentHashTable(), its slot holds the global epoch it entered at
+ * (0 otherwise). A HashTable that is retired at epoch e is deleted once no
+ * reader is inside with an epoch <= e, since readers that entered later can
+ * only see the HashTable that replaced it.
+ *
+ * The sequence locks, epochs and published pointers use the GCC __atomic
+ * builtins.
+ */
+
+struct ConcurrentHashTableShard
+{
+    pthread_mutex_t writeLock;
+    size_t seq;
+    HashTable *ht;
+    uint8_t padding[CONCURRENT_HASH_TABLE_CACHE_LINE];
+};
+
+struct ConcurrentHashTableReader
+{
+    size_t epoch;
+    int isRegistered;
+    uint8_t padding[CONCURRENT_HASH_TABLE_CACHE_LINE];
+};
+
+struct ConcurrentHashTable
+{
+    int shardBits;
+    int maxReaders;
+    float maxLoadFactor;
+    size_t epoch;
+    HashFunc hashFunc;
+    ConcurrentHashTableShard *shards;
+    ConcurrentHashTableReader *readers;
+    pthread_mutex_t retireLock;
+    Array *retired;
+};
+
+ConcurrentHashTable *newConcurrentHashTable(HashFunc hashFunc, int shardBits,
+    int maxReaders);
+void deleteConcurrentHashTable(ConcurrentHashTable *cht);
+int registerReaderConcurrentHashTable(ConcurrentHashTable *cht);
+void unregisterReaderConcurrentHashTable(ConcurrentHashTable *cht,
+    int readerID);
+int putConcurrentHashTable(ConcurrentHashTable *cht, const uint8_t *key,
+    size_t nKey, const uint8_t *value, size_t nValue);
+int removeConcurrentHashTable(ConcurrentHashTable *cht, const uint8_t *key,
+    size_t nKey);
+int getConcurrentHashTable(ConcurrentHashTable *cht, int readerID,
+    const uint8_t *key, size_t nKey, void *outValue, size_t nOutValue,
+    size_t *outValueSize);
+size_t getCountConcurrentHashTable(ConcurrentHashTable *cht);
+
+#define getShardCountConcurrentHashTable(CHT_PTR) \
+    ((size_t)1 << (CHT_PTR)->shardBits)
+#define getShardIDConcurrentHashTable(CHT_PTR, HASH) \
+    ((CHT_PTR)->shardBits ? (uint32_t)(HASH) >> (32 - (CHT_PTR)->shardBits) \
+    : 0)
+
+#endif
@@ -1,10 +1,147 @@
 /* aidan bird 2021 */
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <pthread.h>
 
 #include "./csv.h"
+#include "./scan.h"
 #include "./utils.h"
 
+#define CSV_SPANS_DEFAULT_CAPACITY 64
+#define CSV_PARSER_DEFAULT_BUFFER_SIZE 256
+/* newCSVRows() does not split text into chunks smaller than this */
+#define CSV_ROWS_MIN_CHUNK_SIZE ((size_t)1 << 16)
+
+typedef struct CSVChunk CSVChunk;
+typedef struct CSVTableLoader CSVTableLoader;
+
+/* the size of a value of each CSVColumnType */
+static const size_t columnTypeSizes[] = {
+    [CSVColumnType_skip] = 0,
+    [CSVColumnType_int64] = sizeof(int64_t),
+    [CSVColumnType_double] = sizeof(double),
+    [CSVColumnType_string] = sizeof(CSVSpan),
+};
+
+/*
+ * what newCSVTable() needs in the callbacks of its parser.
+ * column = the column of the next field of the current row.
+ * isHeader = the current row is the header, and is not loaded.
+ */
+struct CSVTableLoader
+{
+    CSVTable *table;
+    size_t column;
+    int isHeader;
+};
+
+/*
+ * the part of the text that one thread of newCSVRows() splits into rows.
+ * start, end = the bytes of the text given to the chunk. 
+ * isQuoted = whether start is assumed to be inside a quoted field.
+ * isDone = whether the current job (splitting or copying) of the chunk is
+ * done.
+ * nQuotes = the number of quotes in [start, end).
+ * boundary = where the first row of the chunk starts.
+ * endPos = where the row after the last row of the chunk starts.
+ * the chunk has the rows that start in [boundary, endPos).
+ * fieldOffset, rowOffset = the number of fields and rows before the rows of 
+ * the chunk in the joined rows.
+ * fieldsOut, rowsOut = where the rows of the chunk go in the joined rows.
+ */
+struct CSVChunk
+{
+    const char *text;
+    size_t n;
+    char delimiter;
+    char isQuoted;
+    char isDone;
+    int err;
+    size_t start;
+    size_t end;
+    size_t nQuotes;
+    size_t boundary;
+    size_t endPos;
+    Array *fields;
+    Array *rows;
+    size_t fieldOffset;
+    size_t rowOffset;
+    CSVSpan *fieldsOut;
+    size_t *rowsOut;
+};
+
+/*
+ * REQUIRES
+ * csvtext is not null
+ * n is valid
+ *
+ * MODIFIES
+ * none
+ *
+ * EFFECTS
+ * interprets csvtext as a list n bytes long and with elements separated by 
+ * commas.
+ * returns an Array of CSVSpans, one for each element (not including the
+ * commas), that point into csvtext. Nothing is copied, so splitting the text
+ * takes a single pass and the result is 16 bytes per element no matter how
+ * long the elements are. csvtext must outlive the spans.
+ * returns NULL on error.
+ */
+Array *
+newCSVSpans(const void *csvtext, size_t n)
+{
+    Array *ret;
+    Array *tmp;
+    const uint8_t *text;
+    size_t start;
+    size_t comma;
+    size_t first;
+    uint64_t mask;
+    CSVSpan *span;
+    ScanMasks masks;
+
+    if (!(ret = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        CSV_SPANS_DEFAULT_CAPACITY, sizeof(CSVSpan), 0)))
+        goto error1;
+    text = csvtext;
+    start = 0;
+    /* find the commas 64 bytes at a time (see scan.h) */
+    for (size_t block = 0; block < n; block += SCAN_BLOCK_SIZE) {
+        if (n - block >= SCAN_BLOCK_SIZE)
+            scanBlock(text + block, ',', &masks);
+        else
+            scanPartialBlock(text + block, n - block, ',', &masks);
+        if (!(mask = masks.delimiters))
+            continue;
+        /* append a span for each comma in the block at once */
+        first = getCountArray(ret);
+        if (!(tmp = forwardShiftRangeArray(ret, first, popCountScan(mask))))
+            goto error2;
+        ret = tmp;
+        span = getSpanCSV(ret, first);
+        for (; mask; mask &= mask - 1, span++) {
+            comma = block + lowestBitScan(mask);
+            span->offset = start;
+            span->length = comma - start;
+            start = comma + 1;
+        }
+    }
+    /* the last element is not followed by a comma */
+    if (!tryPushArray(&ret, &(CSVSpan) {
+        .offset = start,
+        .length = n - start,
+    }))
+        goto error2;
+    return ret;
+error2:;
+    deleteArray(ret);
+error1:;
+    return NULL;
+}
+
 /*
  * REQUIRES
  * csvtext is not null
@@ -18,62 +155,899 @@
  * commas.
  * returns a VLArray with all the elements (not including the commas).
  * each element in the VLArray is null terminated.
+ * Prefer newCSVSpans() when the elements do not need to be copied.
  * returns NULL on error.
  */
 VLArray *
 newCSVRaw(const void *csvtext, size_t n)
 {
     VLArray *ret;
-    VLArray *tmp;
-    size_t *entryIndexes;
-    size_t *entrySizes;
-    size_t entryCount;
-    size_t entryOffsetEnd;
-    size_t entryOffsetStart;
-    size_t maxEntrySize;
-    char *nextEntry;
-
-    entryCount = charCount(csvtext, n, ',') + 1;
-    if (!(ret = newVLArray(-1, entryCount, (n / entryCount) + 1)))
+    Array *spans;
+    const CSVSpan *span;
+    char *element;
+
+    if (!(spans = newCSVSpans(csvtext, n)))
         goto error1;
-    if (!(entryIndexes = malloc(2 * sizeof(size_t) * entryCount)))
+    if (!(ret = newVLArrayPacked(-1, getCountArray(spans), 1)))
         goto error2;
-    entrySizes = (size_t *)((char *)entryIndexes 
-        + sizeof(size_t) * entryCount);
-    entryOffsetStart = 0;
-    entryOffsetEnd = 0;
-    maxEntrySize = 0;
-    for (size_t i = 0; i < entryCount; i++) {
-        entryIndexes[i] = entryOffsetStart;
-        while (entryOffsetEnd < n
-            && ((const char *)csvtext)[entryOffsetEnd] != ',') {
-            entryOffsetEnd++;
+    /* copy each element straight from csvtext into its frames */
+    for (size_t i = 0; i < getCountArray(spans); i++) {
+        span = getSpanCSV(spans, i);
+        if (!tryPushVLArray(&ret, NULL, span->length + 1))
+            goto error3;
+        element = (char *)peekVLArray(ret);
+        memcpy(element, getFieldCSV(csvtext, span), span->length);
+        element[span->length] = '\0';
+    }
+    deleteArray(spans);
+    return ret;
+error3:;
+    deleteVLArray(ret);
+error2:;
+    deleteArray(spans);
+error1:;
+    return NULL;
+}
+
+/*
+ * REQUIRES
+ * onField is not NULL
+ *
+ * EFFECTS
+ * makes a streaming csv parser (see csv.h) that calls onField for each
+ * field and onRow (if not NULL) for each row.
+ * maxFieldSize is the longest field that is accepted, or 0 for no limit.
+ * returns NULL on error.
+ */
+CSVParser *
+newCSVParser(char delimiter, size_t maxFieldSize, CSVFieldFunc onField,
+    CSVRowFunc onRow, void *ctx)
+{
+    CSVParser *ret;
+
+    if (!(ret = malloc(sizeof(CSVParser))))
+        goto error1;
+    if (!(ret->buffer = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        CSV_PARSER_DEFAULT_BUFFER_SIZE, sizeof(char), 0)))
+        goto error2;
+    ret->delimiter = delimiter;
+    ret->skipLF = 0;
+    ret->state = CSVParserState_fieldStart;
+    ret->maxFieldSize = maxFieldSize;
+    ret->segmentStart = 0;
+    ret->segmentEnd = 0;
+    ret->fieldCount = 0;
+    ret->rowCount = 0;
+    ret->onField = onField;
+    ret->onRow = onRow;
+    ret->ctx = ctx;
+    return ret;
+error2:;
+    free(ret);
+error1:;
+    return NULL;
+}
+
+void
+deleteCSVParser(CSVParser *parser)
+{
+    if (!parser)
+        return;
+    deleteArray(parser->buffer);
+    free(parser);
+}
+
+/*
+ * MODIFIES
+ * parser
+ *
+ * EFFECTS
+ * appends the n bytes of src to the buffer of parser.
+ * returns non-zero on error
+ */
+static int
+appendCSVParser(CSVParser *parser, const char *src, size_t n)
+{
+    size_t count;
+    Array *tmp;
+
+    if (!n)
+        return 0;
+    count = getCountArray(parser->buffer);
+    if (parser->maxFieldSize && count + n > parser->maxFieldSize)
+        return CSV_PARSER_FIELD_TOO_LONG;
+    if (!(tmp = forwardShiftRangeArray(parser->buffer, count, n)))
+        return CSV_PARSER_NO_MEMORY;
+    parser->buffer = tmp;
+    memcpy(getElementArray(parser->buffer, count), src, n);
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * parser
+ *
+ * EFFECTS
+ * ends the current field, whose last bytes are chunk[segmentStart] up to
+ * chunk[segmentEnd], and passes it to onField.
+ * the field is passed straight from the chunk if none of it is in the 
+ * buffer.
+ * returns non-zero on error, or if onField returns non-zero.
+ */
+static int
+endFieldCSVParser(CSVParser *parser, const char *chunk)
+{
+    const char *field;
+    size_t n;
+    int err;
+
+    field = chunk + parser->segmentStart;
+    n = parser->segmentEnd - parser->segmentStart;
+    if (!isEmptyArray(parser->buffer)) {
+        if ((err = appendCSVParser(parser, field, n)))
+            return err;
+        field = (const char *)getElementArray(parser->buffer, 0);
+        n = getCountArray(parser->buffer);
+    } else if (parser->maxFieldSize && n > parser->maxFieldSize) {
+        return CSV_PARSER_FIELD_TOO_LONG;
+    }
+    parser->fieldCount++;
+    parser->state = CSVParserState_fieldStart;
+    err = parser->onField(parser->ctx, field, n);
+    clearArray(parser->buffer);
+    return err;
+}
+
+/*
+ * MODIFIES
+ * parser
+ *
+ * EFFECTS
+ * ends the current row and passes it to onRow.
+ * returns non-zero if onRow returns non-zero.
+ */
+static int
+endRowCSVParser(CSVParser *parser)
+{
+    size_t fieldCount;
+
+    fieldCount = parser->fieldCount;
+    parser->fieldCount = 0;
+    parser->rowCount++;
+    return parser->onRow ? parser->onRow(parser->ctx, fieldCount) : 0;
+}
+
+/*
+ * REQUIRES
+ * chunk is n bytes long
+ *
+ * MODIFIES
+ * parser
+ *
+ * EFFECTS
+ * parses the next n bytes of the input. The callbacks are called for every
+ * field and row that ends in chunk. The parts of an unfinished field are 
+ * copied into the parser, so chunk can be reused once this returns.
+ * returns non-zero on error (e.g., a field is longer than maxFieldSize), or
+ * the value returned by a callback that returned non-zero. The parser can 
+ * not be used after an error.
+ */
+int
+feedCSVParser(CSVParser *parser, const void *chunk, size_t n)
+{
+    const char *text;
+    char c;
+    int err;
+
+    text = chunk;
+    parser->segmentStart = 0;
+    parser->segmentEnd = 0;
+    for (size_t i = 0; i < n; i++) {
+        c = text[i];
+        switch (parser->state) {
+        case CSVParserState_fieldStart:
+            if (parser->skipLF) {
+                parser->skipLF = 0;
+                if (c == '\n')
+                    continue;
+            }
+            if (c == '"') {
+                parser->state = CSVParserState_quoted;
+                parser->segmentStart = i + 1;
+                continue;
+            }
+            parser->state = CSVParserState_unquoted;
+            parser->segmentStart = i;
+            /* empty lines are skipped */
+            if ((c == '\n' || c == '\r') && !parser->fieldCount) {
+                parser->state = CSVParserState_fieldStart;
+                parser->skipLF = c == '\r';
+                continue;
+            }
+            /* FALLTHROUGH */
+        case CSVParserState_unquoted:
+            /* most bytes are plain field bytes, so skip them quickly */
+            while (c != parser->delimiter && c != '\n' && c != '\r') {
+                if (++i == n)
+                    goto endOfChunk;
+                c = text[i];
+            }
+            break;
+        case CSVParserState_quoted:
+            while (c != '"') {
+                if (++i == n)
+                    goto endOfChunk;
+                c = text[i];
+            }
+            parser->segmentEnd = i;
+            parser->state = CSVParserState_quoteInQuoted;
+            continue;
+        case CSVParserState_quoteInQuoted:
+            if (c == '"') {
+                /* an escaped quote; keep one of them */
+                if ((err = appendCSVParser(parser, 
+                    text + parser->segmentStart, 
+                    parser->segmentEnd - parser->segmentStart))
+                    || (err = appendCSVParser(parser, "\"", 1)))
+                    return err;
+                parser->segmentStart = i + 1;
+                parser->state = CSVParserState_quoted;
+                continue;
+            }
+            if (c != parser->delimiter && c != '\n' && c != '\r') {
+                /* text after the closing quote is kept as is */
+                if ((err = appendCSVParser(parser,
+                    text + parser->segmentStart,
+                    parser->segmentEnd - parser->segmentStart)))
+                    return err;
+                parser->segmentStart = i;
+                parser->state = CSVParserState_unquoted;
+                i--;
+                continue;
+            }
+            /* the field ended at the closing quote */
+            if ((err = endFieldCSVParser(parser, text)))
+                return err;
+            goto endOfField;
+        }
+        /* c ends an unquoted field */
+        parser->segmentEnd = i;
+        if ((err = endFieldCSVParser(parser, text)))
+            return err;
+endOfField:;
+        if (c == parser->delimiter)
+            continue;
+        parser->skipLF = c == '\r';
+        if ((err = endRowCSVParser(parser)))
+            return err;
+    }
+endOfChunk:;
+    /* keep the unfinished part of the current field */
+    switch (parser->state) {
+    case CSVParserState_unquoted:
+    case CSVParserState_quoted:
+        return appendCSVParser(parser, text + parser->segmentStart,
+            n - parser->segmentStart);
+    case CSVParserState_quoteInQuoted:
+        return appendCSVParser(parser, text + parser->segmentStart,
+            parser->segmentEnd - parser->segmentStart);
+    default:
+        return 0;
+    }
+}
+
+/*
+ * MODIFIES
+ * parser
+ *
+ * EFFECTS
+ * ends the input, passing the last field and row to the callbacks if the
+ * input does not end with a row end.
+ * returns non-zero on error (e.g., the input ends inside a quoted field), or
+ * the value returned by a callback that returned non-zero.
+ */
+int
+finishCSVParser(CSVParser *parser)
+{
+    int err;
+
+    if (parser->state == CSVParserState_quoted)
+        return CSV_PARSER_UNTERMINATED_QUOTE;
+    /* the input ended with a row end */
+    if (parser->state == CSVParserState_fieldStart && !parser->fieldCount)
+        return 0;
+    /* 
+     * the unfinished field is entirely in the buffer (or is the empty field
+     * after a trailing delimiter, e.g., "a,b,")
+     */
+    parser->segmentStart = 0;
+    parser->segmentEnd = 0;
+    if ((err = endFieldCSVParser(parser, "")))
+        return err;
+    return endRowCSVParser(parser);
+}
+
+/*
+ * EFFECTS
+ * returns where the row after the first row end (LF or CR) at or after
+ * chunk->start starts, assuming that chunk->start is inside a quoted field
+ * if chunk->isQuoted.
+ * returns n if there is no such row end.
+ */
+static size_t
+findBoundaryCSV(const CSVChunk *chunk)
+{
+    int isQuoted;
+
+    isQuoted = chunk->isQuoted;
+    for (size_t i = chunk->start; i < chunk->n; i++) {
+        if (chunk->text[i] == '"')
+            isQuoted = !isQuoted;
+        else if ((chunk->text[i] == '\n' || chunk->text[i] == '\r')
+            && !isQuoted)
+            return i + 1;
+    }
+    return chunk->n;
+}
+
+/*
+ * MODIFIES
+ * chunk
+ *
+ * EFFECTS
+ * adds the field text[fieldStart, fieldEnd) to chunk->fields, starting a 
+ * new row first if isNewRow.
+ * returns non-zero on error.
+ */
+static int
+pushFieldCSV(CSVChunk *chunk, size_t fieldStart, size_t fieldEnd,
+    int isNewRow)
+{
+    size_t firstField;
+
+    firstField = getCountArray(chunk->fields);
+    if (isNewRow && !tryPushArray(&chunk->rows, &firstField))
+        return -1;
+    return !tryPushArray(&chunk->fields, &(CSVSpan) {
+        .offset = fieldStart,
+        .length = fieldEnd - fieldStart,
+    });
+}
+
+/*
+ * MODIFIES
+ * chunk
+ *
+ * EFFECTS
+ * splits the rows of chunk that start at chunk->boundary into chunk->fields
+ * and chunk->rows. Parsing stops after the first row end at or after 
+ * chunk->end (where the next chunk starts its rows), and chunk->endPos is 
+ * set to where parsing stopped.
+ * rows end on LF, CR or CRLF, like in CSVParser: a CR and a LF both end
+ * the row, and the LF of a CRLF is then an empty line, which is skipped.
+ * the text is scanned 64 bytes at a time, and only the delimiters, quotes
+ * and row ends (the set bits of the scan masks) are looked at.
+ * sets chunk->err on error (e.g., the text ends inside a quoted field).
+ */
+static void
+parseChunkCSV(CSVChunk *chunk)
+{
+    const char *text;
+    ScanMasks masks;
+    uint64_t mask;
+    size_t n;
+    size_t p;
+    size_t fieldStart;
+    size_t escapedQuote;
+    int isQuoted;
+    int isInRow;
+    int isRowEnd;
+
+    text = chunk->text;
+    n = chunk->n;
+    fieldStart = chunk->boundary;
+    chunk->err = 0;
+    clearArray(chunk->fields);
+    clearArray(chunk->rows);
+    /* the row end before boundary already belongs to the next chunk */
+    if (fieldStart > chunk->end) {
+        chunk->endPos = fieldStart;
+        return;
+    }
+    isQuoted = 0;
+    isInRow = 0;
+    escapedQuote = (size_t)-1;
+    for (size_t block = fieldStart; block < n; block += SCAN_BLOCK_SIZE) {
+        if (n - block >= SCAN_BLOCK_SIZE)
+            scanBlock((const uint8_t *)text + block, chunk->delimiter, &masks);
+        else
+            scanPartialBlock((const uint8_t *)text + block, n - block,
+                chunk->delimiter, &masks);
+        mask = masks.delimiters | masks.quotes | masks.newlines
+            | masks.returns;
+        for (; mask; mask &= mask - 1) {
+            p = block + lowestBitScan(mask);
+            if (text[p] == '"') {
+                /* 
+                 * only a quote that starts a field opens a quoted field, 
+                 * and "" inside a quoted field is an escaped quote.
+                 */
+                if (!isQuoted)
+                    isQuoted = p == fieldStart;
+                else if (p == escapedQuote)
+                    continue;
+                else if (p + 1 < n && text[p + 1] == '"')
+                    escapedQuote = p + 1;
+                else
+                    isQuoted = 0;
+                continue;
+            }
+            if (isQuoted)
+                continue;
+            isRowEnd = text[p] == '\n' || text[p] == '\r';
+            /* empty lines are skipped */
+            if (!isRowEnd || isInRow || p != fieldStart) {
+                if (pushFieldCSV(chunk, fieldStart, p, !isInRow))
+                    goto error1;
+                isInRow = !isRowEnd;
+            }
+            fieldStart = p + 1;
+            if (isRowEnd && p >= chunk->end) {
+                chunk->endPos = fieldStart;
+                return;
+            }
         }
-        entrySizes[i] = entryOffsetEnd - entryOffsetStart;
-        if (maxEntrySize < entrySizes[i])
-            maxEntrySize = entrySizes[i];
-        entryOffsetEnd++;
-        entryOffsetStart = entryOffsetEnd;
     }
-    if (!(nextEntry = malloc(sizeof(maxEntrySize + 1))))
+    chunk->endPos = n;
+    if (isQuoted) {
+        chunk->err = CSV_PARSER_UNTERMINATED_QUOTE;
+        return;
+    }
+    /* the last row does not end with a row end */
+    if ((isInRow || fieldStart < n)
+        && pushFieldCSV(chunk, fieldStart, n, !isInRow))
+        goto error1;
+    return;
+error1:;
+    chunk->err = CSV_PARSER_NO_MEMORY;
+}
+
+/*
+ * MODIFIES
+ * arg (a CSVChunk)
+ *
+ * EFFECTS
+ * counts the quotes of the chunk, finds its first row using the 
+ * speculated quote state (chunk->isQuoted), and splits the rows of the 
+ * chunk. newCSVRows() checks the speculation afterwards.
+ */
+static void *
+runChunkCSV(void *arg)
+{
+    CSVChunk *chunk;
+
+    chunk = arg;
+    chunk->nQuotes = countByteScan(chunk->text + chunk->start,
+        chunk->end - chunk->start, '"');
+    chunk->boundary = chunk->start ? findBoundaryCSV(chunk) : 0;
+    parseChunkCSV(chunk);
+    chunk->isDone = 1;
+    return NULL;
+}
+
+/*
+ * REQUIRES
+ * threads has room for nChunks threads
+ *
+ * MODIFIES
+ * chunks, threads
+ *
+ * EFFECTS
+ * runs func (e.g., runChunkCSV()) on each chunk that is not done, each on
+ * its own thread, and waits for them.
+ * returns non-zero if a thread could not be started.
+ */
+static int
+runChunksCSV(CSVChunk *chunks, int nChunks, pthread_t *threads,
+    void *(*func)(void *))
+{
+    int nStarted;
+    int ret;
+    int i;
+
+    ret = 0;
+    nStarted = 0;
+    for (i = 0; i < nChunks; i++) {
+        if (chunks[i].isDone)
+            continue;
+        if (pthread_create(&threads[nStarted], NULL, func, &chunks[i])) {
+            ret = -1;
+            break;
+        }
+        nStarted++;
+    }
+    for (i = 0; i < nStarted; i++)
+        pthread_join(threads[i], NULL);
+    return ret;
+}
+
+/*
+ * MODIFIES
+ * arg (a CSVChunk)
+ *
+ * EFFECTS
+ * copies the rows of the chunk to their place in the joined rows 
+ * (chunk->fieldsOut and chunk->rowsOut), moving the first field of each
+ * row by chunk->fieldOffset.
+ */
+static void *
+copyChunkCSV(void *arg)
+{
+    CSVChunk *chunk;
+
+    chunk = arg;
+    memcpy(chunk->fieldsOut, chunk->fields->first,
+        sizeofArray(chunk->fields));
+    for (size_t i = 0; i < getCountArray(chunk->rows); i++) {
+        chunk->rowsOut[i] = chunk->fieldOffset
+            + *(size_t *)getElementArray(chunk->rows, i);
+    }
+    chunk->isDone = 1;
+    return NULL;
+}
+
+/*
+ * REQUIRES
+ * csvtext is not null
+ * nThreads > 0
+ *
+ * EFFECTS
+ * splits csv text (RFC 4180, with LF, CRLF or CR row ends) into rows of 
+ * fields using nThreads threads (see CSVRows in csv.h).
+ * the text is cut into nThreads chunks, which are parsed at the same 
+ * time. A chunk can not know whether it starts inside a quoted field 
+ * without parsing all of the text before it, so each thread speculates that
+ * it does not, and starts its rows after the first row end that is outside
+ * quotes under that assumption. The threads also count their quotes, so 
+ * once they are done the quote state at the start of each chunk follows
+ * from the parity of the quotes before it, and the chunks that guessed 
+ * wrong (e.g., ones that started inside a quoted field with a newline) 
+ * are parsed again in parallel. Finally the chunks are checked in order: a 
+ * chunk is correct if its first row starts where the (correct) chunk 
+ * before it stopped, and any chunk that is still wrong (which takes text 
+ * that is not RFC 4180, like x"y) is parsed again from the right position,
+ * so the result is always the same as with one thread.
+ * The rows of the chunks are then joined in order, with each thread 
+ * copying its own rows.
+ * empty lines are skipped. 
+ * returns NULL on error (e.g., the text ends inside a quoted field).
+ */
+CSVRows *
+newCSVRows(const void *csvtext, size_t n, char delimiter, int nThreads)
+{
+    CSVRows *ret;
+    CSVChunk *chunks;
+    pthread_t *threads;
+    size_t nFields;
+    size_t nRows;
+    size_t expected;
+    size_t nQuotes;
+    int i;
+
+    nThreads = MAX(1, MIN((size_t)nThreads, n / CSV_ROWS_MIN_CHUNK_SIZE));
+    if (!(ret = malloc(sizeof(CSVRows))))
+        goto error1;
+    if (!(chunks = calloc(nThreads, sizeof(CSVChunk))))
+        goto error2;
+    if (!(threads = malloc(sizeof(pthread_t) * nThreads)))
         goto error3;
-    for (size_t i = 0; i < entryCount; i++) {
-        memcpy(nextEntry, (char *)csvtext + entryIndexes[i], entrySizes[i]);
-        nextEntry[entrySizes[i]] = '\0';
-        tmp = pushVLArray(ret, nextEntry, entrySizes[i] + 1);
-        if (!tmp)
+    for (i = 0; i < nThreads; i++) {
+        chunks[i].text = csvtext;
+        chunks[i].n = n;
+        chunks[i].delimiter = delimiter;
+        chunks[i].start = n / nThreads * i;
+        chunks[i].end = i == nThreads - 1 ? n : n / nThreads * (i + 1);
+        if (!(chunks[i].fields = newArrayWithPolicy(
+            ArrayGrowthPolicy_geometric, -1, CSV_SPANS_DEFAULT_CAPACITY,
+            sizeof(CSVSpan), 0))
+            || !(chunks[i].rows = newArrayWithPolicy(
+            ArrayGrowthPolicy_geometric, -1, CSV_SPANS_DEFAULT_CAPACITY,
+            sizeof(size_t), 0)))
             goto error4;
-        ret = tmp;
     }
-    free(nextEntry);
-    free(entryIndexes);
+    if (runChunksCSV(chunks, nThreads, threads, runChunkCSV))
+        goto error4;
+    nQuotes = 0;
+    for (i = 0; i < nThreads; i++) {
+        chunks[i].isQuoted = nQuotes % 2;
+        chunks[i].isDone = !chunks[i].isQuoted;
+        nQuotes += chunks[i].nQuotes;
+    }
+    if (runChunksCSV(chunks, nThreads, threads, runChunkCSV))
+        goto error4;
+    /* check each chunk */
+    expected = 0;
+    nFields = 0;
+    nRows = 0;
+    for (i = 0; i < nThreads; i++) {
+        if (chunks[i].boundary != expected) {
+            chunks[i].boundary = expected;
+            parseChunkCSV(&chunks[i]);
+        }
+        if (chunks[i].err)
+            goto error4;
+        expected = chunks[i].endPos;
+        chunks[i].fieldOffset = nFields;
+        chunks[i].rowOffset = nRows;
+        nFields += getCountArray(chunks[i].fields);
+        nRows += getCountArray(chunks[i].rows);
+    }
+    /* the rows of the first chunk are taken as they are, and grown */
+    if (!(ret->fields = forwardShiftRangeArray(chunks[0].fields,
+        getCountArray(chunks[0].fields),
+        nFields - getCountArray(chunks[0].fields))))
+        goto error4;
+    chunks[0].fields = NULL;
+    if (!(ret->rows = forwardShiftRangeArray(chunks[0].rows,
+        getCountArray(chunks[0].rows), nRows - getCountArray(chunks[0].rows))))
+        goto error5;
+    chunks[0].rows = NULL;
+    for (i = 1; i < nThreads; i++) {
+        chunks[i].fieldsOut = getSpanCSV(ret->fields, chunks[i].fieldOffset);
+        chunks[i].rowsOut = (size_t *)getElementArray(ret->rows,
+            chunks[i].rowOffset);
+        chunks[i].isDone = 0;
+    }
+    if (runChunksCSV(chunks, nThreads, threads, copyChunkCSV))
+        goto error6;
+    for (i = 0; i < nThreads; i++) {
+        deleteArray(chunks[i].fields);
+        deleteArray(chunks[i].rows);
+    }
+    free(threads);
+    free(chunks);
     return ret;
+error6:;
+    deleteArray(ret->rows);
+error5:;
+    deleteArray(ret->fields);
 error4:;
-    free(nextEntry);
+    for (i = 0; i < nThreads; i++) {
+        deleteArray(chunks[i].fields);
+        deleteArray(chunks[i].rows);
+    }
+    free(threads);
 error3:;
-    free(entryIndexes);
+    free(chunks);
 error2:;
-    deleteVLArray(ret);
+    free(ret);
+error1:;
+    return NULL;
+}
+
+void
+deleteCSVRows(CSVRows *rows)
+{
+    if (!rows)
+        return;
+    deleteArray(rows->fields);
+    deleteArray(rows->rows);
+    free(rows);
+}
+
+/*
+ * REQUIRES
+ * span is a field of csvtext (e.g., from newCSVRows())
+ * out has room for span->length bytes
+ *
+ * MODIFIES
+ * out
+ *
+ * EFFECTS
+ * copies the field into out, removing its quotes (if it is quoted) and
+ * replacing escaped quotes ("") by a single quote.
+ * returns the length of the unquoted field.
+ */
+size_t
+unquoteFieldCSV(const void *csvtext, const CSVSpan *span, char *out)
+{
+    const char *field;
+    size_t ret;
+    size_t i;
+
+    field = getFieldCSV(csvtext, span);
+    if (!span->length || field[0] != '"') {
+        memcpy(out, field, span->length);
+        return span->length;
+    }
+    ret = 0;
+    for (i = 1; i < span->length; i++) {
+        if (field[i] == '"') {
+            /* an escaped quote, or the closing quote */
+            if (i + 1 < span->length && field[i + 1] == '"') {
+                out[ret++] = '"';
+                i++;
+                continue;
+            }
+            i++;
+            break;
+        }
+        out[ret++] = field[i];
+    }
+    /* text after the closing quote is kept as is */
+    for (; i < span->length; i++)
+        out[ret++] = field[i];
+    return ret;
+}
+
+/*
+ * MODIFIES
+ * column
+ *
+ * EFFECTS
+ * converts the field to the type of the column, and appends it.
+ * returns non-zero on error.
+ */
+static int
+pushFieldCSVTable(CSVColumn *column, const char *field, size_t n)
+{
+    int64_t intValue;
+    double doubleValue;
+    size_t count;
+    Array *tmp;
+
+    switch (column->type) {
+        case CSVColumnType_int64:
+            intValue = 0;
+            if (n && parseInt64(field, n, &intValue))
+                return CSV_PARSER_BAD_NUMBER;
+            return tryPushArray(&column->values, &intValue) ? 0
+                : CSV_PARSER_NO_MEMORY;
+        case CSVColumnType_double:
+            doubleValue = NAN;
+            if (n && parseDouble(field, n, &doubleValue))
+                return CSV_PARSER_BAD_NUMBER;
+            return tryPushArray(&column->values, &doubleValue) ? 0
+                : CSV_PARSER_NO_MEMORY;
+        case CSVColumnType_string:
+            count = getCountArray(column->text);
+            if (!(tmp = forwardShiftRangeArray(column->text, count, n + 1)))
+                return CSV_PARSER_NO_MEMORY;
+            column->text = tmp;
+            memcpy(getElementArray(column->text, count), field, n);
+            *(char *)getElementArray(column->text, count + n) = '\0';
+            return tryPushArray(&column->values, &(CSVSpan) {
+                .offset = count,
+                .length = n,
+            }) ? 0 : CSV_PARSER_NO_MEMORY;
+        case CSVColumnType_skip:
+        default:
+            return 0;
+    }
+}
+
+/* the CSVFieldFunc of newCSVTable() */
+static int
+onFieldCSVTable(void *ctx, const char *field, size_t n)
+{
+    CSVTableLoader *loader;
+
+    loader = ctx;
+    /* fields past the last column are ignored */
+    if (loader->isHeader || loader->column >= loader->table->nColumns) {
+        loader->column++;
+        return 0;
+    }
+    return pushFieldCSVTable(&loader->table->columns[loader->column++], field,
+        n);
+}
+
+/* the CSVRowFunc of newCSVTable() */
+static int
+onRowCSVTable(void *ctx, size_t nFields)
+{
+    CSVTableLoader *loader;
+    int err;
+
+    (void)nFields;
+    loader = ctx;
+    if (loader->isHeader) {
+        loader->isHeader = 0;
+        loader->column = 0;
+        return 0;
+    }
+    /* the fields missing from a short row are empty */
+    for (; loader->column < loader->table->nColumns; loader->column++) {
+        err = pushFieldCSVTable(&loader->table->columns[loader->column], "",
+            0);
+        if (err)
+            return err;
+    }
+    loader->table->nRows++;
+    loader->column = 0;
+    return 0;
+}
+
+/*
+ * REQUIRES
+ * csvtext is not null
+ * schema has nColumns types
+ *
+ * EFFECTS
+ * loads csv text (see CSVParser) into a table with a typed column for each
+ * type in schema (see CSVTable in csv.h). Each column is a single Array 
+ * (plus one for the text of string columns) that is sized for the number 
+ * of lines of the text up front, so loading allocates per column instead 
+ * of per field. Numbers are parsed straight from the text with 
+ * parseInt64() and parseDouble(), and skipped columns are only scanned.
+ * if flags has CSVTableFlags_header, the first row is not loaded.
+ * returns NULL on error (e.g., a field of a numeric column is not a 
+ * number).
+ */
+CSVTable *
+newCSVTable(const void *csvtext, size_t n, char delimiter,
+    const CSVColumnType *schema, size_t nColumns, int flags)
+{
+    CSVTable *ret;
+    CSVParser *parser;
+    CSVTableLoader loader;
+    CSVColumn *column;
+    size_t nRows;
+
+    if (!(ret = malloc(sizeof(CSVTable))))
+        goto error1;
+    if (!(ret->columns = calloc(MAX(nColumns, 1), sizeof(CSVColumn))))
+        goto error2;
+    ret->nColumns = nColumns;
+    ret->nRows = 0;
+    /* every row but the last ends with a LF */
+    nRows = countByteScan(csvtext, n, '\n') + 1;
+    for (size_t i = 0; i < nColumns; i++) {
+        column = &ret->columns[i];
+        column->type = schema[i];
+        if (column->type == CSVColumnType_skip)
+            continue;
+        if (!(column->values = newArrayWithPolicy(ArrayGrowthPolicy_geometric,
+            -1, nRows, columnTypeSizes[column->type], 0)))
+            goto error3;
+        if (column->type == CSVColumnType_string && !(column->text = 
+            newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+            CSV_PARSER_DEFAULT_BUFFER_SIZE, sizeof(char), 0)))
+            goto error3;
+    }
+    loader.table = ret;
+    loader.column = 0;
+    loader.isHeader = flags & CSVTableFlags_header;
+    if (!(parser = newCSVParser(delimiter, 0, onFieldCSVTable, onRowCSVTable,
+        &loader)))
+        goto error3;
+    if (feedCSVParser(parser, csvtext, n) || finishCSVParser(parser))
+        goto error4;
+    deleteCSVParser(parser);
+    return ret;
+error4:;
+    deleteCSVParser(parser);
+error3:;
+    for (size_t i = 0; i < nColumns; i++) {
+        deleteArray(ret->columns[i].values);
+        deleteArray(ret->columns[i].text);
+    }
+    free(ret->columns);
+error2:;
+    free(ret);
 error1:;
     return NULL;
 }
+
+void
+deleteCSVTable(CSVTable *table)
+{
+    if (!table)
+        return;
+    for (size_t i = 0; i < table->nColumns; i++) {
+        deleteArray(table->columns[i].values);
+        deleteArray(table->columns[i].text);
+    }
+    free(table->columns);
+    free(table);
+}
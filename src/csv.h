@@ -3,8 +3,207 @@
 
 /* aidan bird 2021 */
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "./array.h"
 #include "./vlarray.h"
 
+/* 
+ * the errors returned by the csv parser. They are negative, so callbacks 
+ * should stop the parser with positive values.
+ */
+#define CSV_PARSER_FIELD_TOO_LONG -1
+#define CSV_PARSER_UNTERMINATED_QUOTE -2
+#define CSV_PARSER_NO_MEMORY -3
+#define CSV_PARSER_BAD_NUMBER -4
+
+typedef struct CSVSpan CSVSpan;
+typedef struct CSVParser CSVParser;
+typedef struct CSVRows CSVRows;
+typedef struct CSVColumn CSVColumn;
+typedef struct CSVTable CSVTable;
+typedef int (*CSVFieldFunc)(void *ctx, const char *field, size_t n);
+typedef int (*CSVRowFunc)(void *ctx, size_t nFields);
+
+/*
+ * a field of csv text, as a view into the text it was split from.
+ * offset = the index of the first byte of the field in the text.
+ * length = the number of bytes in the field (not including the comma).
+ */
+struct CSVSpan
+{
+    size_t offset;
+    size_t length;
+};
+
+enum CSVParserState
+{
+    CSVParserState_fieldStart,
+    CSVParserState_unquoted,
+    CSVParserState_quoted,
+    CSVParserState_quoteInQuoted,
+};
+
+typedef enum CSVParserState CSVParserState;
+
+/* the type of each column of a CSVTable */
+enum CSVColumnType
+{
+    CSVColumnType_skip,
+    CSVColumnType_int64,
+    CSVColumnType_double,
+    CSVColumnType_string,
+};
+
+typedef enum CSVColumnType CSVColumnType;
+
+enum CSVTableFlags
+{
+    /* the first row is a header, and is not loaded */
+    CSVTableFlags_header = 1 << 0,
+};
+
+typedef enum CSVTableFlags CSVTableFlags;
+
+/*
+ * CSV PARSER DETAILS AND FIELDS
+ *
+ * a streaming RFC 4180 parser. Text is fed in chunks of any size (fields, 
+ * quotes and CRLFs may be split between chunks), and each field and row is
+ * passed to the callbacks as soon as it ends.
+ *
+ * onField, onRow, ctx = onField(ctx, field, n) is called for each field and
+ * onRow(ctx, nFields) after the last field of each row. onRow may be NULL.
+ * If a callback returns non-zero, parsing stops and feedCSVParser() returns
+ * that value.
+ * field is only valid during the call. Quotes are removed, and escaped 
+ * quotes ("") are replaced by a single quote. 
+ *
+ * buffer = the part of the current field that has been seen so far, when
+ * the field is split between chunks or contains escaped quotes. Other 
+ * fields are passed to onField straight from the chunk without copying. 
+ * Since buffer only ever holds one field, the memory of the parser is 
+ * bounded by the longest field (or maxFieldSize), not by the input.
+ *
+ * maxFieldSize = the longest field that is accepted (0 for no limit).
+ *
+ * state, segmentStart, segmentEnd = where the parser is in the current
+ * field, and the part of the current chunk that belongs to the field but
+ * has not been copied into buffer yet.
+ *
+ * skipLF = a row ended on a CR, so a LF at the start of the next chunk is
+ * part of the same CRLF.
+ *
+ * rows end on LF, CRLF or CR. Empty lines are skipped.
+ * A closing quote that is not followed by a delimiter or a row end is 
+ * accepted, and the rest of the field is kept as is (e.g., "a"b is a"b 
+ * without the first quote, i.e., ab).
+ */
+struct CSVParser
+{
+    char delimiter;
+    char skipLF;
+    CSVParserState state;
+    size_t maxFieldSize;
+    size_t segmentStart;
+    size_t segmentEnd;
+    size_t fieldCount;
+    size_t rowCount;
+    Array *buffer;
+    CSVFieldFunc onField;
+    CSVRowFunc onRow;
+    void *ctx;
+};
+
+/*
+ * CSV ROWS DETAILS AND FIELDS
+ *
+ * the rows of csv text, split by newCSVRows().
+ *
+ * fields = a CSVSpan for each field of each row, in order. The spans point
+ * into the text and cover the raw field, so quoted fields include their 
+ * quotes (see unquoteFieldCSV()).
+ *
+ * rows = (size_t) the index in fields of the first field of each row.
+ */
+struct CSVRows
+{
+    Array *fields;
+    Array *rows;
+};
+
+/*
+ * CSV TABLE DETAILS AND FIELDS
+ *
+ * csv text loaded into typed columns by newCSVTable(), with one Array (two
+ * for strings) per column instead of one allocation per field.
+ *
+ * columns = the nColumns columns, in the order of the schema. 
+ *
+ * values = for each of the nRows rows, the int64_t, double, or (for 
+ * strings) CSVSpan of the field. Empty numeric fields are 0 (int64) or NaN
+ * (double), and fields missing from the end of short rows are empty. 
+ * The values of skipped columns are NULL.
+ *
+ * text = the fields of a string column (unquoted), each null terminated.
+ * The CSVSpans of values point into text. NULL for other columns.
+ */
+struct CSVColumn
+{
+    CSVColumnType type;
+    Array *values;
+    Array *text;
+};
+
+struct CSVTable
+{
+    size_t nColumns;
+    size_t nRows;
+    CSVColumn *columns;
+};
+
+Array *newCSVSpans(const void *csvtext, size_t n);
 VLArray *newCSVRaw(const void *csvtext, size_t n);
+CSVParser *newCSVParser(char delimiter, size_t maxFieldSize,
+    CSVFieldFunc onField, CSVRowFunc onRow, void *ctx);
+void deleteCSVParser(CSVParser *parser);
+int feedCSVParser(CSVParser *parser, const void *chunk, size_t n);
+int finishCSVParser(CSVParser *parser);
+CSVRows *newCSVRows(const void *csvtext, size_t n, char delimiter,
+    int nThreads);
+void deleteCSVRows(CSVRows *rows);
+size_t unquoteFieldCSV(const void *csvtext, const CSVSpan *span, char *out);
+CSVTable *newCSVTable(const void *csvtext, size_t n, char delimiter,
+    const CSVColumnType *schema, size_t nColumns, int flags);
+void deleteCSVTable(CSVTable *table);
+
+#define getSpanCSV(SPANS_PTR, INDEX) \
+    ((CSVSpan *)getElementArray((SPANS_PTR), (INDEX)))
+#define getFieldCSV(CSVTEXT, SPAN_PTR) \
+    ((const char *)(CSVTEXT) + (SPAN_PTR)->offset)
+#define getRowCountCSVParser(PARSER_PTR) ((PARSER_PTR)->rowCount)
+#define getRowCountCSVRows(ROWS_PTR) (getCountArray((ROWS_PTR)->rows))
+#define getFirstFieldCSVRows(ROWS_PTR, ROW) \
+    (*(size_t *)getElementArray((ROWS_PTR)->rows, (ROW)))
+#define getFieldCountCSVRows(ROWS_PTR, ROW) \
+    (((ROW) + 1 < getRowCountCSVRows(ROWS_PTR) \
+    ? getFirstFieldCSVRows((ROWS_PTR), (ROW) + 1) \
+    : getCountArray((ROWS_PTR)->fields)) \
+    - getFirstFieldCSVRows((ROWS_PTR), (ROW)))
+#define getFieldCSVRows(ROWS_PTR, ROW, COLUMN) \
+    (getSpanCSV((ROWS_PTR)->fields, \
+    getFirstFieldCSVRows((ROWS_PTR), (ROW)) + (COLUMN)))
+#define getColumnCSVTable(TABLE_PTR, COLUMN) (&(TABLE_PTR)->columns[(COLUMN)])
+#define getInt64CSVTable(TABLE_PTR, ROW, COLUMN) \
+    (*(int64_t *)getElementArray( \
+    getColumnCSVTable((TABLE_PTR), (COLUMN))->values, (ROW)))
+#define getDoubleCSVTable(TABLE_PTR, ROW, COLUMN) \
+    (*(double *)getElementArray( \
+    getColumnCSVTable((TABLE_PTR), (COLUMN))->values, (ROW)))
+#define getStringCSVTable(TABLE_PTR, ROW, COLUMN) \
+    ((char *)getElementArray(getColumnCSVTable((TABLE_PTR), (COLUMN))->text,\
+    getSpanCSV(getColumnCSVTable((TABLE_PTR), (COLUMN))->values, \
+    (ROW))->offset))
 
 #endif
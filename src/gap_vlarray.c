@@ -0,0 +1,370 @@
+/* Aidan Bird 2021 */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gap_vlarray.h"
+#include "utils.h"
+
+#define GAP_VLARRAY_DEFAULT_CAPACITY 32
+#define GAP_VLARRAY_DEFAULT_DATA_CAPACITY 512
+
+static VLArrayEntry *getEntryGapVLArray(const GapVLArray *arr, size_t index);
+static int growIndexGapVLArray(GapVLArray *arr, size_t n);
+static int growDataGapVLArray(GapVLArray *arr, size_t n);
+
+/*
+ * REQUIRES
+ * none
+ *
+ * MODIFIES
+ * none
+ *
+ * EFFECTS
+ * constructs a new GapVLArray with room for capacity elements that are
+ * dataCapacity bytes long in total.
+ * if capacity <= 0 or dataCapacity <= 0, then the defaults are used.
+ * returns null on error
+ */
+GapVLArray *
+newGapVLArray(int capacity, int dataCapacity)
+{
+    GapVLArray *ret;
+
+    capacity = capacity <= 0 ? GAP_VLARRAY_DEFAULT_CAPACITY : capacity;
+    dataCapacity = dataCapacity <= 0 ? GAP_VLARRAY_DEFAULT_DATA_CAPACITY
+        : dataCapacity;
+    if (!(ret = malloc(sizeof(GapVLArray))))
+        goto error1;
+    if (!(ret->index = malloc(sizeof(VLArrayEntry) * capacity)))
+        goto error2;
+    if (!(ret->data = malloc(dataCapacity)))
+        goto error3;
+    ret->indexCapacity = capacity;
+    ret->dataCapacity = dataCapacity;
+    clearGapVLArray(ret);
+    return ret;
+error3:;
+    free(ret->index);
+error2:;
+    free(ret);
+error1:;
+    return NULL;
+}
+
+/*
+ * REQUIRES
+ * arr is valid
+ *
+ * MODIFIES
+ * arr
+ *
+ * EFFECTS
+ * deletes arr
+ */
+void
+deleteGapVLArray(GapVLArray *arr)
+{
+    free(arr->index);
+    free(arr->data);
+    free(arr);
+}
+
+/*
+ * REQUIRES
+ * index < arr.count
+ *
+ * EFFECTS
+ * returns the index entry of the element at index (see GapVLArray in
+ * gap_vlarray.h for how its offset is counted).
+ */
+static VLArrayEntry *
+getEntryGapVLArray(const GapVLArray *arr, size_t index)
+{
+    return index < arr->cursor ? arr->index + index
+        : arr->index + arr->indexCapacity - arr->count + index;
+}
+
+/*
+ * REQUIRES
+ * index < arr.count
+ *
+ * EFFECTS
+ * returns a pointer to the element at index.
+ * the pointer is valid until arr is modified.
+ */
+void *
+getElementGapVLArray(const GapVLArray *arr, size_t index)
+{
+    const VLArrayEntry *entry;
+
+    entry = getEntryGapVLArray(arr, index);
+    return index < arr->cursor ? arr->data + entry->offset
+        : arr->data + arr->dataCapacity - entry->offset;
+}
+
+/*
+ * REQUIRES
+ * index < arr.count
+ *
+ * EFFECTS
+ * returns the size of the element at index in bytes.
+ */
+size_t
+sizeOfElementGapVLArray(const GapVLArray *arr, size_t index)
+{
+    return getEntryGapVLArray(arr, index)->size;
+}
+
+/*
+ * MODIFIES
+ * arr
+ *
+ * EFFECTS
+ * makes room in the index gap for n more elements. The entries after the
+ * gap are moved to the end of the new index.
+ * returns non-zero on error
+ */
+static int
+growIndexGapVLArray(GapVLArray *arr, size_t n)
+{
+    VLArrayEntry *tmp;
+    size_t nAfter;
+    size_t capacity;
+
+    if (arr->count + n <= arr->indexCapacity)
+        return 0;
+    capacity = MAX(arr->indexCapacity * 2, arr->count + n);
+    if (!(tmp = realloc(arr->index, sizeof(VLArrayEntry) * capacity)))
+        return -1;
+    nAfter = arr->count - arr->cursor;
+    memmove(tmp + capacity - nAfter, tmp + arr->indexCapacity - nAfter,
+        sizeof(VLArrayEntry) * nAfter);
+    arr->index = tmp;
+    arr->indexCapacity = capacity;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * arr
+ *
+ * EFFECTS
+ * makes the data gap at least n bytes long. The bytes after the gap are
+ * moved to the end of the new data, so the offsets of the entries after
+ * the gap do not change.
+ * returns non-zero on error
+ */
+static int
+growDataGapVLArray(GapVLArray *arr, size_t n)
+{
+    uint8_t *tmp;
+    size_t nAfter;
+    size_t capacity;
+
+    if (arr->gapEnd - arr->gapStart >= n)
+        return 0;
+    nAfter = arr->dataCapacity - arr->gapEnd;
+    capacity = MAX(arr->dataCapacity * 2, arr->gapStart + nAfter + n);
+    if (!(tmp = realloc(arr->data, capacity)))
+        return -1;
+    memmove(tmp + capacity - nAfter, tmp + arr->gapEnd, nAfter);
+    arr->data = tmp;
+    arr->gapEnd = capacity - nAfter;
+    arr->dataCapacity = capacity;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * arr
+ *
+ * EFFECTS
+ * moves the gaps so that the elements before index are before them and
+ * the rest are after them.
+ * takes O(|index - cursor|) time, plus the size of the elements in between.
+ * returns non-zero if index > arr.count
+ */
+int
+moveCursorGapVLArray(GapVLArray *arr, size_t index)
+{
+    VLArrayEntry *entries;
+    const VLArrayEntry *from;
+    size_t nAfter;
+    size_t gapSize;
+    size_t first;
+    size_t end;
+
+    if (index > arr->count)
+        return -1;
+    entries = arr->index;
+    nAfter = arr->count - arr->cursor;
+    gapSize = arr->gapEnd - arr->gapStart;
+    if (index < arr->cursor) {
+        /* move elements [index, cursor) to the front of the after part */
+        first = entries[index].offset;
+        memmove(arr->data + arr->gapEnd - (arr->gapStart - first),
+            arr->data + first, arr->gapStart - first);
+        /* backwards, since the entries may overlap their new place */
+        from = entries + arr->indexCapacity - nAfter - arr->cursor;
+        for (size_t i = arr->cursor; i-- > index;) {
+            entries[from - entries + i] = (VLArrayEntry){
+                .offset = arr->dataCapacity - gapSize - entries[i].offset,
+                .size = entries[i].size,
+            };
+        }
+        arr->gapEnd -= arr->gapStart - first;
+        arr->gapStart = first;
+    } else if (index > arr->cursor) {
+        /* move elements [cursor, index) to the back of the before part */
+        end = index == arr->count ? arr->dataCapacity
+            : (size_t)((uint8_t *)getElementGapVLArray(arr, index)
+            - arr->data);
+        memmove(arr->data + arr->gapStart, arr->data + arr->gapEnd,
+            end - arr->gapEnd);
+        from = entries + arr->indexCapacity - nAfter - arr->cursor;
+        for (size_t i = arr->cursor; i < index; i++) {
+            entries[i] = (VLArrayEntry){
+                .offset = arr->dataCapacity - gapSize - from[i].offset,
+                .size = from[i].size,
+            };
+        }
+        arr->gapStart += end - arr->gapEnd;
+        arr->gapEnd = end;
+    }
+    arr->cursor = index;
+    return 0;
+}
+
+/*
+ * REQUIRES
+ * arr is valid
+ *
+ * MODIFIES
+ * arr
+ *
+ * EFFECTS
+ * inserts an element that is elementSize bytes long at index, and moves the
+ * cursor after it. Inserting the next element after it (or at the cursor)
+ * takes O(elementSize) amortized time. see moveCursorGapVLArray() for the
+ * cost of inserting elsewhere.
+ * if element is NULL, this will only reserve space.
+ * returns non-zero on error
+ */
+int
+insertGapVLArray(GapVLArray *arr, const void *element, size_t elementSize,
+    size_t index)
+{
+    if (index > arr->count || elementSize > UINT32_MAX)
+        return -1;
+    if (growIndexGapVLArray(arr, 1) || growDataGapVLArray(arr, elementSize))
+        return -1;
+    moveCursorGapVLArray(arr, index);
+    if (element)
+        memcpy(arr->data + arr->gapStart, element, elementSize);
+    arr->index[arr->cursor].offset = arr->gapStart;
+    arr->index[arr->cursor].size = elementSize;
+    arr->gapStart += elementSize;
+    arr->cursor++;
+    arr->count++;
+    arr->totalSize += elementSize;
+    return 0;
+}
+
+/*
+ * EFFECTS
+ * inserts an element at the end of arr.
+ * see insertGapVLArray()
+ */
+int
+pushGapVLArray(GapVLArray *arr, const void *element, size_t elementSize)
+{
+    return insertGapVLArray(arr, element, elementSize, arr->count);
+}
+
+/*
+ * REQUIRES
+ * arr is valid
+ *
+ * MODIFIES
+ * arr
+ * outElement
+ *
+ * EFFECTS
+ * removes the element at index, and moves the cursor to where it was.
+ * If outElement is not NULL, the removed element will be copied to
+ * outElement.
+ * Removing the element before or after the cursor takes O(1) time. see
+ * moveCursorGapVLArray() for the cost of removing elsewhere.
+ * returns non-zero on error
+ */
+int
+removeAtGapVLArray(GapVLArray *arr, void *outElement, size_t index)
+{
+    VLArrayEntry *entry;
+
+    if (index >= arr->count)
+        return -1;
+    if (index < arr->cursor) {
+        /* the element is the last one before the gap */
+        moveCursorGapVLArray(arr, index + 1);
+        entry = getEntryGapVLArray(arr, index);
+        if (outElement)
+            memcpy(outElement, arr->data + entry->offset, entry->size);
+        arr->gapStart = entry->offset;
+        arr->cursor--;
+    } else {
+        /* the element is the first one after the gap */
+        moveCursorGapVLArray(arr, index);
+        entry = getEntryGapVLArray(arr, index);
+        if (outElement)
+            memcpy(outElement, arr->data + arr->gapEnd, entry->size);
+        arr->gapEnd += entry->size;
+    }
+    arr->totalSize -= entry->size;
+    arr->count--;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * arr
+ *
+ * EFFECTS
+ * removes all elements from arr. This does not change its capacity.
+ */
+void
+clearGapVLArray(GapVLArray *arr)
+{
+    arr->count = 0;
+    arr->cursor = 0;
+    arr->gapStart = 0;
+    arr->gapEnd = arr->dataCapacity;
+    arr->totalSize = 0;
+}
+
+/*
+ * EFFECTS
+ * returns a packed VLArray with a copy of the elements of arr, in order.
+ * returns null on error
+ */
+VLArray *
+toVLArrayGapVLArray(const GapVLArray *arr)
+{
+    VLArray *ret;
+
+    if (!(ret = newVLArrayPacked(-1, MAX(arr->count, 1), 1)))
+        goto error1;
+    if (!reserveVLArray(ret, arr->count, arr->totalSize))
+        goto error2;
+    for (size_t i = 0; i < arr->count; i++) {
+        if (!tryPushVLArray(&ret, getElementGapVLArray(arr, i),
+            sizeOfElementGapVLArray(arr, i)))
+            goto error2;
+    }
+    return ret;
+error2:;
+    deleteVLArray(ret);
+error1:;
+    return NULL;
+}
@@ -0,0 +1,77 @@
+#ifndef ALIB_GAP_VLARRAY_H
+#define ALIB_GAP_VLARRAY_H
+
+/*
+ * An array with variable length elements (like VLArray) that is stored as a
+ * gap buffer, so inserting and removing elements near the last edit (the
+ * cursor) is cheap even in the middle of the array.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vlarray.h"
+
+#define getCountGapVLArray(GAP_VLARRAY_PTR) ((GAP_VLARRAY_PTR)->count)
+#define getCursorGapVLArray(GAP_VLARRAY_PTR) ((GAP_VLARRAY_PTR)->cursor)
+#define getSizeGapVLArray(GAP_VLARRAY_PTR) ((GAP_VLARRAY_PTR)->totalSize)
+#define isEmptyGapVLArray(GAP_VLARRAY_PTR) \
+    (!getCountGapVLArray(GAP_VLARRAY_PTR))
+
+typedef struct GapVLArray GapVLArray;
+
+GapVLArray *newGapVLArray(int capacity, int dataCapacity);
+void deleteGapVLArray(GapVLArray *arr);
+int insertGapVLArray(GapVLArray *arr, const void *element, size_t elementSize,
+    size_t index);
+int pushGapVLArray(GapVLArray *arr, const void *element, size_t elementSize);
+int removeAtGapVLArray(GapVLArray *arr, void *outElement, size_t index);
+void clearGapVLArray(GapVLArray *arr);
+int moveCursorGapVLArray(GapVLArray *arr, size_t index);
+void *getElementGapVLArray(const GapVLArray *arr, size_t index);
+size_t sizeOfElementGapVLArray(const GapVLArray *arr, size_t index);
+VLArray *toVLArrayGapVLArray(const GapVLArray *arr);
+
+/*
+ * GAP VLARRAY DETAILS AND FIELDS
+ *
+ * Both the elements and their index entries are split in two at the
+ * cursor, with unused space (the gap) in between:
+ *
+ * data:  [elements before cursor][     gap      ][elements at/after cursor]
+ *        0                 gapStart         gapEnd            dataCapacity
+ * index: [entries before cursor][     gap      ][entries at/after cursor]
+ *        0                    cursor   indexCapacity - (count - cursor)
+ *
+ * Inserting or removing at the cursor only touches the edges of the gaps,
+ * so it takes O(elementSize) amortized time. Inserting or removing at
+ * another index first moves the cursor there, which moves the elements in
+ * between across the gap: O(distance) time, instead of the O(n) that
+ * insertVLArray() and removeAtVLArray() take. Editing near the last edit
+ * (e.g., typing in an editor) stays cheap however large the array is.
+ *
+ * The offset of an entry before the cursor is counted from the start of
+ * data, and the offset of an entry after the cursor is counted back from
+ * the end of data (dataCapacity - the address of the element). So when the
+ * cursor moves, only the entries that cross the gap change, and growing
+ * data (which moves the elements after the gap to the new end) does not
+ * change any offsets.
+ *
+ * Elements are packed (no frames or padding), and totalSize is the sum of
+ * their sizes.
+ */
+
+struct GapVLArray
+{
+    VLArrayEntry *index;
+    uint8_t *data;
+    size_t count;
+    size_t cursor;
+    size_t indexCapacity;
+    size_t gapStart;
+    size_t gapEnd;
+    size_t dataCapacity;
+    size_t totalSize;
+};
+
+#endif
@@ -1,98 +1,499 @@
 #include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 #include "./hashing.h"
 
-/* 
- * lookup table for crc32 algorithm
- * table source:
- * <https://docs.microsoft.com/en-us/openspecs/office_protocols/ms-abs/06966aa2-70da-4bf9-8448-3355f277cd77?redirectedfrom=MSDN>
- */ 
-static const uint32_t crc32lut[] = {
-    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba,
-    0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
-    0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-    0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
-    0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de,
-    0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec,
-    0x14015c4f, 0x63066cd9, 0xfa0f3d63, 0x8d080df5,
-    0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-    0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
-    0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940,
-    0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116,
-    0x21b4f4b5, 0x56b3c423, 0xcfba9599, 0xb8bda50f,
-    0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-    0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,
-    0x76dc4190, 0x01db7106, 0x98d220bc, 0xefd5102a,
-    0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818,
-    0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
-    0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-    0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457,
-    0x65b0d9c6, 0x12b7e950, 0x8bbeb8ea, 0xfcb9887c,
-    0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2,
-    0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb,
-    0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-    0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9,
-    0x5005713c, 0x270241aa, 0xbe0b1010, 0xc90c2086,
-    0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4,
-    0x59b33d17, 0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad,
-    0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-    0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683,
-    0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8,
-    0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe,
-    0xf762575d, 0x806567cb, 0x196c3671, 0x6e6b06e7,
-    0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-    0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
-    0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252,
-    0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60,
-    0xdf60efc3, 0xa867df55, 0x316e8eef, 0x4669be79,
-    0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-    0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f,
-    0xc5ba3bbe, 0xb2bd0b28, 0x2bb45a92, 0x5cb36a04,
-    0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a,
-    0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
-    0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-    0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21,
-    0x86d3d2d4, 0xf1d4e242, 0x68ddb3f8, 0x1fda836e,
-    0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c,
-    0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45,
-    0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-    0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db,
-    0xaed16a4a, 0xd9d65adc, 0x40df0b66, 0x37d83bf0,
-    0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6,
-    0xbad03605, 0xcdd70693, 0x54de5729, 0x23d967bf,
-    0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
+/* reflected CRC polynomials */
+#define CRC32_POLY 0xedb88320u
+#define CRC32C_POLY 0x82f63b78u
+
+#define loadLE32(PTR) \
+    ((uint32_t)(PTR)[0] | (uint32_t)(PTR)[1] << 8 \
+    | (uint32_t)(PTR)[2] << 16 | (uint32_t)(PTR)[3] << 24)
+
+#define loadLE64(PTR) \
+    ((uint64_t)loadLE32(PTR) | (uint64_t)loadLE32((PTR) + 4) << 32)
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HASHING_HAS_SSE42
+#endif
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128;
+#endif
+
+/*
+ * the 64 bit odd constants that mixHash64() mixes with.
+ * (the same constants as wyhash)
+ */
+static const uint64_t mixSecret[4] = {
+    UINT64_C(0x2d358dccaa6c78a5), UINT64_C(0x8bb84b93962eacc9),
+    UINT64_C(0x4b33a62ed433d4a3), UINT64_C(0x4d5a2da51de1aa47),
 };
 
+static void initHashing(void);
+
+/*
+ * slicing-by-8 lookup tables.
+ * tables[0] is the usual byte at a time table of the polynomial, and
+ * tables[k][i] is the CRC of byte i followed by k zero bytes. This lets 8
+ * bytes be folded into the CRC with 8 independent lookups instead of a
+ * chain of 8 dependent ones.
+ * the tables are filled by initHashing(), which runs before main() on
+ * compilers with constructors (and on the first call otherwise).
+ */
+static uint32_t crc32Tables[8][256];
+static uint32_t crc32cTables[8][256];
+static int isInitialized;
+static int hasSSE42;
+static uint64_t randomSeed;
+
+#ifdef __GNUC__
+static void initHashingConstructor(void) __attribute__((constructor));
+
+static void
+initHashingConstructor(void)
+{
+    initHashing();
+}
+#endif
+
+static void
+initSlicingTables(uint32_t tables[8][256], uint32_t poly)
+{
+    uint32_t crc;
+
+    for (uint32_t i = 0; i < 256; i++) {
+        crc = i;
+        for (int j = 0; j < 8; j++)
+            crc = crc & 1 ? (crc >> 1) ^ poly : crc >> 1;
+        tables[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            tables[k][i] = (tables[k - 1][i] >> 8)
+                ^ tables[0][tables[k - 1][i] & 0xff];
+        }
+    }
+}
+
+/*
+ * EFFECTS
+ * returns a seed that is different for each process.
+ * reads /dev/urandom when it exists, and mixes the time and the address of
+ * a local (randomized by ASLR) otherwise.
+ */
+static uint64_t
+makeRandomSeed(void)
+{
+    FILE *fp;
+    uint64_t ret;
+    int isRead;
+
+    ret = 0;
+    isRead = 0;
+    if ((fp = fopen("/dev/urandom", "rb"))) {
+        isRead = fread(&ret, sizeof(ret), 1, fp) == 1;
+        fclose(fp);
+    }
+    if (!isRead) {
+        ret = mixHash64((const uint8_t *)&(time_t){ time(NULL) },
+            sizeof(time_t), (uint64_t)(uintptr_t)&ret ^ (uint64_t)clock());
+    }
+    return ret;
+}
+
+static void
+initHashing(void)
+{
+    if (isInitialized)
+        return;
+    initSlicingTables(crc32Tables, CRC32_POLY);
+    initSlicingTables(crc32cTables, CRC32C_POLY);
+    randomSeed = makeRandomSeed();
+#ifdef HASHING_HAS_SSE42
+    __builtin_cpu_init();
+    hasSSE42 = __builtin_cpu_supports("sse4.2");
+#endif
+    isInitialized = 1;
+}
+
+/*
+ * EFFECTS
+ * folds n bytes of data into crc (which is not pre or post inverted) using
+ * the slicing-by-8 tables of a polynomial.
+ */
+static uint32_t
+crcSlicingBy8(uint32_t tables[8][256], uint32_t crc, const uint8_t *data,
+    size_t n)
+{
+    uint32_t lo;
+    uint32_t hi;
+
+    for (; n >= 8; n -= 8, data += 8) {
+        lo = loadLE32(data) ^ crc;
+        hi = loadLE32(data + 4);
+        crc = tables[7][lo & 0xff] ^ tables[6][(lo >> 8) & 0xff]
+            ^ tables[5][(lo >> 16) & 0xff] ^ tables[4][lo >> 24]
+            ^ tables[3][hi & 0xff] ^ tables[2][(hi >> 8) & 0xff]
+            ^ tables[1][(hi >> 16) & 0xff] ^ tables[0][hi >> 24];
+    }
+    for (; n; n--, data++)
+        crc = (crc >> 8) ^ tables[0][(crc ^ *data) & 0xff];
+    return crc;
+}
+
+#ifdef HASHING_HAS_SSE42
+/*
+ * EFFECTS
+ * same as crcSlicingBy8() with the crc32c tables, but uses the SSE4.2 crc32
+ * instruction (8 bytes per instruction).
+ */
+__attribute__((target("sse4.2")))
+static uint32_t
+crc32cSSE42(uint32_t crc, const uint8_t *data, size_t n)
+{
+    uint64_t crc64;
+    uint64_t next;
+
+    crc64 = crc;
+    for (; n >= 8; n -= 8, data += 8) {
+        memcpy(&next, data, sizeof(next));
+        crc64 = __builtin_ia32_crc32di(crc64, next);
+    }
+    crc = (uint32_t)crc64;
+    for (; n; n--, data++)
+        crc = __builtin_ia32_crc32qi(crc, *data);
+    return crc;
+}
+#endif
+
 /*
  * hash function for the hash table
  *
+ * the standard (IEEE 802.3, zlib) CRC-32.
  * algorithm based on these pseudocodes
  * <https://docs.microsoft.com/en-us/openspecs/office_protocols/ms-abs/06966aa2-70da-4bf9-8448-3355f277cd77?redirectedfrom=MSDN>
- * and 
+ * and
  * <https://en.wikipedia.org/wiki/Cyclic_redundancy_check#CRC-32_algorithm>
- */ 
+ * and processes 8 bytes per iteration using slicing-by-8.
+ */
 uint32_t
 crc32(const uint8_t *data, size_t n)
+{
+    initHashing();
+    return ~crcSlicingBy8(crc32Tables, ~(uint32_t)0, data, n);
+}
+
+/*
+ * hash function for the hash table
+ *
+ * CRC-32C (Castagnoli polynomial).
+ * uses the SSE4.2 crc32 instruction if the CPU supports it, and
+ * slicing-by-8 otherwise. Both produce the same hashes.
+ * Prefer this over crc32() when the hashes do not need to match the
+ * standard CRC-32.
+ */
+uint32_t
+crc32c(const uint8_t *data, size_t n)
+{
+    initHashing();
+#ifdef HASHING_HAS_SSE42
+    if (hasSSE42)
+        return ~crc32cSSE42(~(uint32_t)0, data, n);
+#endif
+    return ~crcSlicingBy8(crc32cTables, ~(uint32_t)0, data, n);
+}
+
+/*
+ * EFFECTS
+ * same as crc32c(), but never uses the SSE4.2 crc32 instruction.
+ */
+uint32_t
+crc32cPortable(const uint8_t *data, size_t n)
+{
+    initHashing();
+    return ~crcSlicingBy8(crc32cTables, ~(uint32_t)0, data, n);
+}
+
+/*
+ * MODIFIES
+ * ctx
+ *
+ * EFFECTS
+ * starts a CRC-32 that is computed a piece at a time, e.g., to checksum a 
+ * file that does not fit in memory:
+ *   crc32Init(&ctx);
+ *   while ((n = fread(buf, 1, sizeof(buf), fp)))
+ *       crc32Update(&ctx, buf, n);
+ *   crc = crc32Final(&ctx);
+ * gives the same result as crc32() over all of the pieces at once.
+ */
+void
+crc32Init(CRC32Context *ctx)
+{
+    initHashing();
+    ctx->crc = ~(uint32_t)0;
+    ctx->n = 0;
+}
+
+/*
+ * REQUIRES
+ * ctx was initialized by crc32Init()
+ *
+ * MODIFIES
+ * ctx
+ *
+ * EFFECTS
+ * adds the n bytes of data to the CRC of ctx.
+ */
+void
+crc32Update(CRC32Context *ctx, const uint8_t *data, size_t n)
+{
+    ctx->crc = crcSlicingBy8(crc32Tables, ctx->crc, data, n);
+    ctx->n += n;
+}
+
+/*
+ * REQUIRES
+ * ctx was initialized by crc32Init()
+ *
+ * EFFECTS
+ * returns the CRC-32 of the bytes added to ctx so far.
+ * ctx is not changed, so more bytes can still be added.
+ */
+uint32_t
+crc32Final(const CRC32Context *ctx)
+{
+    return ~ctx->crc;
+}
+
+/*
+ * EFFECTS
+ * returns mat * vec, where mat is a 32x32 matrix over GF(2) whose columns
+ * are mat[0] ... mat[31].
+ */
+static uint32_t
+gf2MatrixTimes(const uint32_t *mat, uint32_t vec)
 {
     uint32_t ret;
-    uint32_t j;
 
-    ret = ~0;
-    for (size_t i = 0; i < n; i++) {
-        j = (ret ^ (uint32_t)data[i]) & 0xFF;
-        ret = (ret >> 8) ^ crc32lut[j];
+    ret = 0;
+    for (; vec; vec >>= 1, mat++) {
+        if (vec & 1)
+            ret ^= *mat;
     }
-    return ~ret;
+    return ret;
+}
+
+/*
+ * MODIFIES
+ * square
+ *
+ * EFFECTS
+ * sets square to mat * mat.
+ */
+static void
+gf2MatrixSquare(uint32_t *square, const uint32_t *mat)
+{
+    for (int i = 0; i < 32; i++)
+        square[i] = gf2MatrixTimes(mat, mat[i]);
 }
 
+/*
+ * EFFECTS
+ * returns the CRC-32 of A followed by B, given crcA = crc32(A), 
+ * crcB = crc32(B), and lenB = the length of B in bytes.
+ * A large input can be split into pieces whose CRCs are computed 
+ * independently (e.g., on different threads) and then combined in order.
+ * Appending lenB bytes to A is a linear map of the CRC register, so it is 
+ * applied as a 32x32 matrix over GF(2) that is raised to the power lenB by 
+ * repeated squaring (the same method as zlib). This takes O(log(lenB)) 
+ * matrix squarings instead of O(lenB) table lookups.
+ */
+uint32_t
+crc32Combine(uint32_t crcA, uint32_t crcB, uint64_t lenB)
+{
+    uint32_t even[32];
+    uint32_t odd[32];
+    uint32_t row;
+
+    if (!lenB)
+        return crcA;
+    /* odd is the operator for one zero bit */
+    odd[0] = CRC32_POLY;
+    row = 1;
+    for (int i = 1; i < 32; i++) {
+        odd[i] = row;
+        row <<= 1;
+    }
+    /* two zero bits, then four */
+    gf2MatrixSquare(even, odd);
+    gf2MatrixSquare(odd, even);
+    /* 
+     * apply lenB zero bytes to crcA: even and odd take turns being the 
+     * operator for 2^k zero bytes.
+     */
+    for (;;) {
+        gf2MatrixSquare(even, odd);
+        if (lenB & 1)
+            crcA = gf2MatrixTimes(even, crcA);
+        if (!(lenB >>= 1))
+            break;
+        gf2MatrixSquare(odd, even);
+        if (lenB & 1)
+            crcA = gf2MatrixTimes(odd, crcA);
+        if (!(lenB >>= 1))
+            break;
+    }
+    return crcA ^ crcB;
+}
+
+/*
+ * EFFECTS
+ * sets *lo and *hi to the low and high halves of the 128 bit product a * b.
+ */
+static void
+multiply128(uint64_t a, uint64_t b, uint64_t *lo, uint64_t *hi)
+{
+#ifdef __SIZEOF_INT128__
+    uint128 product;
+
+    product = (uint128)a * b;
+    *lo = (uint64_t)product;
+    *hi = (uint64_t)(product >> 64);
+#else
+    uint64_t aLo;
+    uint64_t aHi;
+    uint64_t bLo;
+    uint64_t bHi;
+    uint64_t mid1;
+    uint64_t mid2;
+    uint64_t carry;
+
+    aLo = (uint32_t)a;
+    aHi = a >> 32;
+    bLo = (uint32_t)b;
+    bHi = b >> 32;
+    mid1 = aHi * bLo;
+    mid2 = aLo * bHi;
+    *lo = aLo * bLo;
+    carry = ((*lo >> 32) + (uint32_t)mid1 + (uint32_t)mid2) >> 32;
+    *lo += (mid1 << 32) + (mid2 << 32);
+    *hi = aHi * bHi + (mid1 >> 32) + (mid2 >> 32) + carry;
+#endif
+}
+
+/*
+ * EFFECTS
+ * multiplies a and b into 128 bits and folds the halves together.
+ * every input bit affects every output bit, which is what gives
+ * mixHash64() its avalanche.
+ */
+static uint64_t
+mix64(uint64_t a, uint64_t b)
+{
+    uint64_t lo;
+    uint64_t hi;
+
+    multiply128(a, b, &lo, &hi);
+    return lo ^ hi;
+}
+
+/*
+ * hash function for the hash table
+ *
+ * a fast, seeded, non-cryptographic 64 bit hash in the style of wyhash:
+ * the input is read 16 bytes at a time (in 3 independent lanes for long
+ * inputs), and each pair of 64 bit words is mixed with a 64x64 -> 128 bit
+ * multiply. Unlike CRCs, which are linear, every output bit depends on
+ * every input bit, so the low (or high) bits can be used as a bucket index
+ * on their own.
+ * different seeds give unrelated hashes, so keys that collide for one seed
+ * (e.g., keys chosen by an attacker to flood a table) do not collide for 
+ * another. Use getRandomSeedHashing() for a seed that is different for
+ * each process.
+ * the hashes are the same on every platform.
+ */
+uint64_t
+mixHash64(const uint8_t *data, size_t n, uint64_t seed)
+{
+    uint64_t a;
+    uint64_t b;
+    uint64_t seed1;
+    uint64_t seed2;
+    size_t i;
+
+    seed ^= mix64(seed ^ mixSecret[0], mixSecret[1]);
+    if (n <= 16) {
+        if (n >= 4) {
+            /* two (possibly overlapping) 4 byte reads from each end */
+            a = (uint64_t)loadLE32(data) << 32
+                | loadLE32(data + ((n >> 3) << 2));
+            b = (uint64_t)loadLE32(data + n - 4) << 32
+                | loadLE32(data + n - 4 - ((n >> 3) << 2));
+        } else if (n) {
+            a = (uint64_t)data[0] << 16 | (uint64_t)data[n >> 1] << 8
+                | data[n - 1];
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
+        }
+    } else {
+        i = n;
+        if (i > 48) {
+            seed1 = seed;
+            seed2 = seed;
+            do {
+                seed = mix64(loadLE64(data) ^ mixSecret[1],
+                    loadLE64(data + 8) ^ seed);
+                seed1 = mix64(loadLE64(data + 16) ^ mixSecret[2],
+                    loadLE64(data + 24) ^ seed1);
+                seed2 = mix64(loadLE64(data + 32) ^ mixSecret[3],
+                    loadLE64(data + 40) ^ seed2);
+                data += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        for (; i > 16; i -= 16, data += 16) {
+            seed = mix64(loadLE64(data) ^ mixSecret[1],
+                loadLE64(data + 8) ^ seed);
+        }
+        /* the last 16 bytes (which may overlap the ones already mixed) */
+        a = loadLE64(data + i - 16);
+        b = loadLE64(data + i - 8);
+    }
+    multiply128(a ^ mixSecret[1], b ^ seed, &a, &b);
+    return mix64(a ^ mixSecret[0] ^ n, b ^ mixSecret[1]);
+}
+
+/*
+ * hash function for the hash table
+ *
+ * mixHash64() with the seed of this process, folded to 32 bits so it can be
+ * used as a HashFunc.
+ */
+uint32_t
+mixHash(const uint8_t *data, size_t n)
+{
+    uint64_t ret;
+
+    initHashing();
+    ret = mixHash64(data, n, randomSeed);
+    return (uint32_t)(ret ^ ret >> 32);
+}
+
+/*
+ * EFFECTS
+ * returns a random seed that was chosen when the process started.
+ */
+uint64_t
+getRandomSeedHashing(void)
+{
+    initHashing();
+    return randomSeed;
+}
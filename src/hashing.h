@@ -4,6 +4,28 @@
 #include <stdint.h>
 #include <stddef.h>
 
+typedef struct CRC32Context CRC32Context;
+
+/*
+ * the state of a CRC-32 that is computed a piece at a time.
+ * crc = the CRC register of the bytes so far (not post inverted).
+ * n = the number of bytes so far.
+ */
+struct CRC32Context
+{
+    uint32_t crc;
+    uint64_t n;
+};
+
 uint32_t crc32(const uint8_t *data, size_t n);
+uint32_t crc32c(const uint8_t *data, size_t n);
+uint32_t crc32cPortable(const uint8_t *data, size_t n);
+void crc32Init(CRC32Context *ctx);
+void crc32Update(CRC32Context *ctx, const uint8_t *data, size_t n);
+uint32_t crc32Final(const CRC32Context *ctx);
+uint32_t crc32Combine(uint32_t crcA, uint32_t crcB, uint64_t lenB);
+uint64_t mixHash64(const uint8_t *data, size_t n, uint64_t seed);
+uint32_t mixHash(const uint8_t *data, size_t n);
+uint64_t getRandomSeedHashing(void);
 
 #endif
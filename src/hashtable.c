@@ -1,3 +1,4 @@
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #ifdef ALIB_TESTING 
@@ -8,50 +9,135 @@
 #include "./utils.h"
 
 #define HASH_TABLE_DEFAULT_CAPACITY 32
+#define HASH_TABLE_MAX_PROBING_LOAD_FACTOR 0.9f
+#define HASH_TABLE_EMPTY_SLOT UINT32_MAX
+/* 
+ * the least number of old buckets that are migrated by each insert while an
+ * incremental resize is in progress. Tables with a small maxLoadFactor
+ * migrate more per insert (see resizeStep in hashtable.h).
+ */
+#define HASH_TABLE_RESIZE_STEP 4
+/* 
+ * the number of keys that getManyHashTable() hashes and prefetches at once.
+ * large enough to keep many cache misses in flight, small enough that the
+ * prefetched lines are not evicted before the keys are compared.
+ */
+#define HASH_TABLE_BATCH_SIZE 16
+/* keys are compared with memcmp, values are aligned for the common types */
+#define HASH_TABLE_KEY_ALIGNMENT 1
+#define HASH_TABLE_VALUE_ALIGNMENT 8
+
+#if defined(ALIB_HASH_TABLE_STATS) || defined(ALIB_TESTING)
+/* lookups take a const table, but the counters are not part of its state */
+#define countStatHashTable(HASH_TABLE_PTR, STAT) \
+    do { \
+        if (!((HASH_TABLE_PTR)->flags & HashTableFlags_noStats)) \
+            ((HashTable *)(HASH_TABLE_PTR))->stats.STAT++; \
+    } while (0)
+#else
+#define countStatHashTable(HASH_TABLE_PTR, STAT)
+#endif
 
-static void deleteBucketsByHashes(Array *buckets, const uint32_t *hashes,
-    size_t n);
+static Array *newBucketArray(size_t n);
+static size_t deleteBucketArray(Array *buckets);
+static Array *newSlots(size_t n);
+static int shiftForCount(size_t n);
+static int growBucketsHashTable(HashTable *ht, size_t n);
+static int pushBucketHashTable(HashTable *ht, const HashTableSlot *slot);
+static int insertBucketHashTable(HashTable *ht, uint32_t hash,
+    size_t kvIndex);
+static int insertSlotHashTable(HashTable *ht, uint32_t hash, size_t kvIndex);
+static float getMaxSlotLoadFactor(const HashTable *ht);
+static int pushKVHashTable(HashTable *ht, uint64_t hash, const uint8_t *key,
+    size_t nKey, const uint8_t *value, size_t nValue);
+static const HashTableSlot *findHashTable(const HashTable *ht, uint64_t hash,
+    const uint8_t *key, size_t nKey);
 
 /*
  * REQUIRES
  * hashFunc is a valid hash function
  *
  * EFFECTS
- * initializes a new hash table.
+ * initializes a new hash table that resolves collisions by chaining.
  */
 HashTable *
 newHashTable(HashFunc hashFunc, int capacity, float maxLoadFactor)
+{
+    return newHashTableWithFlags(hashFunc, capacity, maxLoadFactor,
+        HashTableFlags_none);
+}
+
+/*
+ * REQUIRES
+ * hashFunc is a valid hash function
+ *
+ * EFFECTS
+ * initializes a new hash table.
+ * flags is a combination of HashTableFlags.
+ * open addressing tables and tables with pow2Buckets round capacity up to a
+ * power of two.
+ * open addressing tables never use a load factor above 
+ * HASH_TABLE_MAX_PROBING_LOAD_FACTOR.
+ * keys are stored packed. values are stored in frames so they can be
+ * overwritten in place, unless the table is made with packedValues.
+ */
+HashTable *
+newHashTableWithFlags(HashFunc hashFunc, int capacity, float maxLoadFactor,
+    int flags)
 {
     HashTable *ret;
-    const void *nullElement = NULL;
 
     if (capacity < 0)
         capacity = HASH_TABLE_DEFAULT_CAPACITY;
     if (!(ret = malloc(sizeof(HashTable))))
         goto error1;
-    if (!(ret->keys = newVLArray(-1, capacity, -1)))
+    ret->flags = flags;
+    if (isPow2BucketsHashTable(ret)) {
+        capacity = nextPow2(MAX(capacity, 2));
+        ret->bucketShift = shiftForCount(capacity);
+    }
+    ret->records = NULL;
+    ret->oldRecords = NULL;
+    ret->slots = NULL;
+    /* keys are never overwritten, so they do not need frames */
+    if (!(ret->keys = newVLArrayPacked(-1, capacity,
+        HASH_TABLE_KEY_ALIGNMENT)))
         goto error2;
-    if (!(ret->values = newVLArray(-1, capacity, -1)))
+    if (!(ret->values = flags & HashTableFlags_packedValues 
+        ? newVLArrayPacked(-1, capacity, HASH_TABLE_VALUE_ALIGNMENT)
+        : newVLArray(-1, capacity, -1)))
         goto error3;
-    if (!(ret->records = newArray(-1, capacity, sizeof(Array *))))
-        goto error4;
-    if (!(ret->hashes = newArray(-1, capacity, sizeof(uint32_t))))
-        goto error5;
-    /* NULL elements denote uninitialized buckets */
-    for (size_t i = 0; i < capacity; i++) {
-        if (!(tryPushArray(&ret->records, &nullElement)))
-            goto error6;
+    if (isOpenAddressingHashTable(ret)) {
+        if (!(ret->slots = newSlots(capacity)))
+            goto error4;
+    } else {
+        if (!(ret->records = newBucketArray(capacity)))
+            goto error4;
     }
+    if (!(ret->hashes = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        capacity, getSizeofHashHashTable(ret), 0)))
+        goto error5;
+    if (!(ret->deadFlags = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        capacity, sizeof(char), 0)))
+        goto error6;
     ret->hashFunc = hashFunc;
+    ret->hashFunc64 = NULL;
+    ret->seed = 0;
     ret->loadFactor = 0.0;
     ret->nonEmptyBuckets = 0;
+    ret->deadCount = 0;
+    ret->oldBucketShift = 0;
+    ret->resizeIndex = 0;
+    ret->resizeStep = HASH_TABLE_RESIZE_STEP;
     ret->maxLoadFactor = maxLoadFactor;
     ret->isDirty = 0;
+    memset(&ret->stats, 0, sizeof(HashTableStats));
     return ret;
 error6:;
     deleteArray(ret->hashes);
 error5:;
     deleteArray(ret->records);
+    deleteArray(ret->slots);
 error4:;
     deleteVLArray(ret->values);
 error3:;
@@ -62,31 +148,126 @@ error1:;
     return NULL;
 }
 
-static void
-deleteBuckets(HashTable *ht)
+/*
+ * REQUIRES
+ * hashFunc64 is a valid 64 bit hash function
+ *
+ * EFFECTS
+ * same as newHashTableWithFlags(), but the keys are hashed using 
+ * hashFunc64(key, nKey, seed) (e.g., mixHash64() with 
+ * getRandomSeedHashing()).
+ * the table always uses power of two buckets (see hash64 tables in 
+ * hashtable.h).
+ */
+HashTable *
+newHashTable64(HashFunc64 hashFunc64, uint64_t seed, int capacity,
+    float maxLoadFactor, int flags)
 {
-    uint32_t hash;
+    HashTable *ret;
+
+    if (!(ret = newHashTableWithFlags(NULL, capacity, maxLoadFactor,
+        flags | HashTableFlags_hash64 | HashTableFlags_pow2Buckets)))
+        return NULL;
+    ret->hashFunc64 = hashFunc64;
+    ret->seed = seed;
+    return ret;
+}
+
+/*
+ * REQUIRES
+ * n is a power of two > 1
+ *
+ * EFFECTS
+ * returns the bucketShift for a table with n buckets.
+ */
+static int
+shiftForCount(size_t n)
+{
+    int ret;
+
+    ret = 32;
+    while (n > 1) {
+        n >>= 1;
+        ret--;
+    }
+    return ret;
+}
+
+/*
+ * EFFECTS
+ * makes a new (empty) bucket of HashTableSlots.
+ * returns NULL on error
+ */
+static Array *
+newBucket()
+{
+    return newArrayWithPolicy(ArrayGrowthPolicy_geometric, 1, 1,
+        sizeof(HashTableSlot), 0);
+}
+
+/*
+ * EFFECTS
+ * makes an array of n uninitialized (NULL) buckets.
+ * the buckets are zeroed in one step, so this takes no pushes.
+ * returns NULL on error
+ */
+static Array *
+newBucketArray(size_t n)
+{
+    Array *ret;
+
+    if (!(ret = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1, n,
+        sizeof(Array *), 0)))
+        return NULL;
+    /* NULL elements denote uninitialized buckets */
+    memset(ret->first, 0, n * sizeof(Array *));
+    ret->count = n;
+    return ret;
+}
+
+/*
+ * MODIFIES
+ * buckets
+ *
+ * EFFECTS
+ * deletes buckets and every bucket in it.
+ * returns the number of (non-empty) buckets that were deleted.
+ */
+static size_t
+deleteBucketArray(Array *buckets)
+{
+    size_t ret;
     Array **bucketPtr;
-    size_t bucketID;
-    size_t deleteCount; 
 
-    deleteCount = 0;
-    for (size_t i = 0; (i < getCountArray(ht->hashes))
-        && (deleteCount < ht->nonEmptyBuckets); i++) {
-        /* delete all buckets */
-        hash = getHashHashTable(ht, i);
-        bucketID = getBucketIDHashTable(ht, hash);
-        bucketPtr = getBucketPtrFromBucketIDHashTable(ht, bucketID);
+    if (!buckets)
+        return 0;
+    ret = 0;
+    for (size_t i = 0; i < getCountArray(buckets); i++) {
+        bucketPtr = (Array **)getElementArray(buckets, i);
         if (!*bucketPtr)
             continue;
         deleteArray(*bucketPtr);
-        *bucketPtr = NULL;
-        deleteCount++;
+        ret++;
     }
+    deleteArray(buckets);
+    return ret;
+}
+
+static void
+deleteBuckets(HashTable *ht)
+{
+    size_t deleteCount; 
+
+    deleteCount = deleteBucketArray(ht->records);
 #ifdef ALIB_TESTING 
     ck_assert_msg(deleteCount == ht->nonEmptyBuckets,
         "%ld buckets were not deleted", ht->nonEmptyBuckets - deleteCount);
+#else
+    (void)deleteCount;
 #endif
+    deleteBucketArray(ht->oldRecords);
+    ht->records = NULL;
+    ht->oldRecords = NULL;
     ht->nonEmptyBuckets = 0;
 }
 
@@ -102,9 +283,13 @@ deleteHashTable(HashTable *ht)
 {
     if (!ht)
         return;
-    deleteBuckets(ht);
-    deleteArray(ht->records);
+    if (isOpenAddressingHashTable(ht)) {
+        deleteArray(ht->slots);
+    } else {
+        deleteBuckets(ht);
+    }
     deleteArray(ht->hashes);
+    deleteArray(ht->deadFlags);
     deleteVLArray(ht->keys);
     deleteVLArray(ht->values);
     free(ht);
@@ -128,78 +313,158 @@ int
 insertHashTable(HashTable *ht, const uint8_t *key, size_t nKey,
     const uint8_t *value, size_t nValue) 
 {
-    size_t hash;
-    size_t kvIndex;
-    size_t bucketID;
-    Array **bucketPtr;
+    uint64_t hash;
+    int kvIndex;
 
     /* hash the key */
-    hash = ht->hashFunc(key, nKey);
-    /* save the key */
-    if (!(tryPushVLArray(&ht->keys, key, nKey)))
+    hash = hashKeyHashTable(ht, key, nKey);
+    if ((kvIndex = pushKVHashTable(ht, hash, key, nKey, value, nValue)) < 0)
         goto error1;
+    /* register the kv pair */
+    if (isOpenAddressingHashTable(ht)) {
+        if (insertSlotHashTable(ht, getSlotHashHashTable(ht, hash), kvIndex))
+            goto error2;
+    } else {
+        if (insertBucketHashTable(ht, getSlotHashHashTable(ht, hash),
+            kvIndex))
+            goto error2;
+    }
+    return kvIndex;
+error2:;
+    /* the pair is unreachable, so it is reclaimed by compactHashTable() */
+    isDeadHashTable(ht, kvIndex) = 1;
+    ht->deadCount++;
+error1:;
+    return -1;
+}
+
+/*
+ * REQUIRES
+ * key and value are nKey and nValue bytes long.
+ * hash is the (full) hash of key.
+ *
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * appends a kv pair to keys and values without registering it in the
+ * buckets or slots of ht.
+ * returns the kvIndex of the new pair.
+ * returns negative on error
+ */
+static int
+pushKVHashTable(HashTable *ht, uint64_t hash, const uint8_t *key,
+    size_t nKey, const uint8_t *value, size_t nValue)
+{
+    size_t kvIndex;
+    uint32_t hash32;
+    const char isDead = 0;
+
     /* 
      * kvIndex indexes into both keys and values, since keys are index mapped 
      * to values
      */
-    kvIndex = lastIndexVLArray(ht->keys);
-    /* save the value */
-    if (!(tryPushVLArray(&ht->values, value, nValue)))
+    kvIndex = getKVCountHashTable(ht);
+    if (kvIndex >= HASH_TABLE_EMPTY_SLOT || kvIndex > INT_MAX)
         goto error1;
-    /* resize if needed */
-    if (getLoadFactor(ht) > ht->maxLoadFactor) {
-        if (growHashTable(ht, ht->records->capacity))
-            goto error1;
-    }
-    /* make new bucket if needed */
-    bucketID = getBucketIDHashTable(ht, hash);
-    bucketPtr = (Array **)getElementArray(ht->records, bucketID);
-    if (!*bucketPtr) {
-        if (!(*bucketPtr = newArray(1, 1, sizeof(size_t))))
-            goto error1;
-        ht->nonEmptyBuckets++;
-    }
-    /* push record into bucket */
-    if (!(tryPushArray(bucketPtr, &kvIndex)))
+    /* save the key */
+    if (!(tryPushVLArray(&ht->keys, key, nKey)))
         goto error1;
+    /* save the value */
+    if (!(tryPushVLArray(&ht->values, value, nValue)))
+        goto error2;
     /* save hash so it does not need to be recomputed every resize */
-    if (!(tryPushArray(&ht->hashes, &hash)))
-        goto error1;
+    hash32 = hash;
+    if (!(tryPushArray(&ht->hashes, isHash64HashTable(ht) ? (void *)&hash
+        : (void *)&hash32)))
+        goto error3;
+    if (!(tryPushArray(&ht->deadFlags, &isDead)))
+        goto error4;
+    /* 
+     * the pair must be fully written before it is reachable from the 
+     * buckets or slots, since a ConcurrentHashTable reader may be looking 
+     * at them (see concurrent_hashtable.h).
+     */
+    MEMORY_FENCE_RELEASE();
     ht->isDirty = 1;
     return kvIndex;
+error4:;
+    popArray(ht->hashes, NULL);
+error3:;
+    popVLArray(ht->values, NULL);
+error2:;
+    popVLArray(ht->keys, NULL);
 error1:;
     return -1;
 }
 
 /*
  * REQUIRES
- * key is nKey bytes long.
+ * key and value are nKey and nValue bytes long.
+ * key and value do not point into ht.
+ *
+ * MODIFIES
+ * ht
  *
  * EFFECTS
- * returns the index of the kv pair. 
+ * associates value with key, inserting the pair if key is not in ht.
+ * the old value is overwritten in place if value fits in its frames (see
+ * getElementCapacityVLArray()). Otherwise, the pair is appended to a new
+ * kvIndex and the old pair is marked dead until compactHashTable() is called.
+ * returns the kvIndex of the pair.
  * returns negative on error
  */
 int
-getHashTable(const HashTable *ht, const uint8_t *key, size_t nKey)
+updateHashTable(HashTable *ht, const uint8_t *key, size_t nKey,
+    const uint8_t *value, size_t nValue)
 {
-    size_t bucketID;
-    size_t testKeySize;
-    size_t kvIndex;
-    const Array *bucket;
-    const void *testKey;
+    uint64_t hash;
+    uint32_t oldKVIndex;
+    int kvIndex;
+    HashTableSlot *slot;
+
+    hash = hashKeyHashTable(ht, key, nKey);
+    /* ht is not const here, so neither are its slots */
+    if (!(slot = (HashTableSlot *)findHashTable(ht, hash, key, nKey)))
+        return insertHashTable(ht, key, nKey, value, nValue);
+    if (!overwriteVLArray(ht->values, value, nValue, slot->kvIndex))
+        return slot->kvIndex;
+    /* 
+     * pushing a kv pair does not touch the buckets or slots, so slot is still
+     * valid and can be pointed at the new pair.
+     */
+    oldKVIndex = slot->kvIndex;
+    if ((kvIndex = pushKVHashTable(ht, hash, key, nKey, value, nValue)) < 0)
+        return -1;
+    slot->kvIndex = kvIndex;
+    isDeadHashTable(ht, oldKVIndex) = 1;
+    ht->deadCount++;
+    return kvIndex;
+}
+
+/*
+ * MODIFIES
+ * bucket
+ *
+ * EFFECTS
+ * removes the entry of kvIndex from bucket.
+ * the order of a bucket does not matter, so the last entry fills the hole.
+ * returns non-zero if kvIndex is not in bucket.
+ */
+static int
+removeFromBucket(Array *bucket, uint32_t kvIndex)
+{
+    HashTableSlot *slot;
 
-    bucketID = getBucketIDHashTable(ht, ht->hashFunc(key, nKey));
-    bucket = *(Array **)getElementArray(ht->records, bucketID);
     if (!bucket)
         return -1;
     for (size_t i = 0; i < getCountArray(bucket); i++) {
-        kvIndex = *(size_t *)getElementArray(bucket, i);
-        testKeySize = sizeOfElementVLArray(ht->keys, kvIndex);
-        if (testKeySize != nKey)
+        slot = (HashTableSlot *)getElementArray(bucket, i);
+        if (slot->kvIndex != kvIndex)
             continue;
-        testKey = getElementVLArray(ht->keys, kvIndex);
-        if (!memcmp(testKey, key, nKey))
-            return kvIndex;
+        *slot = *(HashTableSlot *)getLastArray(bucket);
+        popArray(bucket, NULL);
+        return 0;
     }
     return -1;
 }
@@ -209,93 +474,900 @@ getHashTable(const HashTable *ht, const uint8_t *key, size_t nKey)
  * ht
  *
  * EFFECTS
- * enlarges ht.
- * returns non-zero on error
+ * removes slot from the buckets of a chained table.
+ * empty buckets stay allocated, since they are likely to be reused.
  */
-int
-growHashTable(HashTable *ht, size_t n)
+static void
+removeBucketHashTable(HashTable *ht, const HashTableSlot *slot)
 {
-    size_t nonEmptyBuckets;
-    size_t newCapacity;
     uint32_t hash;
-    size_t newBucketID;
-    Array *newBuckets;
-    const void *nullElement;
-    Array **bucketPtr;
-    uint32_t hashesAdded[getCountArray(ht->hashes)];
+    uint32_t kvIndex;
 
-    /* allocate more buckets */
-    nonEmptyBuckets = 0;
-    newCapacity = getBucketCountHashTable(ht) + n;
-    nullElement = NULL;
-    if (!(newBuckets = newArray(ht->records->blockSize, newCapacity, 
-        sizeof(Array *))))
+    hash = slot->hash;
+    kvIndex = slot->kvIndex;
+    if (!removeFromBucket(*getBucketPtrFromBucketIDHashTable(ht,
+        getBucketIDHashTable(ht, hash)), kvIndex) || !isResizingHashTable(ht))
+        return;
+    /* the key has not been migrated yet */
+    removeFromBucket(*(Array **)getElementArray(ht->oldRecords,
+        getOldBucketIDHashTable(ht, hash)), kvIndex);
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * removes slot from an open addressing table using backward shift deletion:
+ * the following slots of its run are shifted back by one until an empty slot
+ * or a slot that is already in its home slot is reached.
+ * This keeps runs sorted by home slot without leaving tombstones behind, so
+ * lookups can still stop early.
+ */
+static void
+removeSlotHashTable(HashTable *ht, HashTableSlot *slot)
+{
+    size_t mask;
+    size_t slotID;
+    size_t nextSlotID;
+    const HashTableSlot *nextSlot;
+
+    mask = getSlotCountHashTable(ht) - 1;
+    slotID = slot - (HashTableSlot *)getFirstArray(ht->slots);
+    for (;;) {
+        nextSlotID = (slotID + 1) & mask;
+        nextSlot = getSlotHashTable(ht, nextSlotID);
+        if (nextSlot->kvIndex == HASH_TABLE_EMPTY_SLOT
+            || getBucketIDHashTable(ht, nextSlot->hash) == nextSlotID)
+            break;
+        *getSlotHashTable(ht, slotID) = *nextSlot;
+        slotID = nextSlotID;
+    }
+    getSlotHashTable(ht, slotID)->kvIndex = HASH_TABLE_EMPTY_SLOT;
+}
+
+/*
+ * REQUIRES
+ * key is nKey bytes long.
+ *
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * removes a key value pair from the hash table.
+ * the kvIndexes of the other pairs do not change. The memory of the removed
+ * pair is reclaimed by compactHashTable().
+ * returns the kvIndex of the removed pair.
+ * returns negative if key is not in ht.
+ */
+int
+removeHashTable(HashTable *ht, const uint8_t *key, size_t nKey)
+{
+    HashTableSlot *slot;
+    uint32_t kvIndex;
+
+    /* ht is not const here, so neither are its slots */
+    if (!(slot = (HashTableSlot *)findHashTable(ht,
+        hashKeyHashTable(ht, key, nKey), key, nKey)))
+        return -1;
+    kvIndex = slot->kvIndex;
+    if (isOpenAddressingHashTable(ht))
+        removeSlotHashTable(ht, slot);
+    else
+        removeBucketHashTable(ht, slot);
+    isDeadHashTable(ht, kvIndex) = 1;
+    ht->deadCount++;
+    ht->isDirty = 1;
+    return kvIndex;
+}
+
+/*
+ * MODIFIES
+ * buckets
+ *
+ * EFFECTS
+ * replaces the kvIndex of every entry in buckets with remap[kvIndex].
+ */
+static void
+remapBucketArray(Array *buckets, const uint32_t *remap)
+{
+    Array *bucket;
+    HashTableSlot *slot;
+
+    if (!buckets)
+        return;
+    for (size_t i = 0; i < getCountArray(buckets); i++) {
+        if (!(bucket = *(Array **)getElementArray(buckets, i)))
+            continue;
+        for (size_t j = 0; j < getCountArray(bucket); j++) {
+            slot = (HashTableSlot *)getElementArray(bucket, j);
+            slot->kvIndex = remap[slot->kvIndex];
+        }
+    }
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * reclaims the memory of removed kv pairs.
+ * the live pairs are copied (in order) into new keys and values arrays, then
+ * the kvIndex of every bucket entry or slot is remapped in a single pass.
+ * Nothing is rehashed, so this can be called whenever the program is idle.
+ * kvIndexes returned before compacting are invalid afterwards.
+ * does nothing if no pairs have been removed.
+ * returns non-zero on error, in which case ht is unchanged.
+ */
+int
+compactHashTable(HashTable *ht)
+{
+    size_t capacity;
+    uint32_t *remap;
+    VLArray *keys;
+    VLArray *values;
+    Array *hashes;
+    Array *deadFlags;
+    const char isDead = 0;
+
+    if (!ht->deadCount)
+        return 0;
+    capacity = MAX(getCountHashTable(ht), 1);
+    if (!(remap = malloc(sizeof(uint32_t) * getKVCountHashTable(ht))))
         goto error1;
-    /* null elements denotes uninitialized bucket */
-    for (size_t i = 0; i < newCapacity; i++) {
-        if (!(tryPushArray(&newBuckets, &nullElement)))
-            goto error2;
+    if (!(keys = newVLArrayLike(ht->keys, -1, capacity)))
+        goto error2;
+    if (!(values = newVLArrayLike(ht->values, -1, capacity)))
+        goto error3;
+    if (!(hashes = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        capacity, getSizeofHashHashTable(ht), 0)))
+        goto error4;
+    if (!(deadFlags = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        capacity, sizeof(char), 0)))
+        goto error5;
+    /* copy the live pairs */
+    for (size_t i = 0; i < getKVCountHashTable(ht); i++) {
+        if (isDeadHashTable(ht, i)) {
+            remap[i] = HASH_TABLE_EMPTY_SLOT;
+            continue;
+        }
+        remap[i] = getCountVLArray(keys);
+        if (!tryPushVLArray(&keys, getKeyHashTable(ht, i),
+            getSizeofKeyHashTable(ht, i)))
+            goto error6;
+        if (!tryPushVLArray(&values, getValueByKVIndexHashTable(ht, i),
+            getSizeofValueHashTable(ht, i)))
+            goto error6;
+        if (!tryPushArray(&hashes, getElementArray(ht->hashes, i)))
+            goto error6;
+        if (!tryPushArray(&deadFlags, &isDead))
+            goto error6;
     }
-    /* insert all keys into the new buckets */
-    for (size_t i = 0; i < getCountArray(ht->hashes); i++) {
-        /* get hash code and new bucketID */
-        hash = getHashHashTable(ht, i);
-        newBucketID = hash % newCapacity;
-        /* initialize new bucket if needed */
-        bucketPtr = (Array **)getElementArray(newBuckets, newBucketID);
-        if (!*bucketPtr) {
-            if (!(*bucketPtr = newArray(1, 1, sizeof(size_t))))
-                goto error3;
-            hashesAdded[nonEmptyBuckets] = hash;
-            nonEmptyBuckets++;
+    /* remap the kvIndexes */
+    if (isOpenAddressingHashTable(ht)) {
+        for (size_t i = 0; i < getSlotCountHashTable(ht); i++) {
+            if (getSlotHashTable(ht, i)->kvIndex != HASH_TABLE_EMPTY_SLOT) {
+                getSlotHashTable(ht, i)->kvIndex =
+                    remap[getSlotHashTable(ht, i)->kvIndex];
+            }
         }
-        /* put next record into bucket */
-        if (!(tryPushArray(bucketPtr, &i)))
-            goto error3;
+    } else {
+        remapBucketArray(ht->records, remap);
+        remapBucketArray(ht->oldRecords, remap);
     }
-    /* delete old buckets */
-    deleteBuckets(ht);
-    deleteArray(ht->records);
-    /* configure ht to use new buckets */
-    ht->records = newBuckets;
+    /* configure ht to use the compacted pairs */
+    deleteVLArray(ht->keys);
+    deleteVLArray(ht->values);
+    deleteArray(ht->hashes);
+    deleteArray(ht->deadFlags);
+    ht->keys = keys;
+    ht->values = values;
+    ht->hashes = hashes;
+    ht->deadFlags = deadFlags;
+    ht->deadCount = 0;
     ht->isDirty = 1;
-    ht->nonEmptyBuckets = nonEmptyBuckets;
+    free(remap);
     return 0;
+error6:;
+    deleteArray(deadFlags);
+error5:;
+    deleteArray(hashes);
+error4:;
+    deleteVLArray(values);
 error3:;
-    /* free new buckets */
-    deleteBucketsByHashes(newBuckets, hashesAdded, nonEmptyBuckets);
+    deleteVLArray(keys);
 error2:;
-    deleteArray(newBuckets);
+    free(remap);
 error1:;
     return -1;
 }
 
-/* XXX untested */
-static void
-deleteBucketsByHashes(Array *buckets, const uint32_t *hashes, size_t n)
-{
-    size_t deletedBucketID;
-    Array **deletedBucketPtr;
-
-    for (size_t i = 0; i < n; i++) {
-        /* get bucket by hash */
-        deletedBucketID = hashes[i] % getCountArray(buckets);
-        deletedBucketPtr = (Array **)getElementArray(buckets,
-            deletedBucketID);
-        /* delete bucket */
-        if (!*deletedBucketPtr)
-            continue;
-        deleteArray(*deletedBucketPtr);
-        *deletedBucketPtr = NULL;
-    }
-}
-
-static void
-cleanHashTable(HashTable *ht)
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * pushes slot into the bucket of ht->records selected by its hash.
+ * returns non-zero on error
+ */
+static int
+pushBucketHashTable(HashTable *ht, const HashTableSlot *slot)
 {
-    if (!ht->isDirty)
-        return;
-    ht->loadFactor = getCountVLArray(ht->keys) / getCountArray(ht->records);
+    size_t bucketID;
+    Array **bucketPtr;
+
+    /* make new bucket if needed */
+    bucketID = getBucketIDHashTable(ht, slot->hash);
+    bucketPtr = getBucketPtrFromBucketIDHashTable(ht, bucketID);
+    if (!*bucketPtr) {
+        if (!(*bucketPtr = newBucket()))
+            return -1;
+        ht->nonEmptyBuckets++;
+    }
+    /* push record into bucket */
+    return !tryPushArray(bucketPtr, slot);
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * puts kvIndex into the bucket selected by hash.
+ * grows ht if the load factor gets too large.
+ * if ht is being resized incrementally, this also migrates
+ * ht->resizeStep old buckets.
+ * returns non-zero on error
+ */
+static int
+insertBucketHashTable(HashTable *ht, uint32_t hash, size_t kvIndex)
+{
+    if (isResizingHashTable(ht) && stepResizeHashTable(ht, ht->resizeStep))
+        return -1;
+    /* resize if needed */
+    if (getLoadFactor(ht) > ht->maxLoadFactor) {
+        if (growHashTable(ht, getBucketCountHashTable(ht)))
+            return -1;
+    }
+    return pushBucketHashTable(ht, &(HashTableSlot) {
+        .hash = hash,
+        .kvIndex = kvIndex,
+    });
+}
+
+/*
+ * REQUIRES
+ * slots has at least one empty slot.
+ *
+ * MODIFIES
+ * slots
+ *
+ * EFFECTS
+ * puts next into slots using robin hood linear probing: while probing, next
+ * takes the place of any slot that is closer to its home slot, and the
+ * displaced slot continues probing.
+ * This keeps probe sequences short and sorted by home slot, which lets
+ * lookups stop early.
+ */
+static void
+placeSlot(const HashTable *ht, Array *slots, int shift, HashTableSlot next)
+{
+    size_t mask;
+    size_t slotID;
+    size_t dist;
+    size_t nextDist;
+    HashTableSlot *slot;
+    HashTableSlot tmp;
+
+    mask = getCountArray(slots) - 1;
+    slotID = shiftHashTable(ht, next.hash, shift);
+    for (dist = 0;; dist++) {
+        slot = (HashTableSlot *)getElementArray(slots, slotID);
+        if (slot->kvIndex == HASH_TABLE_EMPTY_SLOT) {
+            *slot = next;
+            return;
+        }
+        nextDist = (slotID - shiftHashTable(ht, slot->hash, shift)) & mask;
+        if (nextDist < dist) {
+            /* the resident is closer to home; displace it */
+            tmp = *slot;
+            *slot = next;
+            next = tmp;
+            dist = nextDist;
+        }
+        slotID = (slotID + 1) & mask;
+    }
+}
+
+/*
+ * EFFECTS
+ * returns the load factor that an open addressing table grows at.
+ */
+static float
+getMaxSlotLoadFactor(const HashTable *ht)
+{
+    return ht->maxLoadFactor <= 0 ? HASH_TABLE_MAX_PROBING_LOAD_FACTOR
+        : MIN(ht->maxLoadFactor, HASH_TABLE_MAX_PROBING_LOAD_FACTOR);
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * puts kvIndex into the slots of an open addressing table.
+ * grows ht if the load factor gets too large.
+ * returns non-zero on error
+ */
+static int
+insertSlotHashTable(HashTable *ht, uint32_t hash, size_t kvIndex)
+{
+    /* resize if needed */
+    if (getLoadFactor(ht) > getMaxSlotLoadFactor(ht)) {
+        if (growHashTable(ht, getSlotCountHashTable(ht)))
+            return -1;
+    }
+    placeSlot(ht, ht->slots, ht->bucketShift, (HashTableSlot) {
+        .hash = hash,
+        .kvIndex = kvIndex,
+    });
+    return 0;
+}
+
+/*
+ * EFFECTS
+ * returns non-zero if slot refers to the nKey bytes long key with the given
+ * (full) hash.
+ * key memory is only compared if the hashes match.
+ */
+static int
+isKeyHashTable(const HashTable *ht, const HashTableSlot *slot, uint64_t hash,
+    const uint8_t *key, size_t nKey)
+{
+    if (slot->hash != getSlotHashHashTable(ht, hash)
+        || (isHash64HashTable(ht)
+        && getHash64HashTable(ht, slot->kvIndex) != hash)) {
+        countStatHashTable(ht, hashRejects);
+        return 0;
+    }
+    countStatHashTable(ht, keyComparisons);
+    if (getSizeofKeyHashTable(ht, slot->kvIndex) == nKey
+        && !memcmp(getKeyHashTable(ht, slot->kvIndex), key, nKey))
+        return 1;
+    countStatHashTable(ht, falsePositives);
+    return 0;
+}
+
+static const HashTableSlot *
+findInBucketHashTable(const HashTable *ht, const Array *bucket,
+    uint64_t hash, const uint8_t *key, size_t nKey)
+{
+    const HashTableSlot *slot;
+
+    if (!bucket)
+        return NULL;
+    for (size_t i = 0; i < getCountArray(bucket); i++) {
+        slot = (const HashTableSlot *)getElementArray(bucket, i);
+        if (isKeyHashTable(ht, slot, hash, key, nKey))
+            return slot;
+    }
+    return NULL;
+}
+
+static const HashTableSlot *
+findBucketHashTable(const HashTable *ht, uint64_t hash, const uint8_t *key,
+    size_t nKey)
+{
+    const HashTableSlot *ret;
+    uint32_t slotHash;
+
+    slotHash = getSlotHashHashTable(ht, hash);
+    ret = findInBucketHashTable(ht, *getBucketPtrFromBucketIDHashTable(ht,
+        getBucketIDHashTable(ht, slotHash)), hash, key, nKey);
+    /* keys that have not been migrated yet are still in the old buckets */
+    if (!ret && isResizingHashTable(ht)) {
+        ret = findInBucketHashTable(ht, *(Array **)getElementArray(
+            ht->oldRecords, getOldBucketIDHashTable(ht, slotHash)), hash,
+            key, nKey);
+    }
+    return ret;
+}
+
+static const HashTableSlot *
+findSlotHashTable(const HashTable *ht, uint64_t hash, const uint8_t *key,
+    size_t nKey)
+{
+    size_t mask;
+    size_t slotID;
+    const HashTableSlot *slot;
+
+    mask = getSlotCountHashTable(ht) - 1;
+    slotID = getBucketIDHashTable(ht, getSlotHashHashTable(ht, hash));
+    for (size_t dist = 0;; dist++) {
+        slot = getSlotHashTable(ht, slotID);
+        /* 
+         * robin hood probing keeps runs sorted by home slot, so the key is
+         * absent once a slot is closer to its home than the key would be.
+         */
+        if (slot->kvIndex == HASH_TABLE_EMPTY_SLOT
+            || ((slotID - getBucketIDHashTable(ht, slot->hash)) & mask) < dist)
+            return NULL;
+        if (isKeyHashTable(ht, slot, hash, key, nKey))
+            return slot;
+        slotID = (slotID + 1) & mask;
+    }
+}
+
+/*
+ * EFFECTS
+ * returns the slot that refers to the nKey bytes long key with the given
+ * (full) hash.
+ * returns NULL if the key is not in ht.
+ */
+static const HashTableSlot *
+findHashTable(const HashTable *ht, uint64_t hash, const uint8_t *key,
+    size_t nKey)
+{
+    return isOpenAddressingHashTable(ht)
+        ? findSlotHashTable(ht, hash, key, nKey)
+        : findBucketHashTable(ht, hash, key, nKey);
+}
+
+/*
+ * REQUIRES
+ * key is nKey bytes long.
+ *
+ * EFFECTS
+ * returns the index of the kv pair. 
+ * returns negative on error
+ */
+int
+getHashTable(const HashTable *ht, const uint8_t *key, size_t nKey)
+{
+    return getByHash64HashTable(ht, hashKeyHashTable(ht, key, nKey), key,
+        nKey);
+}
+
+/*
+ * REQUIRES
+ * key is nKey bytes long.
+ *
+ * EFFECTS
+ * returns the hash of key: hashFunc64(key, nKey, seed) for hash64 tables,
+ * and hashFunc(key, nKey) otherwise.
+ */
+uint64_t
+hashKeyHashTable(const HashTable *ht, const uint8_t *key, size_t nKey)
+{
+    return isHash64HashTable(ht) ? ht->hashFunc64(key, nKey, ht->seed)
+        : ht->hashFunc(key, nKey);
+}
+
+/*
+ * REQUIRES
+ * key is nKey bytes long.
+ * ht is not a hash64 table.
+ * hash is the hash of key computed using ht->hashFunc.
+ *
+ * EFFECTS
+ * same as getHashTable(), but does not hash the key.
+ */
+int
+getByHashHashTable(const HashTable *ht, uint32_t hash, const uint8_t *key,
+    size_t nKey)
+{
+    return getByHash64HashTable(ht, hash, key, nKey);
+}
+
+/*
+ * REQUIRES
+ * key is nKey bytes long.
+ * hash is the hash of key computed using hashKeyHashTable().
+ *
+ * EFFECTS
+ * same as getHashTable(), but does not hash the key.
+ */
+int
+getByHash64HashTable(const HashTable *ht, uint64_t hash, const uint8_t *key,
+    size_t nKey)
+{
+    const HashTableSlot *slot;
+
+    slot = findHashTable(ht, hash, key, nKey);
+    return slot ? (int)slot->kvIndex : -1;
+}
+
+/*
+ * EFFECTS
+ * returns the first slot of the home bucket (or run) of hash whose hash
+ * matches, without comparing any key memory.
+ * returns NULL if there is no such slot.
+ * used to find which key memory is worth prefetching.
+ */
+static const HashTableSlot *
+findCandidateHashTable(const HashTable *ht, uint64_t fullHash)
+{
+    size_t mask;
+    size_t slotID;
+    uint32_t hash;
+    const Array *bucket;
+    const HashTableSlot *slot;
+
+    /* only the slot hashes are compared, so no kv pair memory is touched */
+    hash = getSlotHashHashTable(ht, fullHash);
+    if (!isOpenAddressingHashTable(ht)) {
+        if (!(bucket = *getBucketPtrFromBucketIDHashTable(ht,
+            getBucketIDHashTable(ht, hash))))
+            return NULL;
+        for (size_t i = 0; i < getCountArray(bucket); i++) {
+            slot = (const HashTableSlot *)getElementArray(bucket, i);
+            if (slot->hash == hash)
+                return slot;
+        }
+        return NULL;
+    }
+    mask = getSlotCountHashTable(ht) - 1;
+    slotID = getBucketIDHashTable(ht, hash);
+    for (size_t dist = 0;; dist++) {
+        slot = getSlotHashTable(ht, slotID);
+        if (slot->kvIndex == HASH_TABLE_EMPTY_SLOT
+            || ((slotID - getBucketIDHashTable(ht, slot->hash)) & mask) < dist)
+            return NULL;
+        if (slot->hash == hash)
+            return slot;
+        slotID = (slotID + 1) & mask;
+    }
+}
+
+/*
+ * REQUIRES
+ * keys[i] is nKeys[i] bytes long.
+ * outKVIndex has room for count ints.
+ *
+ * MODIFIES
+ * outKVIndex
+ *
+ * EFFECTS
+ * looks up count keys. outKVIndex[i] is set to the kvIndex of keys[i], or
+ * negative if keys[i] is not in ht.
+ * Unlike a loop of getHashTable() calls, which waits on the cache misses of
+ * each key before starting the next one, the keys are processed in batches
+ * of HASH_TABLE_BATCH_SIZE: the whole batch is hashed, then its buckets
+ * are prefetched, then the key memory of the entries with matching hashes,
+ * and only then are the keys compared. This overlaps the memory latency of 
+ * the keys in a batch.
+ * returns the number of keys that were found.
+ */
+size_t
+getManyHashTable(const HashTable *ht, const uint8_t *const *keys,
+    const size_t *nKeys, size_t count, int *outKVIndex)
+{
+    size_t ret;
+    size_t n;
+    size_t bucketID;
+    uint64_t hashes[HASH_TABLE_BATCH_SIZE];
+    const HashTableSlot *candidates[HASH_TABLE_BATCH_SIZE];
+
+    ret = 0;
+    for (size_t first = 0; first < count; first += n) {
+        n = MIN(count - first, HASH_TABLE_BATCH_SIZE);
+        /* hash the batch and prefetch the buckets (or home slots) */
+        for (size_t i = 0; i < n; i++) {
+            hashes[i] = hashKeyHashTable(ht, keys[first + i],
+                nKeys[first + i]);
+            bucketID = getBucketIDHashTable(ht,
+                getSlotHashHashTable(ht, hashes[i]));
+            if (isOpenAddressingHashTable(ht))
+                PREFETCH(getSlotHashTable(ht, bucketID));
+            else
+                PREFETCH(getBucketPtrFromBucketIDHashTable(ht, bucketID));
+        }
+        /* chained tables have to follow the bucket pointer first */
+        if (!isOpenAddressingHashTable(ht)) {
+            for (size_t i = 0; i < n; i++) {
+                PREFETCH(*getBucketPtrFromBucketIDHashTable(ht,
+                    getBucketIDHashTable(ht,
+                    getSlotHashHashTable(ht, hashes[i]))));
+            }
+        }
+        /* prefetch where the keys with matching hashes are stored */
+        for (size_t i = 0; i < n; i++) {
+            if (!(candidates[i] = findCandidateHashTable(ht, hashes[i])))
+                continue;
+            PREFETCH(getEntryVLArray(ht->keys, candidates[i]->kvIndex));
+        }
+        /* prefetch the keys */
+        for (size_t i = 0; i < n; i++) {
+            if (candidates[i])
+                PREFETCH(getKeyHashTable(ht, candidates[i]->kvIndex));
+        }
+        /* compare the keys */
+        for (size_t i = 0; i < n; i++) {
+            outKVIndex[first + i] = getByHash64HashTable(ht, hashes[i],
+                keys[first + i], nKeys[first + i]);
+            if (outKVIndex[first + i] >= 0)
+                ret++;
+        }
+    }
+    return ret;
+}
+
+/*
+ * EFFECTS
+ * makes n empty slots for an open addressing table.
+ * n must be a power of two.
+ * returns NULL on error
+ */
+static Array *
+newSlots(size_t n)
+{
+    Array *ret;
+    HashTableSlot *slots;
+
+    if (!(ret = newArrayWithPolicy(ArrayGrowthPolicy_fixed, -1, n,
+        sizeof(HashTableSlot), 0)))
+        return NULL;
+    ret = forwardShiftRangeArray(ret, 0, n);
+    slots = (HashTableSlot *)getFirstArray(ret);
+    for (size_t i = 0; i < n; i++)
+        slots[i].kvIndex = HASH_TABLE_EMPTY_SLOT;
+    return ret;
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * moves the slots of an open addressing table into n slots.
+ * returns non-zero on error
+ */
+static int
+growSlotsHashTable(HashTable *ht, size_t n)
+{
+    Array *newSlotArray;
+    const HashTableSlot *slot;
+    int newShift;
+
+    if (!(newSlotArray = newSlots(n)))
+        return -1;
+    newShift = shiftForCount(n);
+    for (size_t i = 0; i < getSlotCountHashTable(ht); i++) {
+        slot = getSlotHashTable(ht, i);
+        if (slot->kvIndex != HASH_TABLE_EMPTY_SLOT)
+            placeSlot(ht, newSlotArray, newShift, *slot);
+    }
+    deleteArray(ht->slots);
+    ht->slots = newSlotArray;
+    ht->bucketShift = newShift;
+    ht->isDirty = 1;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * enlarges ht by (at least) n buckets.
+ * open addressing tables are rounded up to a power of two slots.
+ * returns non-zero on error
+ */
+int
+growHashTable(HashTable *ht, size_t n)
+{
+    if (isOpenAddressingHashTable(ht))
+        return growSlotsHashTable(ht,
+            nextPow2(getSlotCountHashTable(ht) + n));
+    return growBucketsHashTable(ht, n);
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * moves the entries of an old bucket into the current buckets.
+ * entries are popped from the old bucket as they are moved, so a failed
+ * migration can be retried.
+ * returns non-zero on error
+ */
+static int
+migrateBucketHashTable(HashTable *ht, size_t oldBucketID)
+{
+    Array **oldBucketPtr;
+
+    oldBucketPtr = (Array **)getElementArray(ht->oldRecords, oldBucketID);
+    if (!*oldBucketPtr)
+        return 0;
+    while (!isEmptyArray(*oldBucketPtr)) {
+        if (pushBucketHashTable(ht,
+            (const HashTableSlot *)getLastArray(*oldBucketPtr)))
+            return -1;
+        popArray(*oldBucketPtr, NULL);
+    }
+    deleteArray(*oldBucketPtr);
+    *oldBucketPtr = NULL;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * migrates (at most) n old buckets of a table that is being resized.
+ * the old buckets are deleted once they have all been migrated.
+ * does nothing if ht is not being resized.
+ * returns non-zero on error
+ */
+int
+stepResizeHashTable(HashTable *ht, size_t n)
+{
+    for (; n && isResizingHashTable(ht); n--) {
+        if (migrateBucketHashTable(ht, ht->resizeIndex))
+            return -1;
+        ht->resizeIndex++;
+        if (ht->resizeIndex >= getCountArray(ht->oldRecords)) {
+            deleteArray(ht->oldRecords);
+            ht->oldRecords = NULL;
+            ht->resizeIndex = 0;
+        }
+    }
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * migrates all the remaining old buckets of a table that is being resized.
+ * returns non-zero on error
+ */
+int
+finishResizeHashTable(HashTable *ht)
+{
+    return stepResizeHashTable(ht, SIZE_MAX);
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * moves the entries of a chained table into n more buckets.
+ * tables with pow2Buckets are rounded up to a power of two buckets.
+ * tables with incrementalResize only allocate the new buckets here; the old
+ * buckets are migrated a few at a time by later inserts.
+ * returns non-zero on error
+ */
+static int
+growBucketsHashTable(HashTable *ht, size_t n)
+{
+    size_t newCapacity;
+    size_t maxCount;
+    size_t room;
+    Array *newBuckets;
+
+    /*
+     * finish the previous resize first. inserts drain it before they grow
+     * ht again (see resizeStep), so only direct calls get here with old
+     * buckets left.
+     */
+    if (finishResizeHashTable(ht))
+        return -1;
+    newCapacity = getBucketCountHashTable(ht) + n;
+    if (isPow2BucketsHashTable(ht))
+        newCapacity = nextPow2(newCapacity);
+    if (!(newBuckets = newBucketArray(newCapacity)))
+        return -1;
+    /* the current buckets become the old buckets */
+    ht->oldRecords = ht->records;
+    ht->oldBucketShift = ht->bucketShift;
+    ht->resizeIndex = 0;
+    /* configure ht to use new buckets */
+    ht->records = newBuckets;
+    ht->bucketShift = isPow2BucketsHashTable(ht)
+        ? shiftForCount(newCapacity) : 0;
+    ht->nonEmptyBuckets = 0;
+    ht->isDirty = 1;
+    if (!(ht->flags & HashTableFlags_incrementalResize))
+        return finishResizeHashTable(ht);
+    /*
+     * the next grow happens after about room more inserts, so migrating
+     * ceil(old buckets / room) buckets per insert drains the old buckets
+     * before then.
+     */
+    maxCount = (size_t)(newCapacity * ht->maxLoadFactor);
+    room = maxCount > getCountHashTable(ht)
+        ? maxCount - getCountHashTable(ht) : 1;
+    ht->resizeStep = MAX(HASH_TABLE_RESIZE_STEP,
+        (getCountArray(ht->oldRecords) + room - 1) / room);
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * ht
+ *
+ * EFFECTS
+ * makes room for n more kv pairs, so inserting them does not relocate any of
+ * the memory of ht (see hasRoomHashTable()). The keys and values of the new 
+ * pairs are assumed to be about as large as the ones already in ht.
+ * returns non-zero on error
+ */
+int
+reserveHashTable(HashTable *ht, size_t n)
+{
+    size_t kvCount;
+    size_t bucketCount;
+    size_t keyBytes;
+    size_t valueBytes;
+    float maxLoadFactor;
+    Array *tmp;
+
+    kvCount = getKVCountHashTable(ht);
+    keyBytes = 0;
+    valueBytes = 0;
+    if (kvCount) {
+        keyBytes = n * (getCountArray(ht->keys->data) / kvCount);
+        valueBytes = n * (getCountArray(ht->values->data) / kvCount);
+    }
+    if (!reserveVLArray(ht->keys, n, keyBytes)
+        || !reserveVLArray(ht->values, n, valueBytes))
+        return -1;
+    if (!(tmp = growArray(ht->hashes, n)))
+        return -1;
+    ht->hashes = tmp;
+    if (!(tmp = growArray(ht->deadFlags, n)))
+        return -1;
+    ht->deadFlags = tmp;
+    /* grow the buckets (or slots) now instead of while inserting */
+    maxLoadFactor = isOpenAddressingHashTable(ht) ? getMaxSlotLoadFactor(ht)
+        : ht->maxLoadFactor;
+    bucketCount = isOpenAddressingHashTable(ht) ? getSlotCountHashTable(ht)
+        : getBucketCountHashTable(ht);
+    if (maxLoadFactor > 0 
+        && (getCountHashTable(ht) + n) / maxLoadFactor > bucketCount)
+        return growHashTable(ht, (getCountHashTable(ht) + n) / maxLoadFactor
+            + 1 - bucketCount);
+    return 0;
+}
+
+/*
+ * EFFECTS
+ * returns non-zero if inserting a pair with an nKey bytes long key and an
+ * nValue bytes long value does not relocate any of the memory of ht,
+ * i.e., no array has to be resized and ht does not grow.
+ * always returns zero for chained tables, since each of their buckets is
+ * resized on its own.
+ */
+int
+hasRoomHashTable(const HashTable *ht, size_t nKey, size_t nValue)
+{
+    return isOpenAddressingHashTable(ht)
+        && hasRoomVLArray(ht->keys, nKey)
+        && hasRoomVLArray(ht->values, nValue)
+        && getCountArray(ht->hashes) < getCapacityArray(ht->hashes)
+        && getCountArray(ht->deadFlags) < getCapacityArray(ht->deadFlags)
+        /* same as the check in insertSlotHashTable() */
+        && (float)(getCountHashTable(ht) + 1) / getSlotCountHashTable(ht)
+        <= getMaxSlotLoadFactor(ht);
+}
+
+static void
+cleanHashTable(HashTable *ht)
+{
+    if (!ht->isDirty)
+        return;
+    if (isOpenAddressingHashTable(ht)) {
+        ht->loadFactor = (float)getCountHashTable(ht)
+            / getSlotCountHashTable(ht);
+    } else {
+        ht->loadFactor = (float)getCountHashTable(ht)
+            / getCountArray(ht->records);
+    }
     ht->isDirty = 0;
 }
 
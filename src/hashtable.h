@@ -8,42 +8,219 @@
 #include "./array.h"
 #include "./vlarray.h"
 
+enum HashTableFlags
+{
+    HashTableFlags_none = 0,
+    HashTableFlags_openAddressing = 1 << 0,
+    HashTableFlags_pow2Buckets = 1 << 1,
+    HashTableFlags_incrementalResize = 1 << 2,
+    HashTableFlags_hash64 = 1 << 3,
+    HashTableFlags_packedValues = 1 << 4,
+    HashTableFlags_noStats = 1 << 5,
+};
+
+typedef enum HashTableFlags HashTableFlags;
 typedef struct HashTable HashTable;
+typedef struct HashTableSlot HashTableSlot;
+typedef struct HashTableStats HashTableStats;
 typedef uint32_t (*HashFunc)(const uint8_t *data, size_t n);
+typedef uint64_t (*HashFunc64)(const uint8_t *data, size_t n, uint64_t seed);
+
+/*
+ * HASH TABLE DETAILS AND FIELDS
+ *
+ * keys, values = the key and value of each pair. A kvIndex indexes into both.
+ * Keys are packed (see newVLArrayPacked()), since they are never 
+ * overwritten. Values are stored in frames, so updateHashTable() can 
+ * usually overwrite them in place, unless the table is made with 
+ * HashTableFlags_packedValues. Packed values are 8 byte aligned and take 
+ * much less memory when they are small.
+ *
+ * hashes = the hash of each key, indexed by kvIndex. (the full 64 bit hash
+ * in hash64 tables)
+ *
+ * deadFlags, deadCount = removeHashTable() and updateHashTable() do not move
+ * the other kv pairs, so removed pairs stay in keys and values until 
+ * compactHashTable() is called. deadFlags is non-zero for each removed 
+ * kvIndex and deadCount is the number of removed pairs.
+ * getCountHashTable() is the number of live pairs, and 
+ * getKVCountHashTable() is the number of kvIndexes (live or dead).
+ *
+ * records = (chained tables) the buckets. Each bucket is either NULL or an
+ * Array of HashTableSlots. Since the hash of each key is stored next to its
+ * kvIndex, lookups skip keys with different hashes without touching key
+ * memory.
+ *
+ * slots = (open addressing tables) a flat array of HashTableSlots. Collisions
+ * are resolved by robin hood linear probing, so a lookup scans a short run of
+ * neighbouring slots and only touches key memory when the hashes match.
+ * The number of slots is always a power of two, and the home slot of a hash
+ * is selected using fibonacci hashing (see below).
+ *
+ * bucketShift = (power of two tables) 32 - log2(the number of buckets/slots).
+ * Buckets are selected by fibonacci hashing: the hash is multiplied by
+ * 2^32 / phi and the top bits of the product are the bucket ID. This replaces
+ * the integer division of HASH % bucketCount with a multiply and a shift, and
+ * the multiply mixes the low bits of the hash into the top bits, so weak hash
+ * functions (e.g., ones that only vary in their high or low bits) still
+ * spread out over all of the buckets. Chained tables use power of two buckets
+ * if they are made with HashTableFlags_pow2Buckets.
+ *
+ * oldRecords = (chained tables with incrementalResize) the buckets that are 
+ * still being migrated into records, or NULL.
+ * When a table with incrementalResize grows, the new (empty) buckets become
+ * records, and each insert migrates a few old buckets into records 
+ * starting from resizeIndex. Lookups check records and then oldRecords.
+ * This spreads the cost of a resize over many inserts, so no single insert 
+ * has to rehash the whole table. stepResizeHashTable() and 
+ * finishResizeHashTable() migrate old buckets without inserting (e.g., 
+ * when the program is idle).
+ *
+ * resizeStep = the number of old buckets that each insert migrates. It is
+ * set when a resize starts, so that all the old buckets are migrated
+ * before the table is full enough to grow again (and it is at least
+ * HASH_TABLE_RESIZE_STEP).
+ *
+ * hashFunc64, seed = (hash64 tables) tables made by newHashTable64() hash
+ * their keys with hashFunc64(key, nKey, seed) instead of hashFunc.
+ * The top 32 bits of the 64 bit hash are stored in the slots, and since a 
+ * good 64 bit hash is already well mixed, its top bits are used as the
+ * bucket ID directly (no fibonacci multiply). When the slot hashes match, 
+ * the full hash in hashes is compared before any key memory, so a false
+ * positive needs all 64 bits to collide.
+ * A random seed (see getRandomSeedHashing()) makes the bucket of each key
+ * unpredictable, so an attacker cannot choose keys that all collide.
+ *
+ * flags = HashTableFlags chosen when the table was made.
+ *
+ * stats = lookup counters. These are only updated when the library is built
+ * with ALIB_HASH_TABLE_STATS (or ALIB_TESTING) defined, and not in tables
+ * made with HashTableFlags_noStats, which many threads may look up at once
+ * (the counters are not atomic). The tables of a ConcurrentHashTable use
+ * that flag, so their stats are not maintained.
+ *   keyComparisons: the number of times key memory was compared.
+ *   falsePositives: key comparisons that did not match even though the
+ *   hashes matched.
+ *   hashRejects: entries that were skipped because their hashes differed.
+ */
+
+struct HashTableSlot
+{
+    uint32_t hash;
+    uint32_t kvIndex;
+};
+
+struct HashTableStats
+{
+    size_t keyComparisons;
+    size_t falsePositives;
+    size_t hashRejects;
+};
 
 struct HashTable
 {
     char isDirty;
+    int flags;
+    int bucketShift;
+    int oldBucketShift;
+    size_t resizeIndex;
+    size_t resizeStep;
     size_t nonEmptyBuckets;
+    size_t deadCount;
     float maxLoadFactor;
     float loadFactor;
     VLArray *keys;
     VLArray *values;
     Array *records;
+    Array *oldRecords;
+    Array *slots;
     Array *hashes;
+    Array *deadFlags;
     HashFunc hashFunc;
+    HashFunc64 hashFunc64;
+    uint64_t seed;
+    HashTableStats stats;
 };
 
 HashTable *newHashTable(HashFunc hashFunc, int capacity, float maxLoadFactor);
+HashTable *newHashTableWithFlags(HashFunc hashFunc, int capacity,
+    float maxLoadFactor, int flags);
+HashTable *newHashTable64(HashFunc64 hashFunc64, uint64_t seed, int capacity,
+    float maxLoadFactor, int flags);
 void deleteHashTable(HashTable *ht);
 int insertHashTable(HashTable *ht, const uint8_t *key, size_t nKey,
     const uint8_t *value, size_t nValue);
+int updateHashTable(HashTable *ht, const uint8_t *key, size_t nKey,
+    const uint8_t *value, size_t nValue);
+int removeHashTable(HashTable *ht, const uint8_t *key, size_t nKey);
+int compactHashTable(HashTable *ht);
 int getHashTable(const HashTable *ht, const uint8_t *key, size_t nKey);
+int getByHashHashTable(const HashTable *ht, uint32_t hash, const uint8_t *key,
+    size_t nKey);
+int getByHash64HashTable(const HashTable *ht, uint64_t hash,
+    const uint8_t *key, size_t nKey);
+uint64_t hashKeyHashTable(const HashTable *ht, const uint8_t *key, size_t nKey);
+size_t getManyHashTable(const HashTable *ht, const uint8_t *const *keys,
+    const size_t *nKeys, size_t count, int *outKVIndex);
 int growHashTable(HashTable *ht, size_t n);
+int reserveHashTable(HashTable *ht, size_t n);
+int hasRoomHashTable(const HashTable *ht, size_t nKey, size_t nValue);
+int stepResizeHashTable(HashTable *ht, size_t n);
+int finishResizeHashTable(HashTable *ht);
 float getLoadFactor(HashTable *ht);
 void *getValueHashTable(const HashTable *ht, const uint8_t *key, size_t nKey);
 uint32_t crc32(const uint8_t *data, size_t n);
 
-#define getCountHashTable(HASH_TABLE_PTR) \
+#define getKVCountHashTable(HASH_TABLE_PTR) \
     (getCountVLArray((HASH_TABLE_PTR)->keys))
+#define getCountHashTable(HASH_TABLE_PTR) \
+    (getKVCountHashTable(HASH_TABLE_PTR) - (HASH_TABLE_PTR)->deadCount)
+#define isDeadHashTable(HASH_TABLE_PTR, KV_INDEX) \
+    (*(char *)getElementArray((HASH_TABLE_PTR)->deadFlags, (KV_INDEX)))
 #define getBucketCountHashTable(HASH_TABLE_PTR) \
     (getCountArray((HASH_TABLE_PTR)->records))
+#define fibonacciHashTable(HASH, SHIFT) \
+    ((uint32_t)((uint32_t)(HASH) * UINT32_C(2654435769)) >> (SHIFT))
+#define isHash64HashTable(HASH_TABLE_PTR) \
+    ((HASH_TABLE_PTR)->flags & HashTableFlags_hash64)
+#define getSlotHashHashTable(HASH_TABLE_PTR, FULL_HASH) \
+    (isHash64HashTable(HASH_TABLE_PTR) ? (uint32_t)((FULL_HASH) >> 32) \
+    : (uint32_t)(FULL_HASH))
+#define shiftHashTable(HASH_TABLE_PTR, HASH, SHIFT) \
+    (isHash64HashTable(HASH_TABLE_PTR) ? (uint32_t)(HASH) >> (SHIFT) \
+    : fibonacciHashTable((HASH), (SHIFT)))
+#define isPow2BucketsHashTable(HASH_TABLE_PTR) \
+    ((HASH_TABLE_PTR)->flags \
+    & (HashTableFlags_pow2Buckets | HashTableFlags_openAddressing))
 #define getBucketIDHashTable(HASH_TABLE_PTR, HASH) \
-     ((HASH) % getBucketCountHashTable(HASH_TABLE_PTR))
+    (isPow2BucketsHashTable(HASH_TABLE_PTR) \
+    ? shiftHashTable((HASH_TABLE_PTR), (HASH), \
+    (HASH_TABLE_PTR)->bucketShift) \
+    : (HASH) % getBucketCountHashTable(HASH_TABLE_PTR))
+#define isResizingHashTable(HASH_TABLE_PTR) \
+    ((HASH_TABLE_PTR)->oldRecords != NULL)
+#define getOldBucketIDHashTable(HASH_TABLE_PTR, HASH) \
+    (isPow2BucketsHashTable(HASH_TABLE_PTR) \
+    ? shiftHashTable((HASH_TABLE_PTR), (HASH), \
+    (HASH_TABLE_PTR)->oldBucketShift) \
+    : (HASH) % getCountArray((HASH_TABLE_PTR)->oldRecords))
 #define getBucketPtrFromBucketIDHashTable(HASH_TABLE_PTR, BUCKET_ID) \
     ((Array **)getElementArray((HASH_TABLE_PTR)->records, (BUCKET_ID)))
+#define isOpenAddressingHashTable(HASH_TABLE_PTR) \
+    ((HASH_TABLE_PTR)->flags & HashTableFlags_openAddressing)
+#define getSlotCountHashTable(HASH_TABLE_PTR) \
+    (getCountArray((HASH_TABLE_PTR)->slots))
+#define getSlotHashTable(HASH_TABLE_PTR, SLOT_ID) \
+    ((HashTableSlot *)getElementArray((HASH_TABLE_PTR)->slots, (SLOT_ID)))
+#define getHash64HashTable(HASH_TABLE_PTR, KV_INDEX) \
+    (isHash64HashTable(HASH_TABLE_PTR) \
+    ? *(uint64_t *)getElementArray((HASH_TABLE_PTR)->hashes, (KV_INDEX)) \
+    : *(uint32_t *)getElementArray((HASH_TABLE_PTR)->hashes, (KV_INDEX)))
 #define getHashHashTable(HASH_TABLE_PTR, KV_INDEX) \
-    (*(uint32_t *)getElementArray((HASH_TABLE_PTR)->hashes, (KV_INDEX)))
+    (getSlotHashHashTable((HASH_TABLE_PTR), \
+    getHash64HashTable((HASH_TABLE_PTR), (KV_INDEX))))
+#define getSizeofHashHashTable(HASH_TABLE_PTR) \
+    (isHash64HashTable(HASH_TABLE_PTR) ? sizeof(uint64_t) : sizeof(uint32_t))
 #define getValueByKVIndexHashTable(HASH_TABLE_PTR, KV_INDEX) \
     (getElementVLArray((HASH_TABLE_PTR)->values, (KV_INDEX)))
 #define getSizeofValueHashTable(HASH_TABLE_PTR, KV_INDEX) \
@@ -0,0 +1,132 @@
+/* Aidan Bird 2021 */
+
+#include <stdlib.h>
+
+#include "intern_pool.h"
+#include "hashing.h"
+
+#define INTERN_POOL_MAX_LOAD_FACTOR 0.75f
+
+/*
+ * REQUIRES
+ * none
+ *
+ * MODIFIES
+ * none
+ *
+ * EFFECTS
+ * constructs an empty pool with room for capacity distinct strings.
+ * if capacity < 0, then the default capacity is used.
+ * returns null on error
+ */
+InternPool *
+newInternPool(int capacity)
+{
+    InternPool *ret;
+
+    if (!(ret = malloc(sizeof(InternPool))))
+        goto error1;
+    /*
+     * the values are empty, so packing them means they take no memory.
+     * the strings are hashed with a random seed, so ids can not be flooded
+     * with colliding strings.
+     */
+    if (!(ret->strs = newHashTable64(mixHash64, getRandomSeedHashing(),
+        capacity, INTERN_POOL_MAX_LOAD_FACTOR,
+        HashTableFlags_openAddressing | HashTableFlags_packedValues)))
+        goto error2;
+    ret->internedBytes = 0;
+    return ret;
+error2:;
+    free(ret);
+error1:;
+    return NULL;
+}
+
+/*
+ * REQUIRES
+ * pool is valid
+ *
+ * MODIFIES
+ * pool
+ *
+ * EFFECTS
+ * deletes pool. the strings returned by internLookup() are not valid after
+ * this.
+ */
+void
+deleteInternPool(InternPool *pool)
+{
+    deleteHashTable(pool->strs);
+    free(pool);
+}
+
+/*
+ * REQUIRES
+ * str is n bytes long (it does not need to be null terminated)
+ *
+ * MODIFIES
+ * pool
+ *
+ * EFFECTS
+ * returns the id of str, and adds str to pool if it is not in pool yet.
+ * ids are numbered from 0 in the order that the strings were added.
+ * returns negative on error
+ */
+int
+internStr(InternPool *pool, const char *str, size_t n)
+{
+    uint64_t hash;
+    int ret;
+
+    pool->internedBytes += n;
+    hash = hashKeyHashTable(pool->strs, (const uint8_t *)str, n);
+    if ((ret = getByHash64HashTable(pool->strs, hash, (const uint8_t *)str,
+        n)) >= 0)
+        return ret;
+    return insertHashTable(pool->strs, (const uint8_t *)str, n, NULL, 0);
+}
+
+/*
+ * REQUIRES
+ * str is n bytes long
+ *
+ * EFFECTS
+ * returns the id of str without adding it to pool.
+ * returns negative if str is not in pool.
+ */
+int
+internFind(const InternPool *pool, const char *str, size_t n)
+{
+    return getHashTable(pool->strs, (const uint8_t *)str, n);
+}
+
+/*
+ * REQUIRES
+ * id was returned by internStr(pool, ...)
+ *
+ * EFFECTS
+ * returns the bytes of the string with id. The string is
+ * getLengthInternPool(pool, id) bytes long and is not null terminated.
+ * the pointer is valid until the next call to internStr().
+ */
+const char *
+internLookup(const InternPool *pool, int id)
+{
+    return (const char *)getKeyHashTable(pool->strs, id);
+}
+
+/*
+ * EFFECTS
+ * returns the number of bytes that the strings in pool take, including
+ * their index entries and hashes (but not unused capacity).
+ */
+size_t
+getUsedBytesInternPool(const InternPool *pool)
+{
+    return getUsedBytesVLArray(pool->strs->keys)
+        + getUsedBytesVLArray(pool->strs->values)
+        + sizeofArray(pool->strs->hashes)
+        + sizeofArray(pool->strs->deadFlags)
+        + sizeofArray(pool->strs->slots);
+}
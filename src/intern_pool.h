@@ -0,0 +1,53 @@
+#ifndef ALIB_INTERN_POOL_H
+#define ALIB_INTERN_POOL_H
+
+/*
+ * A pool of interned strings: each distinct string is stored once and is
+ * named by a small integer id, so equal strings have equal ids and can be
+ * compared without touching their bytes.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hashtable.h"
+
+#define getCountInternPool(INTERN_POOL_PTR) \
+    (getKVCountHashTable((INTERN_POOL_PTR)->strs))
+#define getLengthInternPool(INTERN_POOL_PTR, ID) \
+    (getSizeofKeyHashTable((INTERN_POOL_PTR)->strs, (ID)))
+
+typedef struct InternPool InternPool;
+
+InternPool *newInternPool(int capacity);
+void deleteInternPool(InternPool *pool);
+int internStr(InternPool *pool, const char *str, size_t n);
+int internFind(const InternPool *pool, const char *str, size_t n);
+const char *internLookup(const InternPool *pool, int id);
+size_t getUsedBytesInternPool(const InternPool *pool);
+
+/*
+ * INTERN POOL DETAILS AND FIELDS
+ *
+ * strs = maps each distinct string to its id. The strings are the keys, so
+ * the id of a string is its kvIndex, and the bytes of all of the strings
+ * are packed one after another (see newVLArrayPacked()). The values are
+ * empty. Strings are never removed, so ids stay valid as long as the pool.
+ * Strings are not null terminated: internLookup() returns the first byte,
+ * and getLengthInternPool() returns the length.
+ *
+ * internedBytes = the number of bytes that have been passed to internStr(),
+ * including repeats. internedBytes - getSizeVLArray(strs->keys) is the
+ * number of bytes that interning saved.
+ *
+ * A pool can be shared by any number of LWStringBuilders, CSV loaders and
+ * hash tables (e.g., keyed by id). It is not thread safe.
+ */
+
+struct InternPool
+{
+    HashTable *strs;
+    size_t internedBytes;
+};
+
+#endif
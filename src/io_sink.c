@@ -0,0 +1,269 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "./io_sink.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#define IO_SINK_HAS_WRITEV
+/* the most iovecs that are passed to one writev() call */
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define IO_SINK_MAX_FRAGMENTS IOV_MAX
+#else
+#define IO_SINK_MAX_FRAGMENTS 1024
+#endif
+#else
+#define IO_SINK_MAX_FRAGMENTS 1024
+#endif
+
+#define IO_SINK_STAGING_SIZE (64 * 1024)
+/* referenced fragments shorter than this are copied instead */
+#define IO_SINK_MIN_REF_SIZE 256
+
+static IOSink *newIOSinkHelper(int fd, FILE *fp);
+static int fwriteIOSink(IOSink *sink);
+#ifdef IO_SINK_HAS_WRITEV
+static int writevIOSink(IOSink *sink);
+#endif
+
+static IOSink *
+newIOSinkHelper(int fd, FILE *fp)
+{
+    IOSink *ret;
+
+    if (!(ret = malloc(sizeof(IOSink))))
+        goto error1;
+    if (!(ret->fragments = malloc(IO_SINK_MAX_FRAGMENTS
+        * sizeof(IOSinkFragment))))
+        goto error2;
+    if (!(ret->staging = malloc(IO_SINK_STAGING_SIZE)))
+        goto error3;
+    ret->fd = fd;
+    ret->fp = fp;
+    ret->nFragments = 0;
+    ret->nStaged = 0;
+    ret->nWrites = 0;
+    ret->error = 0;
+    return ret;
+error3:;
+    free(ret->fragments);
+error2:;
+    free(ret);
+error1:;
+    return NULL;
+}
+
+/*
+ * REQUIRES
+ * fd is open for writing
+ *
+ * EFFECTS
+ * constructs a sink that writes to fd with writev().
+ * the sink does not own fd.
+ * returns NULL on error
+ */
+IOSink *
+newFdIOSink(int fd)
+{
+    return newIOSinkHelper(fd, NULL);
+}
+
+/*
+ * REQUIRES
+ * fp is open for writing, and is not written to while the sink has
+ * pending output
+ *
+ * EFFECTS
+ * constructs a sink that writes to fp. fp is flushed before each flush of
+ * the sink, so output that was written to fp earlier stays in order.
+ * the sink does not own fp.
+ * returns NULL on error
+ */
+IOSink *
+newFILEIOSink(FILE *fp)
+{
+#ifdef IO_SINK_HAS_WRITEV
+    return newIOSinkHelper(fileno(fp), fp);
+#else
+    return newIOSinkHelper(-1, fp);
+#endif
+}
+
+/*
+ * MODIFIES
+ * sink
+ *
+ * EFFECTS
+ * flushes sink, and deletes it.
+ * returns non-zero if any write failed
+ */
+int
+deleteIOSink(IOSink *sink)
+{
+    int ret;
+
+    ret = flushIOSink(sink);
+    free(sink->staging);
+    free(sink->fragments);
+    free(sink);
+    return ret;
+}
+
+/*
+ * REQUIRES
+ * data is n bytes long
+ *
+ * MODIFIES
+ * sink
+ *
+ * EFFECTS
+ * appends a copy of data to the output of sink. Writes that are larger
+ * than the staging buffer are written right away, without copying.
+ * returns non-zero on error
+ */
+int
+writeIOSink(IOSink *sink, const void *data, size_t n)
+{
+    IOSinkFragment *last;
+    char *dst;
+
+    if (sink->error)
+        return -1;
+    if (!n)
+        return 0;
+    if (n >= IO_SINK_STAGING_SIZE)
+        return writeRefIOSink(sink, data, n) || flushIOSink(sink);
+    if ((n > IO_SINK_STAGING_SIZE - sink->nStaged
+        || sink->nFragments == IO_SINK_MAX_FRAGMENTS) && flushIOSink(sink))
+        return -1;
+    dst = sink->staging + sink->nStaged;
+    memcpy(dst, data, n);
+    sink->nStaged += n;
+    /* a copy that follows a copy extends its fragment */
+    last = sink->nFragments ? &sink->fragments[sink->nFragments - 1] : NULL;
+    if (last && last->data + last->n == dst) {
+        last->n += n;
+    } else {
+        sink->fragments[sink->nFragments++] = (IOSinkFragment) {
+            .data = dst,
+            .n = n,
+        };
+    }
+    return 0;
+}
+
+/*
+ * REQUIRES
+ * data is n bytes long, and is not modified or freed until the next flush
+ * of sink (by flushIOSink(), deleteIOSink(), or a write that fills sink)
+ *
+ * MODIFIES
+ * sink
+ *
+ * EFFECTS
+ * appends data to the output of sink without copying it (unless it is
+ * short, then it is copied by writeIOSink()).
+ * returns non-zero on error
+ */
+int
+writeRefIOSink(IOSink *sink, const void *data, size_t n)
+{
+    if (sink->error)
+        return -1;
+    if (n < IO_SINK_MIN_REF_SIZE)
+        return writeIOSink(sink, data, n);
+    if (sink->nFragments == IO_SINK_MAX_FRAGMENTS && flushIOSink(sink))
+        return -1;
+    sink->fragments[sink->nFragments++] = (IOSinkFragment) {
+        .data = data,
+        .n = n,
+    };
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * sink
+ *
+ * EFFECTS
+ * writes the pending output of sink, with one writev() per
+ * IO_SINK_MAX_FRAGMENTS fragments (unless the fd takes partial writes).
+ * returns non-zero on error (or if an earlier write failed)
+ */
+int
+flushIOSink(IOSink *sink)
+{
+    int ret;
+
+    if (sink->error)
+        return -1;
+    if (!sink->nFragments)
+        return 0;
+#ifdef IO_SINK_HAS_WRITEV
+    if (sink->fd >= 0)
+        ret = writevIOSink(sink);
+    else
+        ret = sink->fp ? fwriteIOSink(sink) : -1;
+#else
+    ret = sink->fp ? fwriteIOSink(sink) : -1;
+#endif
+    sink->nFragments = 0;
+    sink->nStaged = 0;
+    if (ret)
+        sink->error = 1;
+    return ret;
+}
+
+static int
+fwriteIOSink(IOSink *sink)
+{
+    const IOSinkFragment *fragment;
+
+    for (size_t i = 0; i < sink->nFragments; i++) {
+        fragment = &sink->fragments[i];
+        sink->nWrites++;
+        if (fwrite(fragment->data, sizeof(char), fragment->n, sink->fp)
+            != fragment->n)
+            return -1;
+    }
+    return 0;
+}
+
+#ifdef IO_SINK_HAS_WRITEV
+static int
+writevIOSink(IOSink *sink)
+{
+    struct iovec iov[IO_SINK_MAX_FRAGMENTS];
+    ssize_t nWritten;
+    size_t n;
+
+    if (sink->fp && fflush(sink->fp))
+        return -1;
+    n = sink->nFragments;
+    for (size_t i = 0; i < n; i++) {
+        iov[i].iov_base = (void *)sink->fragments[i].data;
+        iov[i].iov_len = sink->fragments[i].n;
+    }
+    /* writev() may write only part of the iovecs */
+    for (size_t i = 0; i < n;) {
+        sink->nWrites++;
+        if ((nWritten = writev(sink->fd, iov + i, n - i)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        for (; i < n && (size_t)nWritten >= iov[i].iov_len; i++)
+            nWritten -= iov[i].iov_len;
+        if (i < n) {
+            iov[i].iov_base = (char *)iov[i].iov_base + nWritten;
+            iov[i].iov_len -= nWritten;
+        }
+    }
+    return 0;
+}
+#endif
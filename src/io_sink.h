@@ -0,0 +1,65 @@
+#ifndef ALIB_IO_SINK_H
+#define ALIB_IO_SINK_H
+
+/*
+ * An output that gathers many small writes into a few large ones: written
+ * fragments are batched as iovecs (copied into a staging buffer, or
+ * referenced in place) and flushed with writev().
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct IOSink IOSink;
+typedef struct IOSinkFragment IOSinkFragment;
+
+IOSink *newFdIOSink(int fd);
+IOSink *newFILEIOSink(FILE *fp);
+int deleteIOSink(IOSink *sink);
+int writeIOSink(IOSink *sink, const void *data, size_t n);
+int writeRefIOSink(IOSink *sink, const void *data, size_t n);
+int flushIOSink(IOSink *sink);
+
+/*
+ * IO SINK DETAILS AND FIELDS
+ *
+ * fd, fp = where the output goes. FILE sinks flush fp, and then write to
+ * its file descriptor, so fragments skip the stdio buffer. If fp has no
+ * file descriptor (or the platform has no writev()), each fragment is
+ * fwrite()n to fp instead.
+ *
+ * fragments, nFragments = the pending output, in order. Each fragment
+ * points into staging or at data passed to writeRefIOSink().
+ *
+ * staging, nStaged = bytes that were copied by writeIOSink(). Consecutive
+ * copies extend the same fragment, so a million tiny writes turn into a
+ * few staging-sized fragments.
+ *
+ * The sink is flushed when staging or fragments are full, so the output
+ * takes about one writev() per IO_SINK_STAGING_SIZE bytes (or
+ * IO_SINK_MAX_FRAGMENTS referenced fragments).
+ *
+ * nWrites = the number of writev() (or fwrite()) calls made so far.
+ * error = non-zero once a write has failed. Later writes are dropped, and
+ * flushIOSink() and deleteIOSink() return non-zero.
+ */
+
+struct IOSinkFragment
+{
+    const char *data;
+    size_t n;
+};
+
+struct IOSink
+{
+    int fd;
+    FILE *fp;
+    IOSinkFragment *fragments;
+    size_t nFragments;
+    char *staging;
+    size_t nStaged;
+    size_t nWrites;
+    int error;
+};
+
+#endif
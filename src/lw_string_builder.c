@@ -3,44 +3,91 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 
 #include "./lw_string_builder.h"
-#include "./hashtable.h"
-#include "./hashing.h"
+#include "./utils.h"
+
+/* formatted pushes that are shorter than this are not malloc()ed */
+#define LWSB_FMT_BUFFER_SIZE 256
 
 typedef struct LWSBRecord LWSBRecord;
 
 struct LWSBRecord
 {
-    size_t kvIndex;
+    uint32_t id;
 };
 
+/*
+ * records = the id of each pushed string in pool, in the order they were
+ * pushed.
+ * pool = stores each distinct string once. It is either owned by the sb,
+ * or shared with other sbs (see newLWStringBuilderWithPool()).
+ * size = the length of the built string.
+ * flat, nFlatRecords = a cache of the built string (null terminated), made
+ * from the first nFlatRecords records. It is only made when the string is
+ * read, and is extended with the records pushed since then, so reading the
+ * string of a sb that only grows costs only the newly pushed bytes.
+ */
 struct LWStringBuilder
 {
     Array *records;
-    HashTable *strs;
+    InternPool *pool;
+    int isPoolOwned;
     size_t size;
-    int isDirty;
+    Array *flat;
+    size_t nFlatRecords;
 };
 
 static size_t writeSome(LWStringBuilder *sb, char *buf, size_t n);
-static void writeAll(LWStringBuilder *sb, char *buf);
+static int flattenLWStringBuilder(LWStringBuilder *sb);
 
 LWStringBuilder *
 newLWStringBuilder()
 {
     LWStringBuilder *ret;
+    InternPool *pool;
+
+    if (!(pool = newInternPool(-1)))
+        goto error1;
+    if (!(ret = newLWStringBuilderWithPool(pool)))
+        goto error2;
+    ret->isPoolOwned = 1;
+    return ret;
+error2:;
+    deleteInternPool(pool);
+error1:;
+    return NULL;
+}
+
+/*
+ * REQUIRES
+ * pool is valid, and outlives the sb
+ *
+ * EFFECTS
+ * constructs a sb that stores its strings in pool, so strings that are
+ * pushed into several sbs (or interned elsewhere) are only stored once.
+ * returns NULL on error
+ */
+LWStringBuilder *
+newLWStringBuilderWithPool(InternPool *pool)
+{
+    LWStringBuilder *ret;
+
     if (!(ret = malloc(sizeof(LWStringBuilder)))) 
         goto error1;
-    if (!(ret->records = newArray(-1, -1, sizeof(LWSBRecord))))
+    if (!(ret->records = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        -1, sizeof(LWSBRecord), 0)))
         goto error2;
-    if (!(ret->strs = newHashTable(crc32, -1, 0.75)))
+    if (!(ret->flat = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        -1, sizeof(char), 0)))
         goto error3;
+    ret->pool = pool;
+    ret->isPoolOwned = 0;
     ret->size = 0;
-    ret->isDirty = 0;
+    ret->nFlatRecords = 0;
+    *(char *)ret->flat->first = '\0';
     return ret;
-// error4:;
-//     deleteHashTable(ret->strs);
 error3:;
     deleteArray(ret->records);
 error2:;
@@ -49,90 +96,60 @@ error1:;
     return NULL;
 }
 
-static void
-writeAll(LWStringBuilder *sb, char *buf)
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * appends the records that were pushed since the last call to the cached
+ * string (see LWStringBuilder).
+ * returns non-zero on error
+ */
+static int
+flattenLWStringBuilder(LWStringBuilder *sb)
 {
-    size_t kvIndex;
-    size_t nextStrSize;
+    Array *tmp;
+    uint32_t id;
     size_t nextStrLen;
-    const char *nextStr;
+    char *buf;
 
-    for (size_t i = 0; i < getCountArray(sb->records); i++) {
-        /* get kv details */
-        kvIndex = ((LWSBRecord *)getElementArray(sb->records, i))->kvIndex;
-        nextStr = (const char *)getKeyHashTable(sb->strs, kvIndex);
-        nextStrSize = getSizeofKeyHashTable(sb->strs, kvIndex);
-        /* check if the string is a string or just one char */
-        switch (nextStrSize) {
-            case 0:
-                /* the next str is empty; ignore it */
-                break;
-            case 1:
-                /* 
-                 * the next str is actually just one char.
-                 * if it is NULL, ignore it
-                 */
-                if (!*nextStr)
-                    continue;
-                /* the string is not null; write it to buf */
-                *buf = *nextStr;
-                buf++;
-                break;
-            default:
-                /* 
-                 * the next str is a null terminated str.
-                 * write the string to buf.
-                 */
-                nextStrLen = nextStrSize - 1;
-                memcpy(buf, nextStr, nextStrLen);
-                buf += nextStrLen;
-                break;
-        }
+    if (sb->nFlatRecords == getCountArray(sb->records))
+        return 0;
+    if (!(tmp = growArray(sb->flat, sb->size - getCountArray(sb->flat) + 1)))
+        return -1;
+    sb->flat = tmp;
+    buf = (char *)getElementArray(sb->flat, getCountArray(sb->flat));
+    for (; sb->nFlatRecords < getCountArray(sb->records); sb->nFlatRecords++) {
+        id = ((LWSBRecord *)getElementArray(sb->records,
+            sb->nFlatRecords))->id;
+        nextStrLen = getLengthInternPool(sb->pool, id);
+        memcpy(buf, internLookup(sb->pool, id), nextStrLen);
+        buf += nextStrLen;
     }
     /* add null terminator */
     *buf = '\0';
+    sb->flat->count = sb->size;
+    return 0;
 }
 
 static size_t
 writeSome(LWStringBuilder *sb, char *buf, size_t n)
 {
     size_t ret;
-    size_t kvIndex;
-    size_t nextStrSize;
-    size_t nextStrLen;
+    uint32_t id;
     size_t nextWriteSize;
-    const char *nextStr;
 
     ret = 0;
     for (size_t i = 0; (i < getCountArray(sb->records)) && (ret < n); i++) {
-        /* get kv details */
-        kvIndex = ((LWSBRecord *)getElementArray(sb->records, i))->kvIndex;
-        nextStr = (const char *)getKeyHashTable(sb->strs, kvIndex);
-        nextStrSize = getSizeofKeyHashTable(sb->strs, kvIndex);
-        /* check if the string is a string or just one char */
-        if (nextStrSize == 1) {
-            /* 
-             * the next str is actually just one char.
-             * if it is NULL, ignore it
-             */
-            if (!*nextStr)
-                continue;
-            /* the string is not null; write it to buf */
-            *buf = *nextStr;
-            ret++;
-        } else {
-            /* the next str is a null terminated str */
-            nextStrLen = nextStrSize - 1;
-            /* if needed, limit write Length so that it fits in buf */
-            nextWriteSize = ret + nextStrLen > n ? n - ret : nextStrLen;
-            /* write the string to buf */
-            memcpy(buf, nextStr, nextWriteSize);
-            ret += nextWriteSize;
-            buf += nextWriteSize;
-        }
-        /* add null terminator */
-        *buf = '\0';
+        id = ((LWSBRecord *)getElementArray(sb->records, i))->id;
+        /* if needed, limit write Length so that it fits in buf */
+        nextWriteSize = MIN(getLengthInternPool(sb->pool, id), n - ret);
+        memcpy(buf, internLookup(sb->pool, id), nextWriteSize);
+        ret += nextWriteSize;
+        buf += nextWriteSize;
     }
+    /* add null terminator */
+    *buf = '\0';
     return ret;
 }
 
@@ -144,18 +161,19 @@ writeSome(LWStringBuilder *sb, char *buf, size_t n)
  * sb, buf
  *
  * EFFECTS
- * writes (at most) n chars to buf using sb.
+ * writes (at most) n chars to buf using sb, and a null terminator.
  * returns the number of chars written.
  */
 size_t
 writeLWStringBuilder(LWStringBuilder *sb, char *buf, size_t n)
 {
-    if (n >= LWStringBuilderGetSize(sb)) {
-        /* write all if buf can store the entire result */
-        writeAll(sb, buf);
-        return n;
-    }
-    return writeSome(sb, buf, n);
+    /* without the cached string, write the records one at a time */
+    if (flattenLWStringBuilder(sb))
+        return writeSome(sb, buf, n);
+    n = MIN(n, sb->size);
+    memcpy(buf, sb->flat->first, n);
+    buf[n] = '\0';
+    return n;
 }
 
 /*
@@ -163,7 +181,28 @@ writeLWStringBuilder(LWStringBuilder *sb, char *buf, size_t n)
  * sb, outLen
  *
  * EFFECTS
+ * returns the built string. The string is owned by sb, and is valid until
+ * the next push into sb. Only the strings pushed since the last call are
+ * copied.
+ * returns NULL on error
+ */
+const char *
+LWStringBuilderGetString(LWStringBuilder *sb, size_t *outLen)
+{
+    if (flattenLWStringBuilder(sb))
+        return NULL;
+    if (outLen)
+        *outLen = sb->size;
+    return sb->flat->first;
+}
+
+/*
+ * MODIFIES
+ * sb, outLen
  *
+ * EFFECTS
+ * returns a copy of the built string, which must be freed.
+ * returns NULL on error
  */
 char *
 LWStringBuilderToString(LWStringBuilder *sb, size_t *outLen)
@@ -183,30 +222,9 @@ error1:;
     return NULL;
 }
 
-static size_t
-getSize(const LWStringBuilder *sb)
-{
-    size_t ret;
-    size_t sizeofKey;
-    size_t occurrences;
-
-    ret = 0;
-    for (size_t i = 0; i < getCountHashTable(sb->strs); i++) {
-        sizeofKey = getSizeofKeyHashTable(sb->strs, i);
-        occurrences = *(size_t *)getValueByKVIndexHashTable(sb->strs, i);
-        /* exclude NULL terminators from count */
-        ret += (sizeofKey + (sizeofKey > 1 ? -1 : 0)) * occurrences;
-    }
-    return ret;
-}
-
 size_t
 LWStringBuilderGetSize(LWStringBuilder *sb)
 {
-    if (!sb->isDirty)
-        return sb->size;
-    sb->size = getSize(sb);
-    sb->isDirty = 0;
     return sb->size;
 }
 
@@ -241,40 +259,95 @@ LWStringBuilderPushChar(LWStringBuilder *sb, const char c)
 int
 LWStringBuilderPushNStr(LWStringBuilder *sb, const char *str, size_t nStr)
 {
-    size_t repCount;
-    int kvIndex;
+    int id;
     LWSBRecord newRecord;
-    size_t keySize;
 
-    if (!*str)
+    if (!nStr)
         return 0;
     /* 
-     * strings are mapped to the number of times they are pushed into the sb.
-     * the records array keeps track of the order in which the strings were
-     * pushed.
+     * each distinct string is stored once in the pool, and the records
+     * array keeps track of the order in which the strings were pushed.
      */
-    /* single character strings are interpreted as single chars */
-    keySize = nStr > 1 ? nStr + sizeof(char) : nStr;
-    /* check if str is alread in sb */
-    kvIndex = getHashTable(sb->strs, (uint8_t *)str, keySize);
-    if (kvIndex < 0) {
-        /* str is not in sb, so insert it. */
-        repCount = 1;
-        if ((kvIndex = insertHashTable(sb->strs, (uint8_t *)str, keySize,
-            (uint8_t *)&repCount, sizeof(size_t))) < 0) {
-            return -1;
-        }
-    } else {
-        /* str is in sb. Increment the occurrence counter. */
-        (*(size_t *)getValueByKVIndexHashTable(sb->strs, kvIndex))++;
-    }
-    /* setup record */
+    if ((id = internStr(sb->pool, str, nStr)) < 0)
+        return -1;
     newRecord = (LWSBRecord) {
-        .kvIndex = kvIndex,
+        .id = id,
     };
-    sb->isDirty = 1;
-    /* push new record  */
-    return !(tryPushArray(&sb->records, &newRecord));
+    if (!tryPushArray(&sb->records, &newRecord))
+        return -1;
+    sb->size += nStr;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * push value in decimal into sb (see formatInt64()).
+ * returns non-zero on error
+ */
+int
+LWStringBuilderPushInt(LWStringBuilder *sb, int64_t value)
+{
+    char buffer[FORMAT_INT64_MAX_SIZE];
+
+    return LWStringBuilderPushNStr(sb, buffer, formatInt64(buffer, value));
+}
+
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * push the shortest text (at most 17 significant digits) that parses back
+ * to value into sb (see formatDouble()).
+ * returns non-zero on error
+ */
+int
+LWStringBuilderPushDouble(LWStringBuilder *sb, double value)
+{
+    char buffer[FORMAT_DOUBLE_MAX_SIZE];
+
+    return LWStringBuilderPushNStr(sb, buffer, formatDouble(buffer, value));
+}
+
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * push the text that printf(fmt, ...) prints into sb. The text is
+ * formatted on the stack (or in a malloc()ed buffer if it is long), and is
+ * interned from there.
+ * returns non-zero on error
+ */
+int
+LWStringBuilderPushFmt(LWStringBuilder *sb, const char *fmt, ...)
+{
+    char buffer[LWSB_FMT_BUFFER_SIZE];
+    char *str;
+    va_list args;
+    va_list argsCopy;
+    int n;
+    int ret;
+
+    va_start(args, fmt);
+    va_copy(argsCopy, args);
+    str = buffer;
+    n = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    if (n >= (int)sizeof(buffer)) {
+        if ((str = malloc(n + 1)))
+            n = vsnprintf(str, n + 1, fmt, argsCopy);
+        else
+            n = -1;
+    }
+    va_end(argsCopy);
+    va_end(args);
+    ret = n < 0 ? -1 : LWStringBuilderPushNStr(sb, str, n);
+    if (str != buffer)
+        free(str);
+    return ret;
 }
 
 void
@@ -283,46 +356,62 @@ deleteLWStringBuilder(LWStringBuilder *sb)
     if (!sb)
         return;
     deleteArray(sb->records);
-    deleteHashTable(sb->strs);
+    deleteArray(sb->flat);
+    if (sb->isPoolOwned)
+        deleteInternPool(sb->pool);
     free(sb);
 }
 
 /*
+ * MODIFIES
+ * sink
  *
+ * EFFECTS
+ * appends the built string to the output of sink. If the cached string is
+ * up to date, it is referenced (so sb must not be modified until sink is
+ * flushed); otherwise each pushed string is copied into sink, so the
+ * string is not built.
+ * returns non-zero on error
+ */
+int
+LWStringBuilderWriteSink(LWStringBuilder *sb, IOSink *sink)
+{
+    uint32_t id;
+
+    if (sb->nFlatRecords == getCountArray(sb->records))
+        return writeRefIOSink(sink, sb->flat->first, sb->size);
+    for (size_t i = 0; i < getCountArray(sb->records); i++) {
+        id = ((LWSBRecord *)getElementArray(sb->records, i))->id;
+        if (writeIOSink(sink, internLookup(sb->pool, id),
+            getLengthInternPool(sb->pool, id)))
+            return -1;
+    }
+    return 0;
+}
+
+/*
  * MODIFIES
  * stdout
  *
  * EFFECTS
- * constructs sb and writes it to stdout
+ * writes the built string to stdout. The pushed strings are gathered into
+ * a few large writes (see IOSink).
  */
-/* XXX IDEA, save a cahced version of the pre-constructed string, 
- * use that for printing */
 void
-LWStringBuilderPrintInplace(const LWStringBuilder *sb)
+LWStringBuilderPrintInplace(LWStringBuilder *sb)
 {
-    size_t kvIndex;
-    size_t nextStrSize;
-    const char *nextStr;
+    IOSink *sink;
+    uint32_t id;
 
+    if ((sink = newFILEIOSink(stdout))) {
+        LWStringBuilderWriteSink(sb, sink);
+        deleteIOSink(sink);
+        return;
+    }
     for (size_t i = 0; i < getCountArray(sb->records); i++) {
-        /* get kv details */
-        kvIndex = ((LWSBRecord *)getElementArray(sb->records, i))->kvIndex;
-        nextStr = (const char *)getKeyHashTable(sb->strs, kvIndex);
-        nextStrSize = getSizeofKeyHashTable(sb->strs, kvIndex);
-        /* check if the string is a string or just one char */
-        if (nextStrSize == 1) {
-            /* 
-             * the next str is actually just one char.
-             * if it is NULL, ignore it
-             */
-            if (!*nextStr)
-                continue;
-            /* print the char */
-            putchar(*nextStr);
-        } else {
-            /* the next str is a null terminated str; print it */
-            fwrite(nextStr, sizeof(char), nextStrSize - 1, stdout);
-        }
+        id = ((LWSBRecord *)getElementArray(sb->records, i))->id;
+        fwrite(internLookup(sb->pool, id), sizeof(char),
+            getLengthInternPool(sb->pool, id), stdout);
     }
 }
 
@@ -2,17 +2,27 @@
 #define LW_STRING_BUILDER_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include "./intern_pool.h"
+#include "./io_sink.h"
 
 typedef struct LWStringBuilder LWStringBuilder;
 
 LWStringBuilder *newLWStringBuilder();
+LWStringBuilder *newLWStringBuilderWithPool(InternPool *pool);
 size_t writeLWStringBuilder(LWStringBuilder *sb, char *buf, size_t n);
 char *LWStringBuilderToString(LWStringBuilder *sb, size_t *outLen);
 size_t LWStringBuilderGetSize(LWStringBuilder *sb);
 int LWStringBuilderPushStr(LWStringBuilder *sb, const char *str);
 int LWStringBuilderPushChar(LWStringBuilder *sb, const char c);
 int LWStringBuilderPushNStr(LWStringBuilder *sb, const char *str, size_t nStr);
+int LWStringBuilderPushInt(LWStringBuilder *sb, int64_t value);
+int LWStringBuilderPushDouble(LWStringBuilder *sb, double value);
+int LWStringBuilderPushFmt(LWStringBuilder *sb, const char *fmt, ...);
 void deleteLWStringBuilder(LWStringBuilder *sb);
-void LWStringBuilderPrintInplace(const LWStringBuilder *sb);
+void LWStringBuilderPrintInplace(LWStringBuilder *sb);
+int LWStringBuilderWriteSink(LWStringBuilder *sb, IOSink *sink);
+const char *LWStringBuilderGetString(LWStringBuilder *sb, size_t *outLen);
 
 #endif
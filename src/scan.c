@@ -0,0 +1,291 @@
+#include <string.h>
+
+#include "./scan.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SCAN_HAS_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#define SCAN_QUOTE '"'
+#define SCAN_NEWLINE '\n'
+#define SCAN_RETURN '\r'
+
+typedef void (*ScanBlockFunc)(const uint8_t *block, uint8_t delimiter,
+    ScanMasks *out);
+typedef uint64_t (*MatchBlockFunc)(const uint8_t *block, uint8_t b);
+
+static void initScan(void);
+static void scanBlockScalar(const uint8_t *block, uint8_t delimiter,
+    ScanMasks *out);
+static uint64_t matchBlockScalar(const uint8_t *block, uint8_t b);
+
+/*
+ * the kernels used by scanBlock() and countByteScan(). They are chosen by
+ * initScan(), which runs before main() on compilers with constructors (and
+ * on the first call otherwise).
+ */
+static ScanBlockFunc scanBlockKernel = scanBlockScalar;
+static MatchBlockFunc matchBlockKernel = matchBlockScalar;
+static const char *kernelName = "scalar";
+static int isInitialized;
+
+#ifdef __GNUC__
+static void initScanConstructor(void) __attribute__((constructor));
+
+static void
+initScanConstructor(void)
+{
+    initScan();
+}
+#endif
+
+static void
+scanBlockScalar(const uint8_t *block, uint8_t delimiter, ScanMasks *out)
+{
+    out->delimiters = 0;
+    out->quotes = 0;
+    out->newlines = 0;
+    out->returns = 0;
+    for (int i = 0; i < SCAN_BLOCK_SIZE; i++) {
+        out->delimiters |= (uint64_t)(block[i] == delimiter) << i;
+        out->quotes |= (uint64_t)(block[i] == SCAN_QUOTE) << i;
+        out->newlines |= (uint64_t)(block[i] == SCAN_NEWLINE) << i;
+        out->returns |= (uint64_t)(block[i] == SCAN_RETURN) << i;
+    }
+}
+
+static uint64_t
+matchBlockScalar(const uint8_t *block, uint8_t b)
+{
+    uint64_t ret;
+
+    ret = 0;
+    for (int i = 0; i < SCAN_BLOCK_SIZE; i++)
+        ret |= (uint64_t)(block[i] == b) << i;
+    return ret;
+}
+
+#ifdef SCAN_HAS_X86
+/* the mask of the bytes of the 16 byte vector V that equal the vector B */
+#define matchSSE2(V, B) \
+    ((uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8((V), (B))))
+/* the mask of the bytes of the 32 byte vector V that equal the vector B */
+#define matchAVX2(V, B) \
+    ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8((V), (B))))
+
+static void
+scanBlockSSE2(const uint8_t *block, uint8_t delimiter, ScanMasks *out)
+{
+    __m128i v[4];
+    __m128i delimiters;
+    __m128i quotes;
+    __m128i newlines;
+    __m128i returns;
+
+    delimiters = _mm_set1_epi8((char)delimiter);
+    quotes = _mm_set1_epi8(SCAN_QUOTE);
+    newlines = _mm_set1_epi8(SCAN_NEWLINE);
+    returns = _mm_set1_epi8(SCAN_RETURN);
+    for (int i = 0; i < 4; i++)
+        v[i] = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+    out->delimiters = matchSSE2(v[0], delimiters)
+        | matchSSE2(v[1], delimiters) << 16
+        | matchSSE2(v[2], delimiters) << 32
+        | matchSSE2(v[3], delimiters) << 48;
+    out->quotes = matchSSE2(v[0], quotes) | matchSSE2(v[1], quotes) << 16
+        | matchSSE2(v[2], quotes) << 32 | matchSSE2(v[3], quotes) << 48;
+    out->newlines = matchSSE2(v[0], newlines)
+        | matchSSE2(v[1], newlines) << 16
+        | matchSSE2(v[2], newlines) << 32
+        | matchSSE2(v[3], newlines) << 48;
+    out->returns = matchSSE2(v[0], returns)
+        | matchSSE2(v[1], returns) << 16
+        | matchSSE2(v[2], returns) << 32
+        | matchSSE2(v[3], returns) << 48;
+}
+
+static uint64_t
+matchBlockSSE2(const uint8_t *block, uint8_t b)
+{
+    __m128i bytes;
+
+    bytes = _mm_set1_epi8((char)b);
+    return matchSSE2(_mm_loadu_si128((const __m128i *)block), bytes)
+        | matchSSE2(_mm_loadu_si128((const __m128i *)(block + 16)), bytes)
+        << 16
+        | matchSSE2(_mm_loadu_si128((const __m128i *)(block + 32)), bytes)
+        << 32
+        | matchSSE2(_mm_loadu_si128((const __m128i *)(block + 48)), bytes)
+        << 48;
+}
+
+__attribute__((target("avx2")))
+static void
+scanBlockAVX2(const uint8_t *block, uint8_t delimiter, ScanMasks *out)
+{
+    __m256i lo;
+    __m256i hi;
+    __m256i delimiters;
+    __m256i quotes;
+    __m256i newlines;
+    __m256i returns;
+
+    delimiters = _mm256_set1_epi8((char)delimiter);
+    quotes = _mm256_set1_epi8(SCAN_QUOTE);
+    newlines = _mm256_set1_epi8(SCAN_NEWLINE);
+    returns = _mm256_set1_epi8(SCAN_RETURN);
+    lo = _mm256_loadu_si256((const __m256i *)block);
+    hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+    out->delimiters = matchAVX2(lo, delimiters)
+        | matchAVX2(hi, delimiters) << 32;
+    out->quotes = matchAVX2(lo, quotes) | matchAVX2(hi, quotes) << 32;
+    out->newlines = matchAVX2(lo, newlines) | matchAVX2(hi, newlines) << 32;
+    out->returns = matchAVX2(lo, returns) | matchAVX2(hi, returns) << 32;
+}
+
+__attribute__((target("avx2")))
+static uint64_t
+matchBlockAVX2(const uint8_t *block, uint8_t b)
+{
+    __m256i bytes;
+
+    bytes = _mm256_set1_epi8((char)b);
+    return matchAVX2(_mm256_loadu_si256((const __m256i *)block), bytes)
+        | matchAVX2(_mm256_loadu_si256((const __m256i *)(block + 32)), 
+        bytes) << 32;
+}
+#endif
+
+static void
+initScan(void)
+{
+    if (isInitialized)
+        return;
+#ifdef SCAN_HAS_X86
+    /* SSE2 is part of x86-64, so only AVX2 has to be checked for */
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        scanBlockKernel = scanBlockAVX2;
+        matchBlockKernel = matchBlockAVX2;
+        kernelName = "avx2";
+    } else {
+        scanBlockKernel = scanBlockSSE2;
+        matchBlockKernel = matchBlockSSE2;
+        kernelName = "sse2";
+    }
+#endif
+    isInitialized = 1;
+}
+
+/*
+ * REQUIRES
+ * block is SCAN_BLOCK_SIZE bytes long
+ *
+ * MODIFIES
+ * out
+ *
+ * EFFECTS
+ * sets out to the masks of the delimiters, double quotes, newlines (LF)
+ * and carriage returns (CR) in block.
+ */
+void
+scanBlock(const uint8_t *block, uint8_t delimiter, ScanMasks *out)
+{
+    initScan();
+    scanBlockKernel(block, delimiter, out);
+}
+
+/*
+ * REQUIRES
+ * data is n bytes long and n < SCAN_BLOCK_SIZE
+ *
+ * MODIFIES
+ * out
+ *
+ * EFFECTS
+ * same as scanBlock(), but for the last (short) block of the input. None of
+ * the bits past n are set.
+ */
+void
+scanPartialBlock(const uint8_t *data, size_t n, uint8_t delimiter,
+    ScanMasks *out)
+{
+    uint8_t block[SCAN_BLOCK_SIZE];
+    uint64_t mask;
+
+    memcpy(block, data, n);
+    memset(block + n, 0, SCAN_BLOCK_SIZE - n);
+    scanBlock(block, delimiter, out);
+    /* the padding may match a zero delimiter */
+    mask = n ? ~(uint64_t)0 >> (SCAN_BLOCK_SIZE - n) : 0;
+    out->delimiters &= mask;
+    out->quotes &= mask;
+    out->newlines &= mask;
+    out->returns &= mask;
+}
+
+/*
+ * EFFECTS
+ * returns the number of occurrences of b in the first n bytes of src.
+ */
+size_t
+countByteScan(const void *src, size_t n, uint8_t b)
+{
+    const uint8_t *data;
+    size_t ret;
+    size_t i;
+
+    initScan();
+    data = src;
+    ret = 0;
+    for (i = 0; i + SCAN_BLOCK_SIZE <= n; i += SCAN_BLOCK_SIZE)
+        ret += popCountScan(matchBlockKernel(data + i, b));
+    for (; i < n; i++)
+        ret += data[i] == b;
+    return ret;
+}
+
+/*
+ * EFFECTS
+ * returns the name of the kernel that is in use ("avx2", "sse2" or 
+ * "scalar").
+ */
+const char *
+getKernelNameScan(void)
+{
+    initScan();
+    return kernelName;
+}
+
+/*
+ * EFFECTS
+ * returns the index of the lowest set bit of mask.
+ * mask must not be zero.
+ * (used when lowestBitScan() is not a builtin)
+ */
+int
+(lowestBitScan)(uint64_t mask)
+{
+    int ret;
+
+    for (ret = 0; !(mask & 1); ret++)
+        mask >>= 1;
+    return ret;
+}
+
+/*
+ * EFFECTS
+ * returns the number of set bits in mask.
+ * (used when popCountScan() is not a builtin)
+ */
+int
+(popCountScan)(uint64_t mask)
+{
+    int ret;
+
+    for (ret = 0; mask; ret++)
+        mask &= mask - 1;
+    return ret;
+}
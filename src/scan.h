@@ -0,0 +1,44 @@
+#ifndef ALIB_SCAN_H
+#define ALIB_SCAN_H
+
+/*
+ * finds bytes (e.g., csv delimiters, quotes and row ends) 64 bytes at a time
+ * using SIMD compares, and returns them as bitmasks. Bit i of a mask is set
+ * if byte i of the block matches.
+ * uses AVX2 or SSE2 on x86-64 (whichever the CPU supports), and a scalar
+ * loop elsewhere. Every version gives the same masks.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCAN_BLOCK_SIZE 64
+
+typedef struct ScanMasks ScanMasks;
+
+struct ScanMasks
+{
+    uint64_t delimiters;
+    uint64_t quotes;
+    uint64_t newlines;
+    uint64_t returns;
+};
+
+void scanBlock(const uint8_t *block, uint8_t delimiter, ScanMasks *out);
+void scanPartialBlock(const uint8_t *data, size_t n, uint8_t delimiter,
+    ScanMasks *out);
+size_t countByteScan(const void *src, size_t n, uint8_t b);
+int lowestBitScan(uint64_t mask);
+int popCountScan(uint64_t mask);
+const char *getKernelNameScan(void);
+
+/* 
+ * index of the lowest set bit of a non-zero mask, and the number of set
+ * bits of a mask.
+ */
+#if defined(__GNUC__)
+#define lowestBitScan(MASK) (__builtin_ctzll((MASK)))
+#define popCountScan(MASK) (__builtin_popcountll((MASK)))
+#endif
+
+#endif
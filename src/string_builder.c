@@ -1,135 +1,334 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 
 #include "./string_builder.h"
 #include "./array.h"
-#include "./vlarray.h"
+#include "./utils.h"
 
-enum SBTypes
-{
-    SBTypes_str,
-    SBTypes_char,
-};
+/* the size of the first chunk, and the largest that chunks grow to */
+#define SB_MIN_CHUNK_SIZE 4096
+#define SB_MAX_CHUNK_SIZE (1 << 20)
 
-typedef enum SBTypes SBTypes;
-typedef struct SBRecord SBRecord;
+typedef struct SBChunk SBChunk;
 
-struct SBRecord
+/*
+ * a contiguous block of the built string.
+ * count = the number of bytes of data that are used.
+ */
+struct SBChunk
 {
-    SBTypes t;
+    size_t count;
+    size_t capacity;
+    char data[];
 };
 
+/*
+ * chunks = pointers to the chunks, in order. Bytes are appended to the last
+ * chunk until it is full, and then to a new chunk that is twice as large
+ * (up to SB_MAX_CHUNK_SIZE, or larger if one push needs it). Chunks are
+ * never moved or copied, so a push costs a bounds check and a memcpy, and
+ * the string is flattened with one memcpy per chunk.
+ * size = the length of the built string.
+ */
 struct StringBuilder
 {
-    Array *chars;
-    VLArray *strs;
-    Array *records;
+    Array *chunks;
+    SBChunk *tail;
+    size_t size;
 };
 
+#define getChunkSB(SB_PTR, INDEX) \
+    (*(SBChunk **)getElementArray((SB_PTR)->chunks, (INDEX)))
+
+static SBChunk *pushChunkSB(StringBuilder *sb, size_t n);
+static char *reserveTailSB(StringBuilder *sb, size_t n);
+
 size_t
 stringBuilderGetSize(StringBuilder *sb)
 {
-    return sizeofArray(sb->chars) + getSizeVLArray(sb->strs)
-        - getCountVLArray(sb->strs);
+    return sb->size;
+}
+
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * appends a new chunk with room for at least n bytes to sb.
+ * returns the new chunk.
+ * returns NULL on error
+ */
+static SBChunk *
+pushChunkSB(StringBuilder *sb, size_t n)
+{
+    SBChunk *ret;
+    size_t capacity;
+
+    capacity = sb->tail ? MIN(sb->tail->capacity * 2, SB_MAX_CHUNK_SIZE)
+        : SB_MIN_CHUNK_SIZE;
+    capacity = MAX(capacity, n);
+    if (!(ret = malloc(sizeof(SBChunk) + capacity)))
+        goto error1;
+    ret->count = 0;
+    ret->capacity = capacity;
+    if (!tryPushArray(&sb->chunks, &ret))
+        goto error2;
+    sb->tail = ret;
+    return ret;
+error2:;
+    free(ret);
+error1:;
+    return NULL;
+}
+
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * push a string (nStr characters long) into sb. str does not need to be
+ * null terminated.
+ * takes O(nStr) time.
+ * returns non-zero on error
+ */
+int
+stringBuilderPushNStr(StringBuilder *sb, const char *str, size_t nStr)
+{
+    size_t nFits;
+
+    nFits = MIN(nStr, sb->tail->capacity - sb->tail->count);
+    memcpy(sb->tail->data + sb->tail->count, str, nFits);
+    sb->tail->count += nFits;
+    sb->size += nFits;
+    if (nFits == nStr)
+        return 0;
+    /* the rest of str starts a new chunk */
+    if (!pushChunkSB(sb, nStr - nFits))
+        return -1;
+    memcpy(sb->tail->data, str + nFits, nStr - nFits);
+    sb->tail->count = nStr - nFits;
+    sb->size += nStr - nFits;
+    return 0;
 }
 
 int
 stringBuilderPushStr(StringBuilder *sb, const char *str)
 {
-    SBRecord nextRec;
-
-    nextRec = (SBRecord) {
-        .t = SBTypes_str
-    };
-    return !tryPushArray(&sb->records, &nextRec)
-        || !tryPushVLArray(&sb->strs, str, strlen(str) + 1);
+    return stringBuilderPushNStr(sb, str, strlen(str));
 }
 
 int
 stringBuilderPushChar(StringBuilder *sb, const char c)
 {
-    SBRecord nextRec;
+    if (sb->tail->count == sb->tail->capacity && !pushChunkSB(sb, 1))
+        return -1;
+    sb->tail->data[sb->tail->count++] = c;
+    sb->size++;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * returns where the next n bytes can be written to the last chunk, after
+ * starting a new chunk if the last one does not have room for them. The
+ * bytes are pushed by adding to the count of the last chunk.
+ * returns NULL on error
+ */
+static char *
+reserveTailSB(StringBuilder *sb, size_t n)
+{
+    if (sb->tail->capacity - sb->tail->count < n && !pushChunkSB(sb, n))
+        return NULL;
+    return sb->tail->data + sb->tail->count;
+}
+
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * push value in decimal into sb. The digits are written straight into the
+ * last chunk (see formatInt64()).
+ * returns non-zero on error
+ */
+int
+stringBuilderPushInt(StringBuilder *sb, int64_t value)
+{
+    char *dst;
+    size_t n;
+
+    if (!(dst = reserveTailSB(sb, FORMAT_INT64_MAX_SIZE)))
+        return -1;
+    n = formatInt64(dst, value);
+    sb->tail->count += n;
+    sb->size += n;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * push the shortest text (at most 17 significant digits) that parses back
+ * to value into sb, written straight into the last chunk (see
+ * formatDouble()).
+ * returns non-zero on error
+ */
+int
+stringBuilderPushDouble(StringBuilder *sb, double value)
+{
+    char *dst;
+    size_t n;
+
+    if (!(dst = reserveTailSB(sb, FORMAT_DOUBLE_MAX_SIZE)))
+        return -1;
+    n = formatDouble(dst, value);
+    sb->tail->count += n;
+    sb->size += n;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * sb
+ *
+ * EFFECTS
+ * push the text that printf(fmt, ...) prints into sb. It is formatted
+ * straight into the last chunk, and only formatted a second time (into a
+ * new chunk) if the last chunk is too full.
+ * returns non-zero on error
+ */
+int
+stringBuilderPushFmt(StringBuilder *sb, const char *fmt, ...)
+{
+    va_list args;
+    va_list argsCopy;
+    size_t room;
+    int n;
+
+    va_start(args, fmt);
+    va_copy(argsCopy, args);
+    /* vsnprintf() also writes a null terminator, after the pushed text */
+    room = sb->tail->capacity - sb->tail->count;
+    n = vsnprintf(sb->tail->data + sb->tail->count, room, fmt, args);
+    if (n > 0 && (size_t)n >= room) {
+        if (pushChunkSB(sb, n + 1))
+            n = vsnprintf(sb->tail->data, n + 1, fmt, argsCopy);
+        else
+            n = -1;
+    }
+    va_end(argsCopy);
+    va_end(args);
+    if (n < 0)
+        return -1;
+    sb->tail->count += n;
+    sb->size += n;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * sink
+ *
+ * EFFECTS
+ * appends the built string to the output of sink. The chunks are
+ * referenced, not copied, so sb must not be modified until sink is flushed.
+ * returns non-zero on error
+ */
+int
+stringBuilderWriteSink(const StringBuilder *sb, IOSink *sink)
+{
+    const SBChunk *chunk;
+
+    for (size_t i = 0; i < getCountArray(sb->chunks); i++) {
+        chunk = getChunkSB(sb, i);
+        if (writeRefIOSink(sink, chunk->data, chunk->count))
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * fd
+ *
+ * EFFECTS
+ * writes the built string to fd without copying it: the whole string takes
+ * one writev() per 1024 chunks (unless fd takes partial writes).
+ * returns non-zero on error (and if the platform has no writev())
+ */
+int
+stringBuilderWriteFd(const StringBuilder *sb, int fd)
+{
+    IOSink *sink;
 
-    nextRec = (SBRecord) {
-        .t = SBTypes_char
-    };
-    return !tryPushArray(&sb->records, &nextRec)
-        || !tryPushArray(&sb->chars, &c);
+    if (!(sink = newFdIOSink(fd)))
+        return -1;
+    if (stringBuilderWriteSink(sb, sink)) {
+        deleteIOSink(sink);
+        return -1;
+    }
+    return deleteIOSink(sink);
 }
 
+/*
+ * MODIFIES
+ * stdout
+ *
+ * EFFECTS
+ * writes the built string to stdout, with a few large writes.
+ */
 void
 stringBuilderPrintInplace(const StringBuilder *sb)
 {
-    const SBRecord *nextRec;
-    const char *nextStr;
-    size_t istr;
-    size_t ichar;
-
-    istr = 0;
-    ichar = 0;
-    for (size_t i = 0; i < getCountArray(sb->records); i++) {
-        nextRec = (const SBRecord *)getElementArray(sb->records, i);
-        switch (nextRec->t) {
-            case SBTypes_str:
-                nextStr = (const char *)getElementVLArray(sb->strs, istr);
-                printf("%s", nextStr);
-                istr++;
-                break;
-            case SBTypes_char:
-                putchar(*((char *)(getElementArray(sb->chars, ichar))));
-                ichar++;
-                break;
-            default:
-                break;
-        }
+    IOSink *sink;
+    const SBChunk *chunk;
+
+    if ((sink = newFILEIOSink(stdout))) {
+        stringBuilderWriteSink(sb, sink);
+        deleteIOSink(sink);
+        return;
+    }
+    for (size_t i = 0; i < getCountArray(sb->chunks); i++) {
+        chunk = getChunkSB(sb, i);
+        fwrite(chunk->data, sizeof(char), chunk->count, stdout);
     }
 }
 
+/*
+ * MODIFIES
+ * outLen
+ *
+ * EFFECTS
+ * returns the built string (null terminated), which must be freed.
+ * copies each chunk with one memcpy.
+ * returns NULL on error
+ */
 char *
 stringBuilderToString(StringBuilder *sb, size_t *outLen)
 {
-    const SBRecord *nextRec;
+    const SBChunk *chunk;
     char *ret;
-    const char *nextStr;
     size_t writeIndex;
-    size_t nextStrSize;
-    size_t istr;
-    size_t ichar;
 
+    if (!(ret = malloc(stringBuilderGetSize(sb) + 1)))
+        return NULL;
     writeIndex = 0;
-    istr = 0;
-    ichar = 0;
-    ret = malloc(stringBuilderGetSize(sb) + 1);
-    if (!ret)
-        goto error1;
-    for (size_t i = 0; i < getCountArray(sb->records); i++) {
-        nextRec = (const SBRecord *)getElementArray(sb->records, i);
-        switch (nextRec->t) {
-            case SBTypes_str:
-                nextStrSize = sizeOfElementVLArray(sb->strs, istr) - 1;
-                nextStr = (const char *)getElementVLArray(sb->strs, istr);
-                memcpy(ret + writeIndex, nextStr, nextStrSize);
-                writeIndex += nextStrSize;
-                istr++;
-                break;
-            case SBTypes_char:
-                ret[writeIndex] = *(char *)(getElementArray(sb->chars, ichar));
-                writeIndex++;
-                ichar++;
-                break;
-            default:
-                goto error2;
-        }
+    for (size_t i = 0; i < getCountArray(sb->chunks); i++) {
+        chunk = getChunkSB(sb, i);
+        memcpy(ret + writeIndex, chunk->data, chunk->count);
+        writeIndex += chunk->count;
     }
     ret[writeIndex] = '\0';
     if (outLen)
         *outLen = writeIndex;
     return ret;
-error2:;
-    free(ret);
-error1:;
-    return NULL;
 }
 
 StringBuilder *
@@ -140,20 +339,17 @@ newStringBuilder()
     ret = malloc(sizeof(StringBuilder));
     if (!ret)
         goto error1;
-    ret->chars = newArray(-1, -1, sizeof(char));
-    if (!ret->chars)
+    ret->chunks = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1, -1,
+        sizeof(SBChunk *), 0);
+    if (!ret->chunks)
         goto error2;
-    ret->records = newArray(-1, -1, sizeof(SBRecord));
-    if (!ret->records)
+    ret->tail = NULL;
+    ret->size = 0;
+    if (!pushChunkSB(ret, SB_MIN_CHUNK_SIZE))
         goto error3;
-    ret->strs = newVLArray(-1, -1, -1);
-    if (!ret->strs)
-        goto error4;
     return ret;
-error4:;
-    deleteArray(ret->records);
 error3:;
-    deleteArray(ret->chars);
+    deleteArray(ret->chunks);
 error2:;
     free(ret);
 error1:;
@@ -163,9 +359,8 @@ error1:;
 void
 deleteStringBuilder(StringBuilder *sb)
 {
-    deleteArray(sb->records);
-    deleteArray(sb->chars);
-    deleteVLArray(sb->strs);
+    for (size_t i = 0; i < getCountArray(sb->chunks); i++)
+        free(getChunkSB(sb, i));
+    deleteArray(sb->chunks);
     free(sb);
 }
-
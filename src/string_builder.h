@@ -2,6 +2,9 @@
 #define ALIB_STRING_BUILDER_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include "./io_sink.h"
 
 typedef struct StringBuilder StringBuilder;
 
@@ -10,6 +13,12 @@ char *stringBuilderToString(StringBuilder *sb, size_t *outLen);
 size_t stringBuilderGetSize(StringBuilder *sb);
 int stringBuilderPushStr(StringBuilder *sb, const char *str);
 int stringBuilderPushChar(StringBuilder *sb, const char c);
+int stringBuilderPushNStr(StringBuilder *sb, const char *str, size_t nStr);
+int stringBuilderPushInt(StringBuilder *sb, int64_t value);
+int stringBuilderPushDouble(StringBuilder *sb, double value);
+int stringBuilderPushFmt(StringBuilder *sb, const char *fmt, ...);
+int stringBuilderWriteFd(const StringBuilder *sb, int fd);
+int stringBuilderWriteSink(const StringBuilder *sb, IOSink *sink);
 void deleteStringBuilder(StringBuilder *sb);
 void stringBuilderPrintInplace(const StringBuilder *sb);
 
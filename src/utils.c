@@ -1,17 +1,49 @@
 /* Aidan Bird 2021 */ 
+#define _POSIX_C_SOURCE 200809L
 
 #include <stddef.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
+#include <float.h>
+#include <math.h>
 
 #include "utils.h"
 #include "array.h"
+#include "scan.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define UTILS_HAS_MMAP
+#endif
 
 #define BLOCKSIZE 1024
+/* the longest number that parseDouble() copies to the stack for strtod() */
+#define PARSE_DOUBLE_BUFFER_SIZE 64
+/* the most decimal digits that always fit in a uint64_t */
+#define UINT64_MAX_DIGITS 19
+
+#define loadLE64(PTR) \
+    ((uint64_t)(PTR)[0] | (uint64_t)(PTR)[1] << 8 \
+    | (uint64_t)(PTR)[2] << 16 | (uint64_t)(PTR)[3] << 24 \
+    | (uint64_t)(PTR)[4] << 32 | (uint64_t)(PTR)[5] << 40 \
+    | (uint64_t)(PTR)[6] << 48 | (uint64_t)(PTR)[7] << 56)
+
+/* "00", "01", ..., "99", so integers are formatted two digits at a time */
+static const char digitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
 
-Array *readFileHelper(FILE *fp, int *outSize);
+/* the powers of ten that are exact doubles */
+static const double exactPowersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 
+    1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
 
 void
 intSwap(int *restrict x, int *restrict y)
@@ -33,79 +65,181 @@ die(const char *msg)
     exit(-1);
 }
 
+/*
+ * EFFECTS
+ * returns the number of bytes left in fp if it is a regular file, 
+ * otherwise (e.g., for pipes) 0.
+ */
+static size_t
+getSizeHint(FILE *fp)
+{
+#ifdef UTILS_HAS_MMAP
+    struct stat st;
+    long offset;
+
+    if (fstat(fileno(fp), &st) || !S_ISREG(st.st_mode)
+        || (offset = ftell(fp)) < 0 || st.st_size <= offset)
+        return 0;
+    return st.st_size - offset;
+#else
+    (void)fp;
+    return 0;
+#endif
+}
+
+/*
+ * MODIFIES
+ * fp
+ *
+ * EFFECTS
+ * reads the rest of fp into a new buffer, which is null terminated.
+ * regular files are read with one allocation of their size and a single 
+ * fread(). Streams of unknown size (e.g., pipes) are read into a buffer 
+ * that doubles whenever it is full, so reading takes O(n) time.
+ * *outSize is set to the number of bytes read (without the null).
+ * returns NULL on error.
+ */
+static char *
+readStream(FILE *fp, size_t *outSize)
+{
+    char *ret;
+    char *tmp;
+    size_t capacity;
+    size_t size;
+    int c;
+
+    capacity = MAX(getSizeHint(fp), BLOCKSIZE) + 1;
+    if (!(ret = malloc(capacity)))
+        goto error1;
+    size = 0;
+    for (;;) {
+        size += fread(ret + size, 1, capacity - 1 - size, fp);
+        if (size < capacity - 1) {
+            if (ferror(fp))
+                goto error2;
+            break;
+        }
+        /* the buffer is full, so check for more before growing it */
+        if ((c = fgetc(fp)) == EOF)
+            break;
+        capacity *= 2;
+        if (!(tmp = realloc(ret, capacity)))
+            goto error2;
+        ret = tmp;
+        ret[size++] = c;
+    }
+    ret[size] = '\0';
+    *outSize = size;
+    return ret;
+error2:;
+    free(ret);
+error1:;
+    return NULL;
+}
+
 /*
  * Read all text from a file pointer.
  * If outLength is not NULL, then it shall be overwritten with the length of 
  * the input read.
+ * The text is null terminated.
  */ 
 char *
 readTextFile(FILE *fp, int *outLength)
 {
-    size_t tmp;
-    char buf[BLOCKSIZE];
     char *ret;
-    Array *arr;
-    int len;
+    size_t len;
 
-    if (!(arr = readFileHelper(fp, NULL)))
-        goto error1;
-    len = arrayToString(arr, &ret);
+    if (!(ret = readStream(fp, &len)))
+        return NULL;
     if (outLength)
         *outLength = len;
     return ret;
-error1:;
-    return NULL;
 }
 
-/* XXX experimental */
+/*
+ * Read all bytes from a file pointer (see readTextFile()).
+ */
 void *
 readBinFile(FILE *fp, int *outLength)
 {
-    size_t tmp;
-    char buf[BLOCKSIZE];
-    Array *ret;
-    int len;
-
-    if (!(ret = readFileHelper(fp, &len)))
-        goto error1;
-    arrayToRaw(ret, len);
-    if (outLength)
-        *outLength = len;
-    return ret;
-error1:;
-    return NULL;
+    return readTextFile(fp, outLength);
 }
 
-/* XXX experimental */
-Array *
-readFileHelper(FILE *fp, int *outSize)
+/*
+ * REQUIRES
+ * path is not NULL
+ *
+ * EFFECTS
+ * makes a read-only view of the whole file at path (see MappedFile).
+ * Regular files are mmap()ed, so nothing is copied and pages are only 
+ * read when they are touched. flags (see MapFileFlags) are passed on to 
+ * the kernel as posix_madvise() hints.
+ * Files that can not be mapped (e.g., pipes, or on systems without mmap())
+ * are read with readStream() instead.
+ * returns NULL on error.
+ */
+MappedFile *
+mapFile(const char *path, int flags)
 {
-    int isNotEOF;
-    int nextReadSize;
-    char buf[BLOCKSIZE];
-    Array *ret;
+    MappedFile *ret;
+    FILE *fp;
+    char *data;
+#ifdef UTILS_HAS_MMAP
+    struct stat st;
+    void *map;
+#endif
 
-    isNotEOF = 1;
-    if (!(ret = newArray(1, 1, sizeof(buf))))
+    if (!(ret = malloc(sizeof(MappedFile))))
         goto error1;
-    do {
-        nextReadSize = fread(buf, 1, BLOCKSIZE, fp);
-        if (nextReadSize != sizeof(buf)) {
-            buf[nextReadSize] = '\0';
-            isNotEOF = 0;
+    if (!(fp = fopen(path, "rb")))
+        goto error2;
+#ifdef UTILS_HAS_MMAP
+    if (!fstat(fileno(fp), &st) && S_ISREG(st.st_mode) && st.st_size > 0
+        && (uintmax_t)st.st_size <= SIZE_MAX) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+        if (map != MAP_FAILED) {
+            if (flags & MapFileFlags_sequential)
+                posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+            if (flags & MapFileFlags_willNeed)
+                posix_madvise(map, st.st_size, POSIX_MADV_WILLNEED);
+            ret->data = map;
+            ret->size = st.st_size;
+            ret->isMapped = 1;
+            fclose(fp);
+            return ret;
         }
-        if (!tryPushArray(&ret, buf))
-            goto error2;
-    } while(isNotEOF);
-    if (outSize)
-        *outSize = (ret->count - 1) * ret->elementSize + nextReadSize;
+    }
+#else
+    (void)flags;
+#endif
+    if (!(data = readStream(fp, &ret->size)))
+        goto error3;
+    ret->data = data;
+    ret->isMapped = 0;
+    fclose(fp);
     return ret;
+error3:;
+    fclose(fp);
 error2:;
-    deleteArray(ret);
+    free(ret);
 error1:;
     return NULL;
 }
 
+void
+unmapFile(MappedFile *file)
+{
+    if (!file)
+        return;
+#ifdef UTILS_HAS_MMAP
+    if (file->isMapped)
+        munmap((void *)file->data, file->size);
+    else
+#endif
+        free((void *)file->data);
+    free(file);
+}
+
 /*
  * converts a string of integers to an array of integers
  */
@@ -154,18 +288,12 @@ error1:;
 
 /*
  * count the number of occurrences of b in the first n bytes of src.
+ * compares 64 bytes at a time (see scan.h).
  */
 size_t
 charCount(const void *src, size_t n, char b)
 {
-    size_t ret;
-
-    ret = 0;
-    for (size_t i = 0; i < n; i++) {
-        if (((const char *)src)[i] == b)
-            ret++;
-    }
-    return ret;
+    return countByteScan(src, n, (uint8_t)b);
 }
 
 /*
@@ -187,3 +315,402 @@ printBinary(const void *src, size_t n)
     }
     putchar('\n');
 }
+
+/*
+ * returns the smallest power of two that is >= n.
+ */
+size_t
+nextPow2(size_t n)
+{
+    size_t ret;
+
+    ret = 1;
+    while (ret < n)
+        ret <<= 1;
+    return ret;
+}
+
+/*
+ * EFFECTS
+ * returns whether the 8 bytes of chunk (loaded little endian) are all 
+ * ascii digits.
+ * a byte is a digit if its high nibble is 3 and adding 6 does not carry 
+ * into the high nibble.
+ */
+static int
+isEightDigits(uint64_t chunk)
+{
+    return !((chunk & (chunk + 0x0606060606060606u) & 0xf0f0f0f0f0f0f0f0u)
+        ^ 0x3030303030303030u);
+}
+
+/*
+ * REQUIRES
+ * isEightDigits(chunk)
+ *
+ * EFFECTS
+ * returns the value of the 8 digits of chunk (the first digit in the lowest
+ * byte), combining pairs, then quads, then the two halves with multiplies 
+ * instead of looping over the digits.
+ */
+static uint64_t
+parseEightDigits(uint64_t chunk)
+{
+    chunk -= 0x3030303030303030u;
+    chunk = chunk * 10 + (chunk >> 8);
+    chunk = ((chunk & 0x000000ff000000ffu) * (100 + (1000000ull << 32))
+        + ((chunk >> 16) & 0x000000ff000000ffu) * (1 + (10000ull << 32)))
+        >> 32;
+    return chunk;
+}
+
+/*
+ * MODIFIES
+ * *i, *value, *nDigits
+ *
+ * EFFECTS
+ * reads the digits of src starting at *i into *value, 8 at a time where 
+ * possible, and advances *i past them. Only the first UINT64_MAX_DIGITS 
+ * digits (not counting leading zeros) are read into *value, but *nDigits
+ * counts all of them.
+ */
+static void
+parseDigits(const char *src, size_t n, size_t *i, uint64_t *value,
+    size_t *nDigits)
+{
+    const unsigned char *digits;
+
+    digits = (const unsigned char *)src;
+    /* so that the 8 digit chunks below start at a significant digit */
+    while (!*value && *i < n && digits[*i] == '0')
+        (*i)++;
+    while (*i + 8 <= n && *nDigits + 8 <= UINT64_MAX_DIGITS
+        && isEightDigits(loadLE64(digits + *i))) {
+        *value = *value * 100000000 + parseEightDigits(loadLE64(digits + *i));
+        *nDigits += *value ? 8 : 0;
+        *i += 8;
+    }
+    for (; *i < n && isdigit(digits[*i]); (*i)++) {
+        if (*nDigits < UINT64_MAX_DIGITS)
+            *value = *value * 10 + (digits[*i] - '0');
+        *nDigits += *value ? 1 : 0;
+    }
+}
+
+/*
+ * MODIFIES
+ * out
+ *
+ * EFFECTS
+ * parses the n bytes of src (no NUL needed) as a decimal integer with an
+ * optional sign, into *out. 
+ * returns non-zero if src is not an integer, or does not fit in an int64_t.
+ */
+int
+parseInt64(const char *src, size_t n, int64_t *out)
+{
+    uint64_t value;
+    size_t nDigits;
+    size_t i;
+    int isNegative;
+
+    i = 0;
+    isNegative = n && src[0] == '-';
+    if (n && (src[0] == '-' || src[0] == '+'))
+        i++;
+    if (i == n)
+        return -1;
+    value = 0;
+    nDigits = 0;
+    parseDigits(src, n, &i, &value, &nDigits);
+    if (i != n || nDigits > UINT64_MAX_DIGITS 
+        || value > (uint64_t)INT64_MAX + isNegative)
+        return -1;
+    /* -INT64_MIN does not fit in an int64_t, so negate as unsigned */
+    *out = isNegative ? (int64_t)(0 - value) : (int64_t)value;
+    return 0;
+}
+
+/*
+ * MODIFIES
+ * out
+ *
+ * EFFECTS
+ * parses the n bytes of src (no NUL needed) as a decimal floating point
+ * number (what strtod() accepts) into *out.
+ * most numbers (at most 15 or so significant digits and small exponents) 
+ * are made exactly with a single multiply or divide of an exact integer by
+ * an exact power of ten, which IEEE 754 rounds correctly (Clinger's fast 
+ * path). The rest (and inf, nan, hex, ...) go through strtod().
+ * returns non-zero if src is not a number.
+ */
+int
+parseDouble(const char *src, size_t n, double *out)
+{
+    char buffer[PARSE_DOUBLE_BUFFER_SIZE];
+    char *copy;
+    char *end;
+    uint64_t mantissa;
+    size_t nDigits;
+    size_t nRead;
+    size_t i;
+    size_t start;
+    long exponent;
+    long exponentPart;
+    int isNegative;
+    int isExponentNegative;
+
+    i = 0;
+    isNegative = n && src[0] == '-';
+    if (n && (src[0] == '-' || src[0] == '+'))
+        i++;
+    mantissa = 0;
+    nDigits = 0;
+    start = i;
+    parseDigits(src, n, &i, &mantissa, &nDigits);
+    nRead = i - start;
+    exponent = 0;
+    if (i < n && src[i] == '.') {
+        start = ++i;
+        parseDigits(src, n, &i, &mantissa, &nDigits);
+        nRead += i - start;
+        exponent = -(long)(i - start);
+    }
+    /* e.g., inf and nan */
+    if (!nRead)
+        goto fallback;
+    if (i < n && (src[i] == 'e' || src[i] == 'E')) {
+        i++;
+        isExponentNegative = i < n && src[i] == '-';
+        if (i < n && (src[i] == '-' || src[i] == '+'))
+            i++;
+        if (i == n || !isdigit((unsigned char)src[i]))
+            goto fallback;
+        for (exponentPart = 0; i < n && isdigit((unsigned char)src[i]); i++)
+            exponentPart = MIN(exponentPart * 10 + (src[i] - '0'), 100000);
+        exponent += isExponentNegative ? -exponentPart : exponentPart;
+    }
+    if (i != n || nDigits > UINT64_MAX_DIGITS
+        || mantissa > (uint64_t)1 << DBL_MANT_DIG)
+        goto fallback;
+    /* the fast path needs each operation rounded to double precision */
+#if FLT_EVAL_METHOD == 0
+    if (exponent >= 0 && exponent < (long)LEN(exactPowersOf10)) {
+        *out = (double)mantissa * exactPowersOf10[exponent];
+        *out = isNegative ? -*out : *out;
+        return 0;
+    }
+    if (exponent < 0 && -exponent < (long)LEN(exactPowersOf10)) {
+        *out = (double)mantissa / exactPowersOf10[-exponent];
+        *out = isNegative ? -*out : *out;
+        return 0;
+    }
+#endif
+fallback:;
+    /* strtod() needs a NUL terminated string */
+    if (!n || isspace((unsigned char)src[0]))
+        return -1;
+    copy = n < sizeof(buffer) ? buffer : malloc(n + 1);
+    if (!copy)
+        return -1;
+    memcpy(copy, src, n);
+    copy[n] = '\0';
+    *out = strtod(copy, &end);
+    i = end - copy;
+    if (copy != buffer)
+        free(copy);
+    return i != n;
+}
+
+/*
+ * REQUIRES
+ * dst can store FORMAT_INT64_MAX_SIZE chars
+ *
+ * MODIFIES
+ * dst
+ *
+ * EFFECTS
+ * writes the decimal digits of value to dst (without a null terminator),
+ * two digits at a time from a table of digit pairs.
+ * returns the number of chars written.
+ */
+size_t
+formatUint64(char *dst, uint64_t value)
+{
+    char buffer[FORMAT_INT64_MAX_SIZE];
+    char *start;
+    size_t pair;
+
+    start = buffer + sizeof(buffer);
+    while (value >= 100) {
+        pair = (value % 100) * 2;
+        value /= 100;
+        start -= 2;
+        memcpy(start, digitPairs + pair, 2);
+    }
+    if (value >= 10) {
+        start -= 2;
+        memcpy(start, digitPairs + value * 2, 2);
+    } else {
+        *--start = '0' + value;
+    }
+    memcpy(dst, start, buffer + sizeof(buffer) - start);
+    return buffer + sizeof(buffer) - start;
+}
+
+/*
+ * REQUIRES
+ * dst can store FORMAT_INT64_MAX_SIZE chars
+ *
+ * MODIFIES
+ * dst
+ *
+ * EFFECTS
+ * writes value in decimal (like "%" PRId64) to dst, without a null
+ * terminator.
+ * returns the number of chars written.
+ */
+size_t
+formatInt64(char *dst, int64_t value)
+{
+    if (value >= 0)
+        return formatUint64(dst, value);
+    /* -INT64_MIN does not fit in an int64_t, so negate as unsigned */
+    *dst = '-';
+    return 1 + formatUint64(dst + 1, 0 - (uint64_t)value);
+}
+
+/*
+ * REQUIRES
+ * dst can store FORMAT_DOUBLE_MAX_SIZE chars
+ *
+ * MODIFIES
+ * dst
+ *
+ * EFFECTS
+ * writes value in fixed point, as a decimal with at most 15 significant
+ * digits that parses back to exactly value (e.g., a price), which is what
+ * "%.15g" prints. The decimal is found by scaling value by powers of ten
+ * until it is an integer.
+ * returns the number of chars written, or 0 if value has no such decimal
+ * (or is printed in exponent form by "%.15g").
+ */
+static size_t
+formatFixedDouble(char *dst, double value)
+{
+#if FLT_EVAL_METHOD == 0
+    char digits[FORMAT_INT64_MAX_SIZE];
+    double magnitude;
+    double scaled;
+    uint64_t mantissa;
+    size_t nDigits;
+    size_t n;
+    size_t d;
+
+    magnitude = fabs(value);
+    if (!(magnitude >= 1e-4 && magnitude < 1e15))
+        return 0;
+    for (d = 1; d < LEN(exactPowersOf10); d++) {
+        scaled = magnitude * exactPowersOf10[d];
+        if (scaled >= 1e15)
+            return 0;
+        /* an exact integer over an exact power of ten parses exactly */
+        mantissa = (uint64_t)scaled;
+        if ((double)mantissa == scaled
+            && (double)mantissa / exactPowersOf10[d] == magnitude)
+            break;
+    }
+    if (d == LEN(exactPowersOf10))
+        return 0;
+    for (; d && mantissa % 10 == 0; d--)
+        mantissa /= 10;
+    nDigits = formatUint64(digits, mantissa);
+    n = 0;
+    if (value < 0)
+        dst[n++] = '-';
+    if (nDigits > d) {
+        memcpy(dst + n, digits, nDigits - d);
+        n += nDigits - d;
+    } else {
+        dst[n++] = '0';
+    }
+    dst[n++] = '.';
+    for (size_t i = nDigits; i < d; i++)
+        dst[n++] = '0';
+    memcpy(dst + n, digits + nDigits - MIN(nDigits, d), MIN(nDigits, d));
+    return n + MIN(nDigits, d);
+#else
+    (void)dst;
+    (void)value;
+    return 0;
+#endif
+}
+
+/*
+ * EFFECTS
+ * returns whether the n bytes of text parse back to exactly value.
+ */
+static int
+isRoundTripDouble(const char *text, size_t n, double value)
+{
+    double parsed;
+
+    return !parseDouble(text, n, &parsed) && parsed == value;
+}
+
+/*
+ * REQUIRES
+ * dst can store FORMAT_DOUBLE_MAX_SIZE chars
+ *
+ * MODIFIES
+ * dst
+ *
+ * EFFECTS
+ * writes the shortest text that parses back to exactly value to dst,
+ * without a null terminator: the first of "%.1g", ..., "%.17g" that round
+ * trips ("%.17g" always does).
+ * For normal values, "%.15g" already drops the zeros of any shorter text,
+ * so only "%.15g", "%.16g" and "%.17g" are tried. Integers and decimals
+ * with at most 15 digits (most values that were parsed from text) are
+ * written without snprintf(), and the rest take at most two snprintf()s.
+ * Subnormals have fewer significant bits, so they try every precision.
+ * (Near powers of two, where the round trip interval is lopsided, a
+ * result may have one more digit than the shortest.)
+ * returns the number of chars written.
+ */
+size_t
+formatDouble(char *dst, double value)
+{
+    char buffer[FORMAT_DOUBLE_MAX_SIZE];
+    int nShorter;
+    int n;
+
+    /* these print the same with "%.15g" */
+    if (value > -1e15 && value < 1e15 && value == (double)(int64_t)value
+        && (value || !signbit(value)))
+        return formatInt64(dst, (int64_t)value);
+    if ((n = formatFixedDouble(dst, value)))
+        return n;
+    if (value && fabs(value) < DBL_MIN) {
+        for (int precision = 1; precision < 17; precision++) {
+            n = snprintf(dst, FORMAT_DOUBLE_MAX_SIZE, "%.*g", precision,
+                value);
+            if (isRoundTripDouble(dst, n, value))
+                return n;
+        }
+        return snprintf(dst, FORMAT_DOUBLE_MAX_SIZE, "%.17g", value);
+    }
+    /* snprintf() writes a null terminator, which fits after the text */
+    n = snprintf(dst, FORMAT_DOUBLE_MAX_SIZE, "%.16g", value);
+    if (!isfinite(value))
+        return n;
+    if (!isRoundTripDouble(dst, n, value))
+        return snprintf(dst, FORMAT_DOUBLE_MAX_SIZE, "%.17g", value);
+    /* fewer digits win, as in a loop from "%.15g" to "%.17g" */
+    nShorter = snprintf(buffer, sizeof(buffer), "%.15g", value);
+    if (isRoundTripDouble(buffer, nShorter, value)) {
+        memcpy(dst, buffer, nShorter);
+        return nShorter;
+    }
+    return n;
+}
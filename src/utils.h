@@ -8,6 +8,7 @@
  */ 
 
 #include <stdio.h>
+#include <stdint.h>
 #include <time.h>
 
 #include "array.h"
@@ -20,6 +21,9 @@
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
 #define SQUARE(X) ((X) * (X))
 #define DEG2RAD_F(X) ((X) * PI_F / 180)
+/* the most chars that formatInt64() and formatDouble() write */
+#define FORMAT_INT64_MAX_SIZE 20
+#define FORMAT_DOUBLE_MAX_SIZE 32
 
 /* 
  * Used for getting the execution time of EXPR
@@ -35,13 +39,66 @@
     *(DOUBLE_PTR) = ((double) (end - start)) / CLOCKS_PER_SEC; \
 }
 
+/* 
+ * hints that the memory at ADDR will be read soon.
+ * does nothing on compilers without __builtin_prefetch.
+ */
+#if defined(__GNUC__)
+#define PREFETCH(ADDR) (__builtin_prefetch((ADDR)))
+#else
+#define PREFETCH(ADDR) ((void)(ADDR))
+#endif
+
+/* 
+ * makes the memory writes before the fence visible to other threads before
+ * the writes after it.
+ */
+#if defined(__GNUC__)
+#define MEMORY_FENCE_RELEASE() (__atomic_thread_fence(__ATOMIC_RELEASE))
+#else
+#define MEMORY_FENCE_RELEASE() ((void)0)
+#endif
+
+typedef struct MappedFile MappedFile;
+
+/* hints about how a MappedFile will be read */
+enum MapFileFlags
+{
+    /* the file is read from start to end, so read ahead aggressively */
+    MapFileFlags_sequential = 1 << 0,
+    /* the whole file will be read soon, so start reading it now */
+    MapFileFlags_willNeed = 1 << 1,
+};
+
+typedef enum MapFileFlags MapFileFlags;
+
+/*
+ * a read-only view of a whole file (see mapFile()).
+ * data, size = the bytes of the file. data is not null terminated.
+ * isMapped = data is mmap()ed, otherwise it was read into a buffer.
+ */
+struct MappedFile
+{
+    const void *data;
+    size_t size;
+    int isMapped;
+};
+
 char *readTextFile(FILE *fp, int *outLength);
 void *readBinFile(FILE *fp, int *outLength);
+MappedFile *mapFile(const char *path, int flags);
+void unmapFile(MappedFile *file);
 void die(const char *msg);
 Array *stringToIntArray(char *str);
 void intSwap(int *restrict x, int *restrict y);
 void *memdup(const void *src, size_t n);
 size_t charCount(const void *src, size_t n, char b);
 void printBinary(const void *src, size_t n);
+size_t nextPow2(size_t n);
+int parseInt64(const char *src, size_t n, int64_t *out);
+int parseDouble(const char *src, size_t n, double *out);
+size_t formatUint64(char *dst, uint64_t value);
+size_t formatInt64(char *dst, int64_t value);
+size_t formatDouble(char *dst, double value);
 
 #endif
@@ -2,12 +2,15 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include "vlarray.h"
 #include "utils.h"
 
 #define VLARRAY_DEFAULT_FRAME_SIZE 64
 #define VLARRAY_DEFAULT_CAPACITY_SIZE 32
+/* the guessed element size of packed VLArrays, for their initial capacity */
+#define VLARRAY_DEFAULT_PACKED_ELEMENT_SIZE 16
 
 #define arrayFunc(ARRAY_PTR, ARRAY_FUNC, ERROR_LABEL) \
 { \
@@ -17,6 +20,40 @@
     ARRAY_PTR = arrayfunc_tmp_; \
 }
 
+/*
+ * EFFECTS
+ * constructs a VLArray with room for capacity elements and dataCapacity
+ * bytes of data.
+ * returns null on error
+ */
+static VLArray *
+newVLArrayHelper(int blockSize, int capacity, size_t dataCapacity,
+    int frameSize, int alignment, int isPacked)
+{
+    VLArray *ret;
+
+    if (!(ret = malloc(sizeof(VLArray))))
+        goto error1;
+    if (!(ret->index = newArrayWithPolicy(ArrayGrowthPolicy_geometric,
+        blockSize, capacity, sizeof(VLArrayEntry), 0)))
+        goto error2;
+    if (!(ret->data = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1,
+        MIN(dataCapacity, INT_MAX), sizeof(uint8_t), 0)))
+        goto error3;
+    ret->frameSize = frameSize;
+    ret->alignment = alignment;
+    ret->isPacked = isPacked;
+    ret->isDirty = 1;
+    ret->totalSize = 0;
+    return ret;
+error3:;
+    deleteArray(ret->index);
+error2:;
+    free(ret);
+error1:;
+    return NULL;
+}
+
 /*
  * REQUIRES
  * none
@@ -31,36 +68,66 @@
  * take up. This parameter determines how large each frame is.
  *
  * (blocksize & capacity) see array constructor in array.c
+ * the underlying arrays grow geometrically, blockSize is the minimum growth.
  *
  * returns null on error
  */
 VLArray *
 newVLArray(int blockSize, int capacity, int frameSize)
 {
-    VLArray *ret;
-
     frameSize = frameSize <= 0 ? VLARRAY_DEFAULT_FRAME_SIZE : frameSize;
     capacity = capacity <= 0 ? VLARRAY_DEFAULT_CAPACITY_SIZE : capacity;
-    if (!(ret = malloc(sizeof(VLArray))))
-        goto error1;
-    if (!(ret->offsets = newArray(blockSize, capacity, sizeof(int))))
-        goto error2;
-    if (!(ret->data = newArray(!blockSize ? -1 : blockSize, capacity, 
-        frameSize))) {
-        goto error3;
-    }
-    if (!(ret->sizes = newArray(blockSize, capacity, sizeof(size_t))))
-        goto error4;
-    ret->isDirty = 1;
-    return ret;
-error4:;
-    deleteArray(ret->data);
-error3:;
-    deleteArray(ret->offsets);
-error2:;
-    free(ret);
-error1:;
-    return NULL;
+    return newVLArrayHelper(blockSize, capacity, (size_t)capacity * frameSize,
+        frameSize, 1, 0);
+}
+
+/*
+ * REQUIRES
+ * alignment is a power of two
+ *
+ * EFFECTS
+ * constructs a new VLArray whose elements take their size rounded up to 
+ * alignment bytes in data, with no frames (see VLArray in vlarray.h). 
+ * Elements can not grow in place past their padding.
+ * if alignment <= 0, then elements are not padded (alignment 1).
+ * (blocksize & capacity) see newVLArray().
+ * returns null on error
+ */
+VLArray *
+newVLArrayPacked(int blockSize, int capacity, int alignment)
+{
+    alignment = alignment <= 0 ? 1 : alignment;
+    capacity = capacity <= 0 ? VLARRAY_DEFAULT_CAPACITY_SIZE : capacity;
+    return newVLArrayHelper(blockSize, capacity,
+        (size_t)capacity * VLARRAY_DEFAULT_PACKED_ELEMENT_SIZE, 1, alignment,
+        1);
+}
+
+/*
+ * EFFECTS
+ * constructs an empty VLArray with the same layout (frames or packed) as 
+ * arr.
+ * returns null on error
+ */
+VLArray *
+newVLArrayLike(const VLArray *arr, int blockSize, int capacity)
+{
+    return arr->isPacked ? newVLArrayPacked(blockSize, capacity,
+        arr->alignment)
+        : newVLArray(blockSize, capacity, arr->frameSize);
+}
+
+/*
+ * EFFECTS
+ * returns the number of bytes of data that an elementSize bytes long 
+ * element takes.
+ */
+static size_t
+getDataSizeVLArray(const VLArray *arr, size_t elementSize)
+{
+    return arr->isPacked 
+        ? (elementSize + arr->alignment - 1) & ~(arr->alignment - 1)
+        : (1 + elementSize / arr->frameSize) * arr->frameSize;
 }
 
 /*
@@ -77,9 +144,8 @@ error1:;
 void
 deleteVLArray(VLArray *arr)
 {
-    deleteArray(arr->offsets);
+    deleteArray(arr->index);
     deleteArray(arr->data);
-    deleteArray(arr->sizes);
     free(arr);
 }
 
@@ -105,7 +171,7 @@ deleteVLArray(VLArray *arr)
 VLArray *
 pushVLArray(VLArray *arr, const void *nextElement, size_t elementSize)
 {
-    return insertVLArray(arr, nextElement, elementSize, arr->offsets->count);
+    return insertVLArray(arr, nextElement, elementSize, getCountVLArray(arr));
 }
 
 /* XXX experimental */
@@ -139,68 +205,112 @@ VLArray *
 insertVLArray(VLArray *arr, const void *nextElement, size_t elementSize,
     size_t index)
 {
-    int nextFrames;
-    int frameStartIndex;
-    int offsetRecord;
-
-    nextFrames = 1 + elementSize / arr->data->elementSize;
-    if (!arr->offsets->count) {
-        /* push the first element */ 
-        if (index)
-            return NULL;
-        /* push new offset record */  
-        offsetRecord = 0;
-        arrayFunc(arr->offsets, pushArray(arr->offsets, &offsetRecord),
-            error1);
-        /* make space for first element */ 
-        arrayFunc(arr->data, forwardShiftRangeArray(arr->data, 0, nextFrames),
-            error1);
-        /* push element data */ 
-        if (nextElement)
-            memcpy(arr->data->first, nextElement, elementSize);
-        arrayFunc(arr->sizes, pushArray(arr->sizes, &elementSize), error1);
-    } else {
-        if (index > arr->offsets->count)
-            return NULL;
-        if (index == arr->offsets->count) {
-            /* push operation */ 
-            frameStartIndex = arr->data->count;
-            /* make space for new element frames */ 
-            arrayFunc(arr->data, forwardShiftRangeArray(arr->data,
-                frameStartIndex, nextFrames), error1);
-            /* register new element */ 
-            if (nextElement)
-                memcpy(getElementArray(arr->data, frameStartIndex),
-                    nextElement, elementSize);
-            /* push new offset record */  
-            arrayFunc(arr->offsets, pushArray(arr->offsets, &frameStartIndex),
-                error1);
-            arrayFunc(arr->sizes, pushArray(arr->sizes, &elementSize), error1);
-        } else {
-            /* insert operation */ 
-            frameStartIndex = *((int *)getElementArray(arr->offsets, index));
-            /* make space for new element frames */ 
-            arrayFunc(arr->data, forwardShiftRangeArray(arr->data,
-                frameStartIndex, nextFrames), error1);
-            /* register new element */ 
-            if (nextElement)
-                memcpy(getElementArray(arr->data, frameStartIndex),
-                    nextElement, elementSize);
-            /* update offset records */ 
-            arrayFunc(arr->offsets, insertArray(arr->offsets, &frameStartIndex,
-                index + 1), error1);
-            for (int i = index + 1; i < arr->offsets->count; i++)
-                *((int *)getElementArray(arr->offsets, i)) += nextFrames;
-            arrayFunc(arr->sizes, insertArray(arr->sizes, &elementSize, index),
-                error1);
-        }
-    }
+    VLArrayEntry entry;
+    size_t dataSize;
+
+    if (index > getCountVLArray(arr) || elementSize > UINT32_MAX)
+        return NULL;
+    dataSize = getDataSizeVLArray(arr, elementSize);
+    entry.offset = index == getCountVLArray(arr) ? getCountArray(arr->data)
+        : getOffsetVLArray(arr, index);
+    entry.size = elementSize;
+    /* grow the index first, so that it can not fail after data is moved */
+    arrayFunc(arr->index, growArray(arr->index, 1), error1);
+    /* make space for the element */ 
+    arrayFunc(arr->data, forwardShiftRangeArray(arr->data, entry.offset,
+        dataSize), error1);
+    if (nextElement)
+        memcpy(getElementArray(arr->data, entry.offset), nextElement,
+            elementSize);
+    /* register the element, and move the elements after it */ 
+    arrayFunc(arr->index, insertArray(arr->index, &entry, index), error1);
+    for (size_t i = index + 1; i < getCountVLArray(arr); i++)
+        getOffsetVLArray(arr, i) += dataSize;
     arr->isDirty = 1;
     return arr;
 error1:;
     return NULL;
 }
 
+/*
+ * MODIFIES
+ * arr
+ *
+ * EFFECTS
+ * makes room for n more elements that are nBytes long in total, so pushing
+ * them does not relocate any of the underlying arrays.
+ * returns null on error.
+ */
+VLArray *
+reserveVLArray(VLArray *arr, size_t n, size_t nBytes)
+{
+    arrayFunc(arr->index, growArray(arr->index, n), error1);
+    /* each element takes at most a frame (or alignment) more than its size */
+    arrayFunc(arr->data, growArray(arr->data, nBytes
+        + n * (arr->isPacked ? arr->alignment - 1 : arr->frameSize)), error1);
+    return arr;
+error1:;
+    return NULL;
+}
+
+/*
+ * EFFECTS
+ * returns non-zero if an elementSize bytes long element can be pushed
+ * without relocating any of the underlying arrays.
+ */
+int
+hasRoomVLArray(const VLArray *arr, size_t elementSize)
+{
+    return getCountArray(arr->index) < getCapacityArray(arr->index)
+        && getCountArray(arr->data) + getDataSizeVLArray(arr, elementSize)
+        <= getCapacityArray(arr->data);
+}
+
+/*
+ * REQUIRES
+ * index is a valid index of arr
+ *
+ * EFFECTS
+ * returns the number of bytes that the element at index can grow to without
+ * moving any other element.
+ */
+size_t
+getElementCapacityVLArray(const VLArray *arr, size_t index)
+{
+    size_t offsetNext;
+
+    offsetNext = index == lastIndexVLArray(arr) ? getCountArray(arr->data)
+        : getOffsetVLArray(arr, index + 1);
+    return offsetNext - getOffsetVLArray(arr, index);
+}
+
+/*
+ * MODIFIES
+ * arr
+ *
+ * EFFECTS
+ * replaces the element at index with nextElement without moving any other
+ * element.
+ * returns non-zero if index is invalid or nextElement does not fit in the
+ * frames of the old element (see getElementCapacityVLArray()).
+ *
+ * takes O(elementSize) time
+ */
+int
+overwriteVLArray(VLArray *arr, const void *nextElement, size_t elementSize,
+    size_t index)
+{
+    if (index >= getCountVLArray(arr)
+        || elementSize > getElementCapacityVLArray(arr, index)
+        || elementSize > UINT32_MAX)
+        return -1;
+    if (nextElement)
+        memcpy(getElementVLArray(arr, index), nextElement, elementSize);
+    sizeOfElementVLArray(arr, index) = elementSize;
+    arr->isDirty = 1;
+    return 0;
+}
+
 /*
  * remove an element at index
  *
@@ -209,32 +319,32 @@ error1:;
 int
 removeAtVLArray(VLArray *arr, void *outElement, size_t index)
 {
-    int offsetDeleted;
-    int offsetNext;
-    int frameDiff;
-    void *addrDeleted;
+    size_t offsetDeleted;
+    size_t offsetNext;
+    size_t dataSize;
 
-    if (!arr->offsets->count || index >= arr->offsets->count)
+    if (index >= getCountVLArray(arr))
         return -1;
-    addrDeleted = getElementVLArray(arr, index);
     /* copy deleted elements to outElement */ 
     if (outElement)
-        memcpy(outElement, addrDeleted, sizeOfElementVLArray(arr, index));
-    if (!index && arr->offsets->count == 1) {
+        memcpy(outElement, getElementVLArray(arr, index),
+            sizeOfElementVLArray(arr, index));
+    if (getCountVLArray(arr) == 1) {
         /* special casse: there is only one element in the vla */ 
         clearVLArray(arr);
         return 0;
     }
     /* remove the element */ 
     offsetDeleted = getOffsetVLArray(arr, index);
-    offsetNext = index == arr->offsets->count - 1 ? arr->data->count : getOffsetVLArray(arr, index + 1);
-    frameDiff = offsetNext - offsetDeleted;
-    removeContinuousRangeArray(arr->data, NULL, offsetDeleted, frameDiff);
-    removeAtArray(arr->sizes, NULL, index);
-    removeAtArray(arr->offsets, NULL, index);
-    /* update the offset array */ 
-    for (int i = index; i < arr->offsets->count; i++)
-        getOffsetVLArray(arr, i) -= frameDiff;
+    offsetNext = index == lastIndexVLArray(arr) ? getCountArray(arr->data)
+        : getOffsetVLArray(arr, index + 1);
+    dataSize = offsetNext - offsetDeleted;
+    if (dataSize)
+        removeContinuousRangeArray(arr->data, NULL, offsetDeleted, dataSize);
+    removeAtArray(arr->index, NULL, index);
+    /* update the offsets */ 
+    for (size_t i = index; i < getCountVLArray(arr); i++)
+        getOffsetVLArray(arr, i) -= dataSize;
     arr->isDirty = 1;
     return 0;
 }
@@ -247,7 +357,7 @@ removeAtVLArray(VLArray *arr, void *outElement, size_t index)
 int
 popVLArray(VLArray *arr, void *outElement)
 {
-    return removeAtVLArray(arr, outElement, arr->offsets->count - 1);
+    return removeAtVLArray(arr, outElement, getCountVLArray(arr) - 1);
 }
 
 /*
@@ -258,9 +368,8 @@ popVLArray(VLArray *arr, void *outElement)
 void
 clearVLArray(VLArray *arr)
 {
-    clearArray(arr->offsets);
+    clearArray(arr->index);
     clearArray(arr->data);
-    clearArray(arr->sizes);
     arr->isDirty = 1;
 }
 
@@ -318,3 +427,28 @@ toStringVLArray(VLArray *arr)
 error1:;
     return NULL;
 }
+
+/*
+ * EFFECTS
+ * returns the number of bytes that the elements of arr take, including their
+ * padding (or unused frames) and their index entries.
+ * see getSizeVLArray() for the number of bytes in the elements themselves.
+ */
+size_t
+getUsedBytesVLArray(const VLArray *arr)
+{
+    return sizeofArray(arr->data) + sizeofArray(arr->index);
+}
+
+/*
+ * EFFECTS
+ * returns the number of bytes allocated for arr, including unused capacity.
+ */
+size_t
+getAllocatedBytesVLArray(const VLArray *arr)
+{
+    return sizeof(VLArray) 
+        + sizeof(Array) + getCapacityArray(arr->data) * arr->data->elementSize
+        + sizeof(Array) + getCapacityArray(arr->index) 
+        * arr->index->elementSize;
+}
@@ -9,35 +9,46 @@
  */ 
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "array.h"
 
+#define getEntryVLArray(VLARRAY_PTR, INDEX) \
+    ((VLArrayEntry *)getElementArray((VLARRAY_PTR)->index, (INDEX)))
 #define getElementVLArray(VLARRAY_PTR, INDEX) \
-    (getElementArray((VLARRAY_PTR)->data, \
-    (*((int *)getElementArray((VLARRAY_PTR)->offsets, INDEX)))))
-#define getCountVLArray(VLARRAY_PTR) ((VLARRAY_PTR)->offsets->count)
+    ((uint8_t *)(VLARRAY_PTR)->data->first \
+    + getEntryVLArray((VLARRAY_PTR), (INDEX))->offset)
+#define getCountVLArray(VLARRAY_PTR) ((VLARRAY_PTR)->index->count)
 #define sizeOfElementVLArray(VLARRAY_PTR, INDEX) \
-    (*((size_t *)getElementArray((VLARRAY_PTR)->sizes, INDEX)))
+    (getEntryVLArray((VLARRAY_PTR), (INDEX))->size)
 #define getOffsetVLArray(VLARRAY_PTR, INDEX) \
-    (*((int *)getElementArray((VLARRAY_PTR)->offsets, INDEX)))
+    (getEntryVLArray((VLARRAY_PTR), (INDEX))->offset)
 #define isEmptyVLArray(VLARRAY_PTR) \
     (!(getCountVLArray(VLARRAY_PTR)))
 #define isFullVLArray(VLARRAY_PTR) \
-    ((getCountVLArray(VLARRAY_PTR)) >= ((VLARRAY_PTR)->offsets->capacity))
+    ((getCountVLArray(VLARRAY_PTR)) >= ((VLARRAY_PTR)->index->capacity))
 #define lastIndexVLArray(VLARRAY_PTR) \
     (getCountVLArray(VLARRAY_PTR) - 1)
 #define peekVLArray(VLARRAY_PTR) \
     (getElementVLArray(VLARRAY_PTR, (lastIndexVLArray(VLARRAY_PTR))))
-#define getCapacityVLArray(VLARRAY_PTR) ((VLARRAY_PTR)->offsets->capacity)
+#define getCapacityVLArray(VLARRAY_PTR) ((VLARRAY_PTR)->index->capacity)
 
+typedef struct VLArrayEntry VLArrayEntry;
 typedef struct VLArray VLArray;
 
 VLArray *newVLArray(int blockSize, int capacity, int frameSize);
+VLArray *newVLArrayPacked(int blockSize, int capacity, int alignment);
+VLArray *newVLArrayLike(const VLArray *arr, int blockSize, int capacity);
 void deleteVLArray(VLArray *arr);
 VLArray *pushVLArray(VLArray *arr, const void *nextElement,
     size_t elementSize);
 int removeAtVLArray(VLArray *arr, void *outElement, size_t index);
 int popVLArray(VLArray *arr, void *outElement);
+VLArray *reserveVLArray(VLArray *arr, size_t n, size_t nBytes);
+int hasRoomVLArray(const VLArray *arr, size_t elementSize);
+size_t getElementCapacityVLArray(const VLArray *arr, size_t index);
+int overwriteVLArray(VLArray *arr, const void *nextElement,
+    size_t elementSize, size_t index);
 void clearVLArray(VLArray *VLArray);
 VLArray *insertVLArray(VLArray *arr, const void *nextElement, 
     size_t elementSize, size_t index);
@@ -46,17 +57,46 @@ VLArray *tryPushVLArray(VLArray **arr, const void *nextElement,
     size_t elementSize);
 size_t getSizeVLArray(VLArray *arr);
 char *toStringVLArray(VLArray *arr);
+size_t getUsedBytesVLArray(const VLArray *arr);
+size_t getAllocatedBytesVLArray(const VLArray *arr);
+
+/*
+ * where an element of a VLArray is.
+ * offset = the byte offset of the element in data.
+ * size = the size of the element in bytes.
+ */
+struct VLArrayEntry
+{
+    uint64_t offset;
+    uint32_t size;
+};
 
 /*
  * VLARRAY DETAILS AND FIELDS
  *
- * offsets = an array of index offsets that are used for indexing into the 
- * array.
+ * index = a VLArrayEntry for each element, used for indexing into data. 
+ * Since the offset and size of an element are next to each other, indexing
+ * reads one entry (one cache line) before reading the element itself. 
+ * Offsets are 64 bit, so data can be larger than 2GB. Elements are at most
+ * UINT32_MAX bytes long.
+ *
+ * data = the bytes of the elements, in the order of the elements.
+ *
+ * frameSize = element sizes will be counted as the number of frames that 
+ * they take up. Each element takes 1 + size / frameSize frames, so it can 
+ * grow a little in place (see overwriteVLArray()).
  *
- * data = the array elements are stored here, and the offsets array is used to
- * index into this array.
+ * isPacked, alignment = elements take their size rounded up to alignment 
+ * bytes in data (no frames), so each element starts at a multiple of 
+ * alignment. With an alignment of 1, elements are stored back to back.
+ * This saves memory when elements are small or never overwritten: with 
+ * 64 byte frames, a 3 byte element takes 64 bytes, and an element that is 
+ * exactly a frame long takes two frames.
  *
- * sizes = stores the size of each element
+ * getSizeVLArray() is the number of payload bytes (the sum of the element 
+ * sizes), getUsedBytesVLArray() is the number of bytes the elements take 
+ * including their padding and index entries, and 
+ * getAllocatedBytesVLArray() also counts unused capacity.
  *
  * For example, the elements in a variable length could be:
  * [0] = "my first string"
@@ -75,9 +115,11 @@ char *toStringVLArray(VLArray *arr);
 
 struct VLArray
 {
-    Array *offsets;
+    Array *index;
     Array *data;
-    Array *sizes;
+    size_t frameSize;
+    size_t alignment;
+    int isPacked;
     int isDirty;
     size_t totalSize;
 };
@@ -62,6 +62,71 @@ START_TEST (test_array) {
 }
 END_TEST
 
+START_TEST (test_array_geometric) {
+    Array *arr;
+    size_t resizeCount;
+    size_t lastCapacity;
+    const size_t n = 100000;
+
+    arr = newArrayWithPolicy(ArrayGrowthPolicy_geometric, -1, 1,
+        sizeof(size_t), 2.0f);
+    ck_assert_msg(arr, "newArrayWithPolicy() returned null");
+    resizeCount = 0;
+    lastCapacity = getCapacityArray(arr);
+    for (size_t i = 0; i < n; i++) {
+        ck_assert_msg(tryPushArray(&arr, &i), "tryPushArray() failed");
+        if (getCapacityArray(arr) != lastCapacity) {
+            lastCapacity = getCapacityArray(arr);
+            resizeCount++;
+        }
+    }
+    /* capacity doubles, so the array is resized O(log(n)) times */
+    ck_assert_msg(resizeCount <= 20, "too many resizes: %ld", resizeCount);
+    for (size_t i = 0; i < n; i++) {
+        ck_assert_msg(*(size_t *)getElementArray(arr, i) == i,
+            "element and testset differ");
+    }
+    deleteArray(arr);
+}
+END_TEST
+
+START_TEST (test_array_fixed) {
+    Array *arr;
+    const int testingData[] = { 1, 2, 3, 4 };
+
+    arr = newArrayWithPolicy(ArrayGrowthPolicy_fixed, -1, LEN(testingData),
+        sizeof(int), 0);
+    ck_assert_msg(arr, "newArrayWithPolicy() returned null");
+    testTryPushArray(arr, testingData, LEN(testingData));
+    testGetElementArray(arr, testingData, LEN(testingData));
+    ck_assert_msg(!pushArray(arr, testingData),
+        "pushArray() resized a fixed array");
+    ck_assert_msg(getCapacityArray(arr) == LEN(testingData),
+        "fixed array capacity changed");
+    deleteArray(arr);
+}
+END_TEST
+
+START_TEST (test_array_remove_range) {
+    Array *arr;
+    const int testingData[] = { 1, 2, 3, 4, 5, 6 };
+
+    arr = newArray(-1, -1, sizeof(int));
+    ck_assert_msg(arr, "newArray() returned null");
+    testTryPushArray(arr, testingData, LEN(testingData));
+    ck_assert_msg(!removeContinuousRangeArray(arr, NULL, 1, 2),
+        "removeContinuousRangeArray() failed");
+    ck_assert_msg(getCountArray(arr) == 4
+        && *(int *)getElementArray(arr, 1) == 4, "middle range mismatch");
+    /* removing the last elements pops them */
+    ck_assert_msg(!removeContinuousRangeArray(arr, NULL, 2, 2),
+        "removeContinuousRangeArray() failed");
+    ck_assert_msg(getCountArray(arr) == 2
+        && *(int *)getElementArray(arr, 1) == 4, "tail range mismatch");
+    deleteArray(arr);
+}
+END_TEST
+
 Suite *
 array_suite(void)
 {
@@ -71,6 +136,9 @@ array_suite(void)
     s = suite_create("Array");
     tc_core = tcase_create("Core");
     tcase_add_test(tc_core, test_array);
+    tcase_add_test(tc_core, test_array_geometric);
+    tcase_add_test(tc_core, test_array_fixed);
+    tcase_add_test(tc_core, test_array_remove_range);
     suite_add_tcase(s, tc_core);
     return s;
 }
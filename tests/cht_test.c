@@ -0,0 +1,211 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "../src/concurrent_hashtable.h"
+#include "../src/hashing.h"
+#include "../src/utils.h"
+
+#define N_VALID_KEYS 20000
+#define N_READERS 4
+
+typedef struct ReaderArgs ReaderArgs;
+
+struct ReaderArgs
+{
+    ConcurrentHashTable *cht;
+    int isDone;
+    size_t errors;
+    size_t found;
+};
+
+static ConcurrentHashTable *
+spawnConcurrentHashTable()
+{
+    ConcurrentHashTable *ret;
+
+    ret = newConcurrentHashTable(crc32, 2, N_READERS + 1);
+    ck_assert_msg(ret != NULL, "newConcurrentHashTable() returned NULL");
+    return ret;
+}
+
+static void
+putManyKeys(ConcurrentHashTable *cht, size_t n)
+{
+    size_t value;
+
+    for (size_t i = 0; i < n; i++) {
+        value = i * 3;
+        ck_assert_msg(!putConcurrentHashTable(cht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&value, sizeof(value)),
+            "putConcurrentHashTable failed with key %ld", i);
+    }
+}
+
+START_TEST(testConcurrentHashTable_PutGet)
+{
+    ConcurrentHashTable *cht;
+    int readerID;
+    size_t value;
+    size_t valueSize;
+
+    cht = spawnConcurrentHashTable();
+    putManyKeys(cht, N_VALID_KEYS);
+    ck_assert_msg(getCountConcurrentHashTable(cht) == N_VALID_KEYS,
+        "count mismatch");
+    readerID = registerReaderConcurrentHashTable(cht);
+    ck_assert_msg(readerID >= 0, "registerReaderConcurrentHashTable failed");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        ck_assert_msg(!getConcurrentHashTable(cht, readerID, (uint8_t *)&i,
+            sizeof(i), &value, sizeof(value), &valueSize),
+            "key %ld was not found", i);
+        ck_assert_msg(valueSize == sizeof(value) && value == i * 3,
+            "key %ld has the wrong value", i);
+    }
+    value = N_VALID_KEYS;
+    ck_assert_msg(getConcurrentHashTable(cht, readerID, (uint8_t *)&value,
+        sizeof(value), &value, sizeof(value), NULL) < 0,
+        "a missing key was found");
+    /* lookups do not write to the shared shards */
+    for (size_t i = 0; i < getShardCountConcurrentHashTable(cht); i++) {
+        ck_assert_msg(!cht->shards[i].ht->stats.keyComparisons
+            && !cht->shards[i].ht->stats.hashRejects,
+            "shard %ld counted lookup stats", i);
+    }
+    unregisterReaderConcurrentHashTable(cht, readerID);
+    deleteConcurrentHashTable(cht);
+}
+END_TEST
+
+START_TEST(testConcurrentHashTable_UpdateRemove)
+{
+    ConcurrentHashTable *cht;
+    int readerID;
+    size_t key;
+    size_t valueSize;
+    char bigValue[256];
+    char outValue[256];
+
+    cht = spawnConcurrentHashTable();
+    putManyKeys(cht, N_VALID_KEYS);
+    readerID = registerReaderConcurrentHashTable(cht);
+    /* replace a value with one that does not fit in place */
+    key = 7;
+    memset(bigValue, 'x', sizeof(bigValue));
+    ck_assert_msg(!putConcurrentHashTable(cht, (uint8_t *)&key, sizeof(key),
+        (uint8_t *)bigValue, sizeof(bigValue)),
+        "putConcurrentHashTable failed to replace a value");
+    ck_assert_msg(!getConcurrentHashTable(cht, readerID, (uint8_t *)&key,
+        sizeof(key), outValue, sizeof(outValue), &valueSize)
+        && valueSize == sizeof(bigValue)
+        && !memcmp(outValue, bigValue, sizeof(bigValue)),
+        "the replaced value is wrong");
+    ck_assert_msg(getCountConcurrentHashTable(cht) == N_VALID_KEYS,
+        "replacing a value changed the count");
+    /* remove the even keys */
+    for (size_t i = 0; i < N_VALID_KEYS; i += 2) {
+        ck_assert_msg(!removeConcurrentHashTable(cht, (uint8_t *)&i,
+            sizeof(i)), "removeConcurrentHashTable failed with key %ld", i);
+    }
+    ck_assert_msg(getCountConcurrentHashTable(cht) == N_VALID_KEYS / 2,
+        "count mismatch after removing");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        ck_assert_msg((getConcurrentHashTable(cht, readerID, (uint8_t *)&i,
+            sizeof(i), outValue, sizeof(outValue), NULL) == 0) == (i % 2),
+            "key %ld is in the wrong state after removing", i);
+    }
+    unregisterReaderConcurrentHashTable(cht, readerID);
+    deleteConcurrentHashTable(cht);
+}
+END_TEST
+
+static void *
+readKeys(void *arg)
+{
+    ReaderArgs *args;
+    int readerID;
+    size_t value;
+
+    args = arg;
+    if ((readerID = registerReaderConcurrentHashTable(args->cht)) < 0) {
+        args->errors++;
+        return NULL;
+    }
+    while (!__atomic_load_n(&args->isDone, __ATOMIC_ACQUIRE)) {
+        for (size_t i = 0; i < N_VALID_KEYS; i += 7) {
+            if (getConcurrentHashTable(args->cht, readerID, (uint8_t *)&i,
+                sizeof(i), &value, sizeof(value), NULL) < 0)
+                continue;
+            args->found++;
+            if (value != i * 3)
+                args->errors++;
+        }
+    }
+    unregisterReaderConcurrentHashTable(args->cht, readerID);
+    return NULL;
+}
+
+START_TEST(testConcurrentHashTable_ReadWhileWriting)
+{
+    ConcurrentHashTable *cht;
+    pthread_t threads[N_READERS];
+    ReaderArgs args[N_READERS];
+
+    cht = spawnConcurrentHashTable();
+    for (size_t i = 0; i < N_READERS; i++) {
+        args[i] = (ReaderArgs) {
+            .cht = cht,
+            .isDone = 0,
+            .errors = 0,
+            .found = 0,
+        };
+        ck_assert_msg(!pthread_create(&threads[i], NULL, readKeys, &args[i]),
+            "pthread_create failed");
+    }
+    /* the shards are copied many times while the readers are reading */
+    putManyKeys(cht, N_VALID_KEYS);
+    for (size_t i = 0; i < N_READERS; i++) {
+        __atomic_store_n(&args[i].isDone, 1, __ATOMIC_RELEASE);
+        pthread_join(threads[i], NULL);
+        ck_assert_msg(!args[i].errors, "reader %ld read %ld wrong values", i,
+            args[i].errors);
+    }
+    ck_assert_msg(getCountConcurrentHashTable(cht) == N_VALID_KEYS,
+        "count mismatch");
+    deleteConcurrentHashTable(cht);
+}
+END_TEST
+
+Suite *
+cht_suite()
+{
+    Suite *ret;
+    TCase *tcCore;
+
+    ret = suite_create("ConcurrentHashTable");
+    tcCore = tcase_create("Core");
+    tcase_add_test(tcCore, testConcurrentHashTable_PutGet);
+    tcase_add_test(tcCore, testConcurrentHashTable_UpdateRemove);
+    tcase_add_test(tcCore, testConcurrentHashTable_ReadWhileWriting);
+    suite_add_tcase(ret, tcCore);
+    return ret;
+}
+
+int
+main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = cht_suite();
+    sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return !number_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
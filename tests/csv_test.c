@@ -0,0 +1,447 @@
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <stdio.h>
+#include <math.h>
+#include "../src/csv.h"
+#include "../src/utils.h"
+
+static const char testCSV[] = "a,bb,,ccc,";
+static const char *testFields[] = {
+    "a", "bb", "", "ccc", ""
+};
+/* quoted delimiters, escaped quotes, CRLF, an empty line and a CR row end */
+static const char testRFC4180[] = 
+    "a,\"b,c\",\"d\"\"e\"\r\n\r\n\"\",f\n\"multi\nline\",x\"y,\"q\"z\rlast,";
+/* each field in brackets, and a newline after each row */
+static const char testRFC4180Rows[] = 
+    "[a][b,c][d\"e]\n[][f]\n[multi\nline][x\"y][qz]\n[last][]\n";
+
+static char parsed[256];
+static size_t parsedCount;
+/* the rows of the streaming parser for testCSVRows_Threads */
+static char *streamed;
+static size_t streamedCount;
+
+static int
+onTestField(void *ctx, const char *field, size_t n)
+{
+    (void)ctx;
+    ck_assert_msg(parsedCount + n + 2 < sizeof(parsed), "parsed overflow");
+    parsed[parsedCount++] = '[';
+    memcpy(parsed + parsedCount, field, n);
+    parsedCount += n;
+    parsed[parsedCount++] = ']';
+    return 0;
+}
+
+static int
+onTestRow(void *ctx, size_t nFields)
+{
+    (void)nFields;
+    parsed[parsedCount++] = '\n';
+    /* stop after *ctx rows */
+    return ctx && !--*(int *)ctx;
+}
+
+static int
+onStreamedField(void *ctx, const char *field, size_t n)
+{
+    (void)ctx;
+    memcpy(streamed + streamedCount, field, n);
+    streamedCount += n;
+    streamed[streamedCount++] = '|';
+    return 0;
+}
+
+static int
+onStreamedRow(void *ctx, size_t nFields)
+{
+    (void)ctx;
+    (void)nFields;
+    streamed[streamedCount++] = '\n';
+    return 0;
+}
+
+/*
+ * random rows of plain and quoted fields (with delimiters, escaped quotes
+ * and newlines), CRLFs, lone CRs and empty lines, and a quoted field that
+ * is long enough to hide the start of a chunk inside its newlines.
+ * if not isStrict, the first field has a quote that is not RFC 4180.
+ */
+static char *
+makeCSVRowsText(size_t n, int isStrict)
+{
+    char *ret;
+    uint32_t state;
+    size_t i;
+
+    ret = malloc(n);
+    ck_assert_msg(ret != NULL, "malloc() failed");
+    state = 12345;
+    i = 0;
+    if (!isStrict) {
+        memcpy(ret, "x\"y,", 4);
+        i = 4;
+    }
+    while (i < n - 8) {
+        state = state * 1103515245 + 12345;
+        switch ((state >> 16) % 9) {
+        case 0:
+            ret[i++] = '"';
+            for (size_t j = 0; j < (state >> 20) % 16 && i < n - 8; j++) {
+                if ((ret[i++] = ",\n\"x\r"[j % 5]) == '"')
+                    ret[i++] = '"';
+            }
+            ret[i++] = '"';
+            break;
+        case 1:
+            ret[i++] = '\r';
+            /* fall through */
+        case 2:
+            ret[i++] = '\n';
+            break;
+        case 8:
+            ret[i++] = '\r';
+            break;
+        case 3:
+            if (i > n / 3 && i < n / 2) {
+                ret[i++] = '"';
+                for (; i < n / 2; i++)
+                    ret[i] = i % 7 ? 'q' : '\n';
+                ret[i++] = '"';
+            }
+            /* fall through */
+        default:
+            for (size_t j = 0; j < (state >> 20) % 8; j++)
+                ret[i++] = 'a' + j;
+            ret[i++] = ',';
+        }
+    }
+    memset(ret + i, 'z', n - i);
+    return ret;
+}
+
+START_TEST(testNewCSVSpans)
+{
+    Array *spans;
+    const CSVSpan *span;
+
+    spans = newCSVSpans(testCSV, sizeof(testCSV) - 1);
+    ck_assert_msg(spans != NULL, "newCSVSpans() returned NULL");
+    ck_assert_msg(getCountArray(spans) == LEN(testFields),
+        "field count mismatch");
+    for (size_t i = 0; i < LEN(testFields); i++) {
+        span = getSpanCSV(spans, i);
+        ck_assert_msg(span->length == strlen(testFields[i])
+            && !memcmp(getFieldCSV(testCSV, span), testFields[i],
+            span->length), "field %ld mismatch", i);
+    }
+    deleteArray(spans);
+    /* empty text is a single empty field */
+    spans = newCSVSpans("", 0);
+    ck_assert_msg(spans != NULL && getCountArray(spans) == 1
+        && !getSpanCSV(spans, 0)->length, "empty text mismatch");
+    deleteArray(spans);
+}
+END_TEST
+
+/* commas on both sides of the 64 byte scan blocks */
+START_TEST(testNewCSVSpans_BlockBoundaries)
+{
+    char text[300];
+    Array *spans;
+    const CSVSpan *span;
+    size_t start;
+    size_t count;
+
+    for (size_t i = 0; i < sizeof(text); i++)
+        text[i] = i % 63 == 0 || i % 64 == 63 || i % 64 == 0 ? ',' : 'x';
+    for (size_t n = 0; n <= sizeof(text); n += 17) {
+        spans = newCSVSpans(text, n);
+        ck_assert_msg(spans != NULL, "newCSVSpans() returned NULL");
+        start = 0;
+        count = 0;
+        for (size_t i = 0; i <= n; i++) {
+            if (i < n && text[i] != ',')
+                continue;
+            span = getSpanCSV(spans, count);
+            ck_assert_msg(span->offset == start && span->length == i - start,
+                "span %ld mismatch with length %ld", count, n);
+            start = i + 1;
+            count++;
+        }
+        ck_assert_msg(getCountArray(spans) == count,
+            "span count mismatch with length %ld", n);
+        deleteArray(spans);
+    }
+}
+END_TEST
+
+/* every way of splitting the input into chunks gives the same rows */
+START_TEST(testCSVParser_Chunks)
+{
+    CSVParser *parser;
+    size_t n;
+
+    n = sizeof(testRFC4180) - 1;
+    for (size_t chunkSize = 1; chunkSize <= n; chunkSize++) {
+        parser = newCSVParser(',', 0, onTestField, onTestRow, NULL);
+        ck_assert_msg(parser != NULL, "newCSVParser() returned NULL");
+        parsedCount = 0;
+        for (size_t i = 0; i < n; i += chunkSize) {
+            ck_assert_msg(!feedCSVParser(parser, testRFC4180 + i,
+                MIN(chunkSize, n - i)), "feedCSVParser() failed");
+        }
+        ck_assert_msg(!finishCSVParser(parser), "finishCSVParser() failed");
+        parsed[parsedCount] = '\0';
+        ck_assert_msg(!strcmp(parsed, testRFC4180Rows),
+            "rows mismatch with %ld byte chunks: %s", chunkSize, parsed);
+        ck_assert_msg(getRowCountCSVParser(parser) == 4,
+            "row count mismatch");
+        deleteCSVParser(parser);
+    }
+}
+END_TEST
+
+START_TEST(testCSVParser_Errors)
+{
+    CSVParser *parser;
+    int rowsLeft;
+
+    /* a callback can stop the parser */
+    rowsLeft = 1;
+    parser = newCSVParser(',', 0, onTestField, onTestRow, &rowsLeft);
+    parsedCount = 0;
+    ck_assert_msg(feedCSVParser(parser, testRFC4180, sizeof(testRFC4180) - 1)
+        == 1, "the row callback did not stop the parser");
+    ck_assert_msg(getRowCountCSVParser(parser) == 1, "row count mismatch");
+    deleteCSVParser(parser);
+    /* fields longer than maxFieldSize, whole or split between chunks */
+    parser = newCSVParser(',', 4, onTestField, NULL, NULL);
+    ck_assert_msg(feedCSVParser(parser, "abcd,abcde,", 11)
+        == CSV_PARSER_FIELD_TOO_LONG, "a long field was accepted");
+    deleteCSVParser(parser);
+    parser = newCSVParser(',', 4, onTestField, NULL, NULL);
+    ck_assert_msg(!feedCSVParser(parser, "abc", 3), "feedCSVParser() failed");
+    ck_assert_msg(feedCSVParser(parser, "de,", 3)
+        == CSV_PARSER_FIELD_TOO_LONG, "a long split field was accepted");
+    deleteCSVParser(parser);
+    /* the input ends inside quotes */
+    parser = newCSVParser(',', 0, onTestField, NULL, NULL);
+    ck_assert_msg(!feedCSVParser(parser, "a,\"b", 4),
+        "feedCSVParser() failed");
+    ck_assert_msg(finishCSVParser(parser) == CSV_PARSER_UNTERMINATED_QUOTE,
+        "an unterminated quote was accepted");
+    deleteCSVParser(parser);
+}
+END_TEST
+
+START_TEST(testCSVRows)
+{
+    static const char text[] = 
+        "a,\"b,c\",\"d\"\"e\"\r\n\r\n\"\",f\n\"multi\nline\",x\"y,\"q\"z\nlast,";
+    static const char *fields[] = {
+        "a", "b,c", "d\"e", "", "f", "multi\nline", "x\"y", "qz", "last", "",
+    };
+    static const size_t fieldCounts[] = {3, 2, 3, 2};
+    CSVRows *rows;
+    char out[16];
+    size_t field;
+    size_t n;
+
+    rows = newCSVRows(text, sizeof(text) - 1, ',', 4);
+    ck_assert_msg(rows != NULL, "newCSVRows() returned NULL");
+    ck_assert_msg(getRowCountCSVRows(rows) == LEN(fieldCounts),
+        "row count mismatch");
+    field = 0;
+    for (size_t i = 0; i < LEN(fieldCounts); i++) {
+        ck_assert_msg(getFieldCountCSVRows(rows, i) == fieldCounts[i],
+            "row %ld field count mismatch", i);
+        for (size_t j = 0; j < fieldCounts[i]; j++, field++) {
+            n = unquoteFieldCSV(text, getFieldCSVRows(rows, i, j), out);
+            ck_assert_msg(n == strlen(fields[field])
+                && !memcmp(out, fields[field], n), "field %ld mismatch",
+                field);
+        }
+    }
+    deleteCSVRows(rows);
+    ck_assert_msg(newCSVRows("a,\"b", 4, ',', 1) == NULL,
+        "an unterminated quote was accepted");
+}
+END_TEST
+
+/* 1 to maxThreads threads give the rows of the streaming parser */
+static void
+checkSameRowsCSV(const char *text, size_t n, int maxThreads)
+{
+    CSVParser *parser;
+    CSVRows *rows;
+    char *out;
+    size_t count;
+    size_t length;
+
+    /* a '|' after each field and a '\n' after each row */
+    streamed = malloc(n * 2 + 2);
+    out = malloc(n * 2 + 2);
+    ck_assert_msg(streamed && out, "malloc() failed");
+    parser = newCSVParser(',', 0, onStreamedField, onStreamedRow, NULL);
+    streamedCount = 0;
+    ck_assert_msg(!feedCSVParser(parser, text, n) && !finishCSVParser(parser),
+        "the streaming parser failed");
+    deleteCSVParser(parser);
+    for (int nThreads = 1; nThreads <= maxThreads; nThreads++) {
+        rows = newCSVRows(text, n, ',', nThreads);
+        ck_assert_msg(rows != NULL, "newCSVRows() returned NULL");
+        count = 0;
+        for (size_t i = 0; i < getRowCountCSVRows(rows); i++) {
+            for (size_t j = 0; j < getFieldCountCSVRows(rows, i); j++) {
+                length = unquoteFieldCSV(text, getFieldCSVRows(rows, i, j),
+                    out + count);
+                count += length;
+                out[count++] = '|';
+            }
+            out[count++] = '\n';
+        }
+        ck_assert_msg(count == streamedCount
+            && !memcmp(out, streamed, count),
+            "rows mismatch with %d threads", nThreads);
+        deleteCSVRows(rows);
+    }
+    free(out);
+    free(streamed);
+}
+
+START_TEST(testCSVRows_Threads)
+{
+    char *text;
+    size_t n;
+
+    n = (size_t)1 << 20;
+    for (int isStrict = 1; isStrict >= 0; isStrict--) {
+        text = makeCSVRowsText(n, isStrict);
+        checkSameRowsCSV(text, n, 16);
+        free(text);
+    }
+}
+END_TEST
+
+/* rows end at a lone CR in both parsers */
+START_TEST(testCSVRows_Returns)
+{
+    static const char text[] =
+        "a,b\rc\r\r\nd\n\re,\"f\rg\"\r\r\n\rh,\"\"\r\ni\r";
+
+    checkSameRowsCSV(text, sizeof(text) - 1, 4);
+}
+END_TEST
+
+START_TEST(testCSVTable)
+{
+    static const char text[] = 
+        "id,skipped,price,name\r\n"
+        "1,x,2.5,apple\r\n"
+        "-42,\"y,z\",\"1e3\",\"b\"\"c\"\r\n"
+        ",,,\n"
+        "9223372036854775807,w\n";
+    static const CSVColumnType schema[] = {
+        CSVColumnType_int64, CSVColumnType_skip, CSVColumnType_double,
+        CSVColumnType_string,
+    };
+    static const int64_t ids[] = {1, -42, 0, INT64_MAX};
+    static const char *names[] = {"apple", "b\"c", "", ""};
+    CSVTable *table;
+
+    table = newCSVTable(text, sizeof(text) - 1, ',', schema, LEN(schema),
+        CSVTableFlags_header);
+    ck_assert_msg(table != NULL, "newCSVTable() returned NULL");
+    ck_assert_msg(table->nRows == 4, "row count mismatch");
+    ck_assert_msg(getColumnCSVTable(table, 1)->values == NULL,
+        "a skipped column has values");
+    for (size_t i = 0; i < table->nRows; i++) {
+        ck_assert_msg(getInt64CSVTable(table, i, 0) == ids[i],
+            "int64 %ld mismatch", i);
+        ck_assert_msg(!strcmp(getStringCSVTable(table, i, 3), names[i]),
+            "string %ld mismatch", i);
+    }
+    ck_assert_msg(getDoubleCSVTable(table, 0, 2) == 2.5
+        && getDoubleCSVTable(table, 1, 2) == 1000.0
+        && isnan(getDoubleCSVTable(table, 2, 2))
+        && isnan(getDoubleCSVTable(table, 3, 2)), "double mismatch");
+    deleteCSVTable(table);
+    /* the header is loaded without the flag, and is not a number */
+    ck_assert_msg(!newCSVTable(text, sizeof(text) - 1, ',', schema,
+        LEN(schema), 0), "a bad number was accepted");
+}
+END_TEST
+
+START_TEST(testNewCSVRaw_LongFields)
+{
+    char *text;
+    VLArray *fields;
+    size_t n;
+
+    /* fields much longer than the frames and than sizeof(size_t) */
+    n = 3 * 1000 + 2;
+    text = malloc(n);
+    ck_assert_msg(text != NULL, "malloc() failed");
+    memset(text, 'x', n);
+    text[1000] = ',';
+    text[2001] = ',';
+    fields = newCSVRaw(text, n);
+    ck_assert_msg(fields != NULL, "newCSVRaw() returned NULL");
+    ck_assert_msg(getCountVLArray(fields) == 3, "field count mismatch");
+    for (size_t i = 0; i < 3; i++) {
+        ck_assert_msg(sizeOfElementVLArray(fields, i) == 1001,
+            "field %ld size mismatch", i);
+        ck_assert_msg(strlen((char *)getElementVLArray(fields, i)) == 1000,
+            "field %ld is not null terminated", i);
+    }
+    deleteVLArray(fields);
+    fields = newCSVRaw(testCSV, sizeof(testCSV) - 1);
+    ck_assert_msg(fields != NULL, "newCSVRaw() returned NULL");
+    for (size_t i = 0; i < LEN(testFields); i++) {
+        ck_assert_msg(!strcmp((char *)getElementVLArray(fields, i),
+            testFields[i]), "field %ld mismatch", i);
+    }
+    deleteVLArray(fields);
+    free(text);
+}
+END_TEST
+
+Suite *
+csv_suite()
+{
+    Suite *ret;
+    TCase *tcCore;
+
+    ret = suite_create("CSV");
+    tcCore = tcase_create("Core");
+    tcase_add_test(tcCore, testNewCSVSpans);
+    tcase_add_test(tcCore, testNewCSVSpans_BlockBoundaries);
+    tcase_add_test(tcCore, testCSVParser_Chunks);
+    tcase_add_test(tcCore, testCSVParser_Errors);
+    tcase_add_test(tcCore, testCSVRows);
+    tcase_add_test(tcCore, testCSVRows_Threads);
+    tcase_add_test(tcCore, testCSVRows_Returns);
+    tcase_add_test(tcCore, testCSVTable);
+    tcase_add_test(tcCore, testNewCSVRaw_LongFields);
+    suite_add_tcase(ret, tcCore);
+    return ret;
+}
+
+int
+main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = csv_suite();
+    sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return !number_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <stdio.h>
+#include "../src/gap_vlarray.h"
+#include "../src/utils.h"
+
+#define N_OPERATIONS 20000
+#define MAX_ELEMENT_SIZE 40
+
+/* arr has the same elements as expected, in the same order */
+static void
+checkSameElements(const GapVLArray *arr, const VLArray *expected)
+{
+    ck_assert_msg(getCountGapVLArray(arr) == getCountVLArray(expected),
+        "count mismatch");
+    for (size_t i = 0; i < getCountGapVLArray(arr); i++) {
+        ck_assert_msg(sizeOfElementGapVLArray(arr, i)
+            == sizeOfElementVLArray(expected, i), "size of %ld differs", i);
+        ck_assert_msg(!memcmp(getElementGapVLArray(arr, i),
+            getElementVLArray(expected, i), sizeOfElementGapVLArray(arr, i)),
+            "element %ld differs", i);
+    }
+}
+
+START_TEST(testInsertGapVLArray)
+{
+    GapVLArray *arr;
+    const char *words[] = { "b", "", "dddd", "a", "ccc" };
+
+    arr = newGapVLArray(1, 1);
+    ck_assert_msg(arr != NULL, "newGapVLArray() returned NULL");
+    ck_assert_msg(!pushGapVLArray(arr, words[0], 1)
+        && !pushGapVLArray(arr, words[2], 4)
+        && !insertGapVLArray(arr, words[3], 1, 0)
+        && !insertGapVLArray(arr, words[4], 3, 2)
+        && !insertGapVLArray(arr, words[1], 0, 2),
+        "insertGapVLArray() failed");
+    ck_assert_msg(insertGapVLArray(arr, words[0], 1, 6),
+        "an element was inserted past the end");
+    ck_assert_msg(getCountGapVLArray(arr) == 5
+        && getSizeGapVLArray(arr) == 9, "count or size mismatch");
+    /* a, b, "", ccc, dddd */
+    ck_assert_msg(!memcmp(getElementGapVLArray(arr, 0), "a", 1)
+        && !memcmp(getElementGapVLArray(arr, 1), "b", 1)
+        && sizeOfElementGapVLArray(arr, 2) == 0
+        && !memcmp(getElementGapVLArray(arr, 3), "ccc", 3)
+        && !memcmp(getElementGapVLArray(arr, 4), "dddd", 4),
+        "elements are out of order");
+    ck_assert_msg(getCursorGapVLArray(arr) == 3,
+        "the cursor is not after the last insert");
+    clearGapVLArray(arr);
+    ck_assert_msg(isEmptyGapVLArray(arr) && !getSizeGapVLArray(arr),
+        "clearGapVLArray() failed");
+    deleteGapVLArray(arr);
+}
+END_TEST
+
+/* random inserts and removes, mostly near the cursor, match a VLArray */
+START_TEST(testGapVLArray_RandomEdits)
+{
+    GapVLArray *arr;
+    VLArray *expected;
+    VLArray *copy;
+    char element[MAX_ELEMENT_SIZE];
+    char removed[MAX_ELEMENT_SIZE];
+    size_t size;
+    size_t index;
+
+    arr = newGapVLArray(-1, -1);
+    expected = newVLArrayPacked(-1, -1, 1);
+    ck_assert_msg(arr != NULL && expected != NULL, "constructor failed");
+    srand(1);
+    for (int i = 0; i < N_OPERATIONS; i++) {
+        index = getCursorGapVLArray(arr) + rand() % 3;
+        index = MIN(index, getCountGapVLArray(arr));
+        if (rand() % 4 == 0)
+            index = rand() % (getCountGapVLArray(arr) + 1);
+        if (getCountGapVLArray(arr) && rand() % 3 == 0) {
+            index = MIN(index, getCountGapVLArray(arr) - 1);
+            size = sizeOfElementGapVLArray(arr, index);
+            ck_assert_msg(!removeAtGapVLArray(arr, removed, index),
+                "removeAtGapVLArray() failed");
+            ck_assert_msg(!memcmp(removed, getElementVLArray(expected,
+                index), size), "the removed element differs");
+            removeAtVLArray(expected, NULL, index);
+        } else {
+            size = rand() % MAX_ELEMENT_SIZE;
+            for (size_t j = 0; j < size; j++)
+                element[j] = rand();
+            ck_assert_msg(!insertGapVLArray(arr, element, size, index),
+                "insertGapVLArray() failed");
+            ck_assert_msg(insertVLArray(expected, element, size, index)
+                != NULL, "insertVLArray() failed");
+        }
+        if (i % 1000 == 0)
+            checkSameElements(arr, expected);
+    }
+    checkSameElements(arr, expected);
+    ck_assert_msg(getSizeGapVLArray(arr) == getSizeVLArray(expected),
+        "size mismatch");
+    /* moving the cursor does not change the elements */
+    ck_assert_msg(!moveCursorGapVLArray(arr, 0)
+        && moveCursorGapVLArray(arr, getCountGapVLArray(arr) + 1),
+        "moveCursorGapVLArray() failed");
+    checkSameElements(arr, expected);
+    copy = toVLArrayGapVLArray(arr);
+    ck_assert_msg(copy != NULL, "toVLArrayGapVLArray() returned NULL");
+    ck_assert_msg(getCountVLArray(copy) == getCountVLArray(expected)
+        && getSizeVLArray(copy) == getSizeVLArray(expected),
+        "the copy differs");
+    deleteVLArray(copy);
+    deleteVLArray(expected);
+    deleteGapVLArray(arr);
+}
+END_TEST
+
+Suite *
+gap_vlarray_suite()
+{
+    Suite *ret;
+    TCase *tcCore;
+
+    ret = suite_create("GapVLArray");
+    tcCore = tcase_create("Core");
+    tcase_add_test(tcCore, testInsertGapVLArray);
+    tcase_add_test(tcCore, testGapVLArray_RandomEdits);
+    suite_add_tcase(ret, tcCore);
+    return ret;
+}
+
+int
+main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = gap_vlarray_suite();
+    sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return !number_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
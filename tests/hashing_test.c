@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <stdio.h>
+#include <math.h>
+#include "../src/hashing.h"
+#include "../src/utils.h"
+
+#define N_RANDOM_BYTES 1024
+#define N_AVALANCHE_KEYS 10000
+/* the largest allowed |P(output bit flips) - 0.5| of a good hash */
+#define MAX_AVALANCHE_BIAS 0.05
+
+static const uint8_t checkInput[] = "123456789";
+static uint8_t randomBytes[N_RANDOM_BYTES];
+
+/* bit at a time CRC, used as the reference implementation */
+static uint32_t
+crcBitwise(uint32_t poly, const uint8_t *data, size_t n)
+{
+    uint32_t ret;
+
+    ret = ~(uint32_t)0;
+    for (size_t i = 0; i < n; i++) {
+        ret ^= data[i];
+        for (int j = 0; j < 8; j++)
+            ret = ret & 1 ? (ret >> 1) ^ poly : ret >> 1;
+    }
+    return ~ret;
+}
+
+static void
+setupTestValues()
+{
+    uint32_t state;
+
+    state = 12345;
+    for (size_t i = 0; i < N_RANDOM_BYTES; i++) {
+        state = state * 1103515245 + 12345;
+        randomBytes[i] = state >> 16;
+    }
+}
+
+START_TEST(testCRC32_CheckValue)
+{
+    ck_assert_msg(crc32(checkInput, sizeof(checkInput) - 1) == 0xcbf43926,
+        "crc32 check value mismatch");
+    ck_assert_msg(crc32(NULL, 0) == 0, "crc32 of nothing is not 0");
+}
+END_TEST
+
+START_TEST(testCRC32C_CheckValue)
+{
+    ck_assert_msg(crc32c(checkInput, sizeof(checkInput) - 1) == 0xe3069283,
+        "crc32c check value mismatch");
+    ck_assert_msg(crc32cPortable(checkInput, sizeof(checkInput) - 1)
+        == 0xe3069283, "crc32cPortable check value mismatch");
+    ck_assert_msg(crc32c(NULL, 0) == 0, "crc32c of nothing is not 0");
+}
+END_TEST
+
+/* every length and alignment around the 8 byte blocks */
+START_TEST(testCRC32_LengthsAndAlignments)
+{
+    const uint8_t *data;
+
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t n = 0; n < 80; n++) {
+            data = randomBytes + offset;
+            ck_assert_msg(crc32(data, n)
+                == crcBitwise(0xedb88320, data, n),
+                "crc32 mismatch at offset %ld length %ld", offset, n);
+            ck_assert_msg(crc32c(data, n)
+                == crcBitwise(0x82f63b78, data, n),
+                "crc32c mismatch at offset %ld length %ld", offset, n);
+            ck_assert_msg(crc32cPortable(data, n) == crc32c(data, n),
+                "crc32cPortable mismatch at offset %ld length %ld", offset,
+                n);
+        }
+    }
+    ck_assert_msg(crc32(randomBytes, N_RANDOM_BYTES)
+        == crcBitwise(0xedb88320, randomBytes, N_RANDOM_BYTES),
+        "crc32 mismatch on a long input");
+    ck_assert_msg(crc32c(randomBytes, N_RANDOM_BYTES)
+        == crcBitwise(0x82f63b78, randomBytes, N_RANDOM_BYTES),
+        "crc32c mismatch on a long input");
+}
+END_TEST
+
+/* same as crc32(), but with a 64 bit result so it can be passed to avalanche */
+static uint64_t
+crc32Hash64(const uint8_t *data, size_t n, uint64_t seed)
+{
+    (void)seed;
+    return crc32(data, n);
+}
+
+/*
+ * EFFECTS
+ * flips each bit of N_AVALANCHE_KEYS nKey bytes long keys and returns the
+ * largest |P(output bit j flips when input bit i flips) - 0.5| over the 
+ * first nHashBits output bits (the strict avalanche criterion).
+ */
+static double
+avalanche(uint64_t (*hashFunc)(const uint8_t *, size_t, uint64_t), 
+    size_t nKey, int nHashBits)
+{
+    static unsigned flips[64][64];
+    uint8_t key[8];
+    uint64_t hash;
+    uint64_t diff;
+    double ret;
+
+    memset(flips, 0, sizeof(flips));
+    for (size_t k = 0; k < N_AVALANCHE_KEYS; k++) {
+        memcpy(key, randomBytes + k % (N_RANDOM_BYTES - nKey), nKey);
+        key[0] ^= k;
+        key[nKey - 1] ^= k >> 8;
+        hash = hashFunc(key, nKey, 0);
+        for (size_t i = 0; i < nKey * 8; i++) {
+            key[i / 8] ^= 1 << i % 8;
+            diff = hash ^ hashFunc(key, nKey, 0);
+            key[i / 8] ^= 1 << i % 8;
+            for (int j = 0; j < nHashBits; j++)
+                flips[i][j] += diff >> j & 1;
+        }
+    }
+    ret = 0;
+    for (size_t i = 0; i < nKey * 8; i++) {
+        for (int j = 0; j < nHashBits; j++) {
+            ret = MAX(ret, fabs((double)flips[i][j] / N_AVALANCHE_KEYS
+                - 0.5));
+        }
+    }
+    return ret;
+}
+
+START_TEST(testCRC32_Streaming)
+{
+    CRC32Context ctx;
+    size_t chunkSize;
+
+    /* chunk sizes that do and do not line up with the 8 byte blocks */
+    for (chunkSize = 1; chunkSize < 40; chunkSize += 3) {
+        crc32Init(&ctx);
+        for (size_t i = 0; i < N_RANDOM_BYTES; i += chunkSize) {
+            crc32Update(&ctx, randomBytes + i,
+                MIN(chunkSize, N_RANDOM_BYTES - i));
+        }
+        ck_assert_msg(crc32Final(&ctx) == crc32(randomBytes, N_RANDOM_BYTES),
+            "streaming crc32 mismatch with %ld byte chunks", chunkSize);
+        ck_assert_msg(ctx.n == N_RANDOM_BYTES, "streaming length mismatch");
+    }
+    crc32Init(&ctx);
+    ck_assert_msg(crc32Final(&ctx) == 0, "crc32 of nothing is not 0");
+}
+END_TEST
+
+START_TEST(testCRC32_Combine)
+{
+    uint8_t *zeros;
+    size_t nZeros;
+    uint32_t crcA;
+
+    for (size_t split = 0; split <= N_RANDOM_BYTES; split += 37) {
+        ck_assert_msg(crc32Combine(crc32(randomBytes, split),
+            crc32(randomBytes + split, N_RANDOM_BYTES - split),
+            N_RANDOM_BYTES - split) == crc32(randomBytes, N_RANDOM_BYTES),
+            "crc32Combine mismatch when split at %ld", split);
+    }
+    /* a long second piece */
+    nZeros = (size_t)1 << 20;
+    zeros = calloc(nZeros + 9, 1);
+    ck_assert_msg(zeros != NULL, "calloc() failed");
+    memcpy(zeros, checkInput, 9);
+    crcA = crc32(checkInput, 9);
+    ck_assert_msg(crc32Combine(crcA, crc32(zeros + 9, nZeros), nZeros)
+        == crc32(zeros, nZeros + 9), "crc32Combine mismatch on 1MiB");
+    free(zeros);
+}
+END_TEST
+
+START_TEST(testMixHash64_Consistency)
+{
+    uint64_t hash;
+    uint8_t copy[128];
+
+    /* every length around the 16 and 48 byte blocks, and every alignment */
+    for (size_t n = 0; n < 120; n++) {
+        hash = mixHash64(randomBytes, n, 1);
+        for (size_t offset = 1; offset < 8; offset++) {
+            memcpy(copy + offset, randomBytes, n);
+            ck_assert_msg(mixHash64(copy + offset, n, 1) == hash,
+                "mixHash64 depends on alignment at length %ld", n);
+        }
+        ck_assert_msg(mixHash64(randomBytes, n, 2) != hash,
+            "the seed does not change mixHash64 at length %ld", n);
+        ck_assert_msg(!n || mixHash64(randomBytes, n - 1, 1) != hash,
+            "mixHash64 ignores the last byte at length %ld", n);
+    }
+    ck_assert_msg(mixHash(checkInput, sizeof(checkInput) - 1)
+        == mixHash(checkInput, sizeof(checkInput) - 1),
+        "mixHash is not deterministic");
+}
+END_TEST
+
+START_TEST(testMixHash64_Avalanche)
+{
+    double mixBias;
+    double crcBias;
+
+    for (size_t nKey = 2; nKey <= 8; nKey *= 2) {
+        mixBias = avalanche(mixHash64, nKey, 64);
+        crcBias = avalanche(crc32Hash64, nKey, 32);
+        ck_assert_msg(mixBias < MAX_AVALANCHE_BIAS,
+            "mixHash64 avalanche bias %f with %ld byte keys", mixBias, nKey);
+        /* crc32 is linear, so some output bits always (or never) flip */
+        ck_assert_msg(crcBias > mixBias,
+            "crc32 avalanches better than mixHash64 with %ld byte keys", 
+            nKey);
+    }
+}
+END_TEST
+
+Suite *
+hashing_suite()
+{
+    Suite *ret;
+    TCase *tcCore;
+
+    ret = suite_create("Hashing");
+    tcCore = tcase_create("Core");
+    tcase_add_test(tcCore, testCRC32_CheckValue);
+    tcase_add_test(tcCore, testCRC32C_CheckValue);
+    tcase_add_test(tcCore, testCRC32_LengthsAndAlignments);
+    tcase_add_test(tcCore, testCRC32_Streaming);
+    tcase_add_test(tcCore, testCRC32_Combine);
+    tcase_add_test(tcCore, testMixHash64_Consistency);
+    tcase_add_test(tcCore, testMixHash64_Avalanche);
+    suite_add_tcase(ret, tcCore);
+    return ret;
+}
+
+int
+main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    setupTestValues();
+    s = hashing_suite();
+    sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return !number_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -55,12 +55,14 @@ setupTestValues()
         testKeysInt[i] = _testKeysInt + i;
 }
 
+static int spawnFlags = HashTableFlags_none;
+
 static HashTable *
 spawnHashTable()
 {
     HashTable *ht;
 
-    ht = newHashTable(crc32, capacity, maxLoadFactor);
+    ht = newHashTableWithFlags(crc32, capacity, maxLoadFactor, spawnFlags);
     ck_assert_msg(ht != NULL, "newHashTable() returned NULL");
     return ht;
 }
@@ -271,6 +273,531 @@ START_TEST(testGetHashTable_Int)
 }
 END_TEST
 
+static void
+checkManyKeys(int flags)
+{
+    HashTable *ht;
+    int kvIndex;
+    size_t key;
+    size_t value;
+
+    ht = newHashTableWithFlags(crc32, capacity, maxLoadFactor, flags);
+    ck_assert_msg(ht != NULL, "newHashTableWithFlags() returned NULL");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        value = i * 3;
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&value, sizeof(value)) == (int)i,
+            "insertHashTable failed with key %ld", i);
+    }
+    ck_assert_msg(getCountHashTable(ht) == N_VALID_KEYS, "count mismatch");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        kvIndex = getHashTable(ht, (uint8_t *)&i, sizeof(i));
+        ck_assert_msg(kvIndex == (int)i, "key %ld has the wrong kvIndex", i);
+        ck_assert_msg(*(size_t *)getValueHashTable(ht, (uint8_t *)&i,
+            sizeof(i)) == i * 3, "key %ld has the wrong value", i);
+    }
+    /* keys that were never inserted */
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        key = N_VALID_KEYS + i;
+        ck_assert_msg(getHashTable(ht, (uint8_t *)&key, sizeof(key)) < 0,
+            "missing key %ld was found", key);
+    }
+    deleteHashTable(ht);
+}
+
+START_TEST(testGetHashTable_ManyKeys)
+{
+    checkManyKeys(HashTableFlags_none);
+}
+END_TEST
+
+static uint32_t
+identityHash(const uint8_t *data, size_t n)
+{
+    uint32_t ret;
+
+    ret = 0;
+    memcpy(&ret, data, MIN(n, sizeof(ret)));
+    return ret;
+}
+
+static uint32_t
+constantHash(const uint8_t *data, size_t n)
+{
+    (void)data;
+    (void)n;
+    return 7;
+}
+
+START_TEST(testGetHashTable_HashRejects)
+{
+    HashTable *ht;
+    uint32_t key;
+
+    /* keys that share a bucket but not a hash are rejected without memcmp */
+    ht = newHashTable(identityHash, capacity, 100);
+    ck_assert_msg(ht != NULL, "newHashTable() returned NULL");
+    for (key = 0; key < N_VALID_KEYS; key++) {
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&key, sizeof(key),
+            (uint8_t *)&key, sizeof(key)) >= 0, "insertHashTable failed");
+    }
+    memset(&ht->stats, 0, sizeof(ht->stats));
+    for (key = 0; key < N_VALID_KEYS; key++) {
+        ck_assert_msg(getHashTable(ht, (uint8_t *)&key, sizeof(key))
+            == (int)key, "key %d has the wrong kvIndex", key);
+    }
+    ck_assert_msg(ht->stats.keyComparisons == N_VALID_KEYS,
+        "%ld key comparisons", ht->stats.keyComparisons);
+    ck_assert_msg(ht->stats.falsePositives == 0,
+        "%ld false positives", ht->stats.falsePositives);
+    ck_assert_msg(ht->stats.hashRejects > 0, "no hashes were rejected");
+    deleteHashTable(ht);
+}
+END_TEST
+
+START_TEST(testGetHashTable_FalsePositives)
+{
+    HashTable *ht;
+    uint32_t key;
+
+    /* every key has the same hash, so every mismatch is a false positive */
+    ht = newHashTable(constantHash, capacity, maxLoadFactor);
+    ck_assert_msg(ht != NULL, "newHashTable() returned NULL");
+    for (key = 0; key < 10; key++) {
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&key, sizeof(key),
+            (uint8_t *)&key, sizeof(key)) >= 0, "insertHashTable failed");
+    }
+    memset(&ht->stats, 0, sizeof(ht->stats));
+    key = 9;
+    ck_assert_msg(getHashTable(ht, (uint8_t *)&key, sizeof(key)) == 9,
+        "key has the wrong kvIndex");
+    ck_assert_msg(ht->stats.falsePositives == 9,
+        "%ld false positives", ht->stats.falsePositives);
+    ck_assert_msg(ht->stats.hashRejects == 0,
+        "%ld hashes were rejected", ht->stats.hashRejects);
+    deleteHashTable(ht);
+}
+END_TEST
+
+START_TEST(testPow2Buckets_ManyKeys)
+{
+    checkManyKeys(HashTableFlags_pow2Buckets);
+}
+END_TEST
+
+START_TEST(testPow2Buckets_WeakHash)
+{
+    HashTable *ht;
+    uint32_t key;
+
+    /* 
+     * every key is a multiple of the bucket count, so HASH % bucketCount
+     * would put them all in one bucket.
+     */
+    ht = newHashTableWithFlags(identityHash, 64, 100,
+        HashTableFlags_pow2Buckets);
+    ck_assert_msg(ht != NULL, "newHashTableWithFlags() returned NULL");
+    ck_assert_msg(getBucketCountHashTable(ht) == 64,
+        "bucket count is not a power of two");
+    for (uint32_t i = 0; i < 256; i++) {
+        key = i * 64;
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&key, sizeof(key),
+            (uint8_t *)&key, sizeof(key)) >= 0, "insertHashTable failed");
+    }
+    ck_assert_msg(ht->nonEmptyBuckets >= 32, "only %ld buckets are used",
+        ht->nonEmptyBuckets);
+    for (uint32_t i = 0; i < 256; i++) {
+        key = i * 64;
+        ck_assert_msg(getHashTable(ht, (uint8_t *)&key, sizeof(key))
+            == (int)i, "key %d has the wrong kvIndex", key);
+    }
+    deleteHashTable(ht);
+}
+END_TEST
+
+START_TEST(testIncrementalResize_ManyKeys)
+{
+    checkManyKeys(HashTableFlags_incrementalResize);
+    checkManyKeys(HashTableFlags_incrementalResize
+        | HashTableFlags_pow2Buckets);
+}
+END_TEST
+
+START_TEST(testIncrementalResize_LookupWhileResizing)
+{
+    HashTable *ht;
+    size_t resizeCount;
+
+    ht = newHashTableWithFlags(crc32, capacity, maxLoadFactor,
+        HashTableFlags_incrementalResize);
+    ck_assert_msg(ht != NULL, "newHashTableWithFlags() returned NULL");
+    resizeCount = 0;
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&i, sizeof(i)) == (int)i,
+            "insertHashTable failed with key %ld", i);
+        if (!isResizingHashTable(ht))
+            continue;
+        /* every key must be found while the old buckets are migrated */
+        resizeCount++;
+        for (size_t j = 0; j <= i; j++) {
+            ck_assert_msg(getHashTable(ht, (uint8_t *)&j, sizeof(j))
+                == (int)j, "key %ld was lost during a resize", j);
+        }
+    }
+    ck_assert_msg(resizeCount > 0, "the table was never resizing");
+    ck_assert_msg(!finishResizeHashTable(ht),
+        "finishResizeHashTable() failed");
+    ck_assert_msg(!isResizingHashTable(ht), "the table is still resizing");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        ck_assert_msg(getHashTable(ht, (uint8_t *)&i, sizeof(i)) == (int)i,
+            "key %ld was lost after a resize", i);
+    }
+    deleteHashTable(ht);
+}
+END_TEST
+
+/* with a small maxLoadFactor, each resize still drains before the next */
+START_TEST(testIncrementalResize_LowLoadFactor)
+{
+    HashTable *ht;
+    size_t nBuckets;
+    size_t nGrows;
+
+    ht = newHashTableWithFlags(crc32, 8, 0.1f,
+        HashTableFlags_incrementalResize);
+    ck_assert_msg(ht != NULL, "newHashTableWithFlags() returned NULL");
+    nGrows = 0;
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        nBuckets = getBucketCountHashTable(ht);
+        /* an insert only migrates resizeStep buckets before it grows ht */
+        ck_assert_msg(!isResizingHashTable(ht) || getCountHashTable(ht) + 1
+            <= ht->maxLoadFactor * nBuckets || getCountArray(ht->oldRecords)
+            - ht->resizeIndex <= ht->resizeStep,
+            "a grow would finish the last resize synchronously");
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&i, sizeof(i)) == (int)i,
+            "insertHashTable failed with key %ld", i);
+        nGrows += nBuckets != getBucketCountHashTable(ht);
+    }
+    ck_assert_msg(nGrows > 2, "the table only grew %ld times", nGrows);
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        ck_assert_msg(getHashTable(ht, (uint8_t *)&i, sizeof(i)) == (int)i,
+            "key %ld was lost", i);
+    }
+    deleteHashTable(ht);
+}
+END_TEST
+
+static void
+checkRemoveKeys(int flags)
+{
+    HashTable *ht;
+    size_t value;
+
+    ht = newHashTableWithFlags(crc32, capacity, maxLoadFactor, flags);
+    ck_assert_msg(ht != NULL, "newHashTableWithFlags() returned NULL");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        value = i * 3;
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&value, sizeof(value)) == (int)i,
+            "insertHashTable failed with key %ld", i);
+    }
+    /* remove the even keys */
+    for (size_t i = 0; i < N_VALID_KEYS; i += 2) {
+        ck_assert_msg(removeHashTable(ht, (uint8_t *)&i, sizeof(i)) == (int)i,
+            "removeHashTable failed with key %ld", i);
+    }
+    ck_assert_msg(removeHashTable(ht, (uint8_t *)&(size_t){0},
+        sizeof(size_t)) < 0, "a removed key was removed twice");
+    ck_assert_msg(getCountHashTable(ht) == N_VALID_KEYS / 2,
+        "count mismatch after removing");
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < N_VALID_KEYS; i++) {
+            if (i % 2) {
+                ck_assert_msg(*(size_t *)getValueHashTable(ht, (uint8_t *)&i,
+                    sizeof(i)) == i * 3, "key %ld has the wrong value", i);
+            } else {
+                ck_assert_msg(getHashTable(ht, (uint8_t *)&i, sizeof(i)) < 0,
+                    "removed key %ld was found", i);
+            }
+        }
+        /* the second pass checks the compacted table */
+        ck_assert_msg(!compactHashTable(ht), "compactHashTable() failed");
+        ck_assert_msg(getKVCountHashTable(ht) == N_VALID_KEYS / 2,
+            "compactHashTable() did not reclaim the removed keys");
+    }
+    /* removed keys can be inserted again */
+    for (size_t i = 0; i < N_VALID_KEYS; i += 2) {
+        value = i * 3;
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&value, sizeof(value)) >= 0,
+            "insertHashTable failed with key %ld", i);
+    }
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        ck_assert_msg(*(size_t *)getValueHashTable(ht, (uint8_t *)&i,
+            sizeof(i)) == i * 3, "key %ld has the wrong value", i);
+    }
+    deleteHashTable(ht);
+}
+
+START_TEST(testRemoveHashTable_ManyKeys)
+{
+    checkRemoveKeys(HashTableFlags_none);
+    checkRemoveKeys(HashTableFlags_pow2Buckets
+        | HashTableFlags_incrementalResize);
+    checkRemoveKeys(HashTableFlags_openAddressing);
+}
+END_TEST
+
+START_TEST(testUpdateHashTable)
+{
+    HashTable *ht;
+    int kvIndex;
+    size_t key;
+    size_t value;
+    char bigValue[256];
+
+    ht = spawnHashTable();
+    key = 7;
+    value = 1;
+    kvIndex = updateHashTable(ht, (uint8_t *)&key, sizeof(key),
+        (uint8_t *)&value, sizeof(value));
+    ck_assert_msg(kvIndex >= 0, "updateHashTable() did not insert the key");
+    /* the new value fits in the old frames */
+    value = 2;
+    ck_assert_msg(updateHashTable(ht, (uint8_t *)&key, sizeof(key),
+        (uint8_t *)&value, sizeof(value)) == kvIndex,
+        "updateHashTable() moved a value that fits");
+    ck_assert_msg(*(size_t *)getValueHashTable(ht, (uint8_t *)&key,
+        sizeof(key)) == 2, "updateHashTable() did not overwrite the value");
+    ck_assert_msg(ht->deadCount == 0, "an overwritten pair was marked dead");
+    /* the new value needs more frames */
+    memset(bigValue, 'x', sizeof(bigValue));
+    ck_assert_msg(updateHashTable(ht, (uint8_t *)&key, sizeof(key),
+        (uint8_t *)bigValue, sizeof(bigValue)) != kvIndex,
+        "updateHashTable() did not move a value that does not fit");
+    ck_assert_msg(ht->deadCount == 1, "the moved pair was not marked dead");
+    ck_assert_msg(getCountHashTable(ht) == 1, "count mismatch");
+    kvIndex = getHashTable(ht, (uint8_t *)&key, sizeof(key));
+    ck_assert_msg(getSizeofValueHashTable(ht, kvIndex) == sizeof(bigValue)
+        && !memcmp(getValueByKVIndexHashTable(ht, kvIndex), bigValue,
+        sizeof(bigValue)), "the moved value is wrong");
+    ck_assert_msg(!compactHashTable(ht), "compactHashTable() failed");
+    ck_assert_msg(getHashTable(ht, (uint8_t *)&key, sizeof(key)) == 0,
+        "the key was not remapped by compactHashTable()");
+    deleteHashTable(ht);
+}
+END_TEST
+
+static void
+checkGetMany(int flags)
+{
+    HashTable *ht;
+    size_t keys[2 * N_VALID_KEYS];
+    const uint8_t *keyPtrs[LEN(keys)];
+    size_t nKeys[LEN(keys)];
+    int kvIndexes[LEN(keys)];
+
+    ht = newHashTableWithFlags(crc32, capacity, maxLoadFactor, flags);
+    ck_assert_msg(ht != NULL, "newHashTableWithFlags() returned NULL");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&i, sizeof(i)) == (int)i,
+            "insertHashTable failed with key %ld", i);
+    }
+    /* interleave present and missing keys */
+    for (size_t i = 0; i < LEN(keys); i++) {
+        keys[i] = i % 2 ? N_VALID_KEYS + i : i / 2;
+        keyPtrs[i] = (const uint8_t *)&keys[i];
+        nKeys[i] = sizeof(keys[i]);
+    }
+    ck_assert_msg(getManyHashTable(ht, keyPtrs, nKeys, LEN(keys), kvIndexes)
+        == N_VALID_KEYS, "getManyHashTable() found the wrong number of keys");
+    for (size_t i = 0; i < LEN(keys); i++) {
+        ck_assert_msg(kvIndexes[i] == getHashTable(ht, keyPtrs[i], nKeys[i]),
+            "getManyHashTable() disagrees with getHashTable() on key %ld",
+            keys[i]);
+    }
+    deleteHashTable(ht);
+}
+
+START_TEST(testGetManyHashTable)
+{
+    checkGetMany(HashTableFlags_none);
+    checkGetMany(HashTableFlags_pow2Buckets
+        | HashTableFlags_incrementalResize);
+    checkGetMany(HashTableFlags_openAddressing);
+}
+END_TEST
+
+static void
+checkHash64(int flags)
+{
+    HashTable *ht;
+    size_t value;
+    const uint8_t *keys[N_VALID_KEYS];
+    size_t keyStorage[N_VALID_KEYS];
+    size_t nKeys[N_VALID_KEYS];
+    int kvIndexes[N_VALID_KEYS];
+
+    ht = newHashTable64(mixHash64, getRandomSeedHashing(), capacity,
+        maxLoadFactor, flags);
+    ck_assert_msg(ht != NULL, "newHashTable64() returned NULL");
+    ck_assert_msg(isHash64HashTable(ht) && isPow2BucketsHashTable(ht),
+        "newHashTable64() flags are invalid");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        ck_assert_msg(insertHashTable(ht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&i, sizeof(i)) == (int)i,
+            "insertHashTable failed with key %ld", i);
+        ck_assert_msg(getHash64HashTable(ht, i) == mixHash64((uint8_t *)&i,
+            sizeof(i), ht->seed), "the full hash of key %ld is not stored",
+            i);
+    }
+    /* update the even keys and remove every third key */
+    for (size_t i = 0; i < N_VALID_KEYS; i += 2) {
+        value = i * 3;
+        ck_assert_msg(updateHashTable(ht, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&value, sizeof(value)) >= 0,
+            "updateHashTable failed with key %ld", i);
+    }
+    for (size_t i = 0; i < N_VALID_KEYS; i += 3) {
+        ck_assert_msg(removeHashTable(ht, (uint8_t *)&i, sizeof(i)) >= 0,
+            "removeHashTable failed with key %ld", i);
+    }
+    ck_assert_msg(!compactHashTable(ht), "compactHashTable() failed");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        keyStorage[i] = i;
+        keys[i] = (uint8_t *)&keyStorage[i];
+        nKeys[i] = sizeof(size_t);
+    }
+    ck_assert_msg(getManyHashTable(ht, keys, nKeys, N_VALID_KEYS, kvIndexes)
+        == getCountHashTable(ht), "getManyHashTable() count mismatch");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        if (!(i % 3)) {
+            ck_assert_msg(kvIndexes[i] < 0, "removed key %ld was found", i);
+            continue;
+        }
+        ck_assert_msg(kvIndexes[i] >= 0, "key %ld was not found", i);
+        ck_assert_msg(*(size_t *)getValueByKVIndexHashTable(ht, kvIndexes[i])
+            == (i % 2 ? i : i * 3), "key %ld has the wrong value", i);
+    }
+    deleteHashTable(ht);
+}
+
+START_TEST(testHash64_ManyKeys)
+{
+    checkHash64(HashTableFlags_none);
+    checkHash64(HashTableFlags_incrementalResize);
+    checkHash64(HashTableFlags_openAddressing);
+}
+END_TEST
+
+START_TEST(testOpenAddressing_CheckFields)
+{
+    HashTable *ht;
+
+    ht = newHashTableWithFlags(crc32, capacity, maxLoadFactor,
+        HashTableFlags_openAddressing);
+    ck_assert_msg(ht != NULL, "newHashTableWithFlags() returned NULL");
+    ck_assert_msg(isOpenAddressingHashTable(ht), "flags are invalid");
+    ck_assert_msg(ht->records == NULL, "open addressing table has buckets");
+    ck_assert_msg(getSlotCountHashTable(ht) == nextPow2(capacity),
+        "slot count is not a power of two");
+    deleteHashTable(ht);
+}
+END_TEST
+
+START_TEST(testOpenAddressing_GetStringConstLen)
+{
+    HashTable *ht;
+
+    spawnFlags = HashTableFlags_openAddressing;
+    ht = insertHashTableStringConstLen();
+    checkKV(ht, (const void **)testKeysConstLen, testKeyConstLenSizes,
+        (const void **)testValuesConstLen, testKeyConstLenSizes,
+        LEN(testKeysConstLen));
+    deleteHashTable(ht);
+    spawnFlags = HashTableFlags_none;
+}
+END_TEST
+
+START_TEST(testOpenAddressing_GetStringVarLen)
+{
+    HashTable *ht;
+
+    spawnFlags = HashTableFlags_openAddressing;
+    ht = insertHashTableStringVarLen();
+    checkKV(ht, (const void **)testKeysVarLen, testKeyVarLenSizes,
+        (const void **)testValuesVarLen, testValueVarLenSizes,
+        LEN(testKeysVarLen));
+    deleteHashTable(ht);
+    spawnFlags = HashTableFlags_none;
+}
+END_TEST
+
+START_TEST(testOpenAddressing_GetInt)
+{
+    HashTable *ht;
+
+    spawnFlags = HashTableFlags_openAddressing;
+    ht = insertHashTableInt();
+    checkKVConstKVSize(ht, (const void **)testKeysInt, sizeof(int),
+        (const void **)testValuesInt, sizeof(int), LEN(testKeysInt));
+    deleteHashTable(ht);
+    spawnFlags = HashTableFlags_none;
+}
+END_TEST
+
+START_TEST(testOpenAddressing_ManyKeys)
+{
+    checkManyKeys(HashTableFlags_openAddressing);
+}
+END_TEST
+
+START_TEST(testPackedValues_ManyKeys)
+{
+    HashTable *framed;
+    HashTable *packed;
+    size_t key;
+    uint32_t value;
+    char bigValue[256];
+
+    checkManyKeys(HashTableFlags_packedValues);
+    checkManyKeys(HashTableFlags_packedValues | HashTableFlags_openAddressing);
+    framed = newHashTableWithFlags(crc32, capacity, maxLoadFactor,
+        HashTableFlags_none);
+    packed = newHashTableWithFlags(crc32, capacity, maxLoadFactor,
+        HashTableFlags_packedValues);
+    ck_assert_msg(framed != NULL && packed != NULL,
+        "newHashTableWithFlags() returned NULL");
+    for (size_t i = 0; i < N_VALID_KEYS; i++) {
+        value = i;
+        ck_assert_msg(insertHashTable(framed, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&value, sizeof(value)) >= 0
+            && insertHashTable(packed, (uint8_t *)&i, sizeof(i),
+            (uint8_t *)&value, sizeof(value)) >= 0, "insertHashTable failed");
+        ck_assert_msg((uintptr_t)getValueByKVIndexHashTable(packed, i) % 8
+            == 0, "packed value %ld is not aligned", i);
+    }
+    ck_assert_msg(getSizeVLArray(framed->values)
+        == getSizeVLArray(packed->values), "payload size mismatch");
+    ck_assert_msg(getUsedBytesVLArray(packed->values)
+        < getUsedBytesVLArray(framed->values), "packed values are larger");
+    /* keys are packed in both tables */
+    ck_assert_msg(getUsedBytesVLArray(packed->keys) == N_VALID_KEYS
+        * (sizeof(size_t) + sizeof(VLArrayEntry)), "keys are padded");
+    /* a packed value only grows by moving the pair */
+    memset(bigValue, 'x', sizeof(bigValue));
+    key = 7;
+    ck_assert_msg(updateHashTable(packed, (uint8_t *)&key, sizeof(key),
+        (uint8_t *)bigValue, sizeof(bigValue)) >= N_VALID_KEYS
+        && packed->deadCount == 1, "a grown value was not moved");
+    deleteHashTable(framed);
+    deleteHashTable(packed);
+}
+END_TEST
+
 Suite *
 ht_suite()
 {
@@ -287,6 +814,24 @@ ht_suite()
     tcase_add_test(tcCore, testGetHashTable_StringConstLen);
     tcase_add_test(tcCore, testGetHashTable_StringVarLen);
     tcase_add_test(tcCore, testGetHashTable_Int);
+    tcase_add_test(tcCore, testGetHashTable_ManyKeys);
+    tcase_add_test(tcCore, testGetHashTable_HashRejects);
+    tcase_add_test(tcCore, testGetHashTable_FalsePositives);
+    tcase_add_test(tcCore, testPow2Buckets_ManyKeys);
+    tcase_add_test(tcCore, testPow2Buckets_WeakHash);
+    tcase_add_test(tcCore, testIncrementalResize_ManyKeys);
+    tcase_add_test(tcCore, testIncrementalResize_LookupWhileResizing);
+    tcase_add_test(tcCore, testIncrementalResize_LowLoadFactor);
+    tcase_add_test(tcCore, testRemoveHashTable_ManyKeys);
+    tcase_add_test(tcCore, testUpdateHashTable);
+    tcase_add_test(tcCore, testGetManyHashTable);
+    tcase_add_test(tcCore, testHash64_ManyKeys);
+    tcase_add_test(tcCore, testOpenAddressing_CheckFields);
+    tcase_add_test(tcCore, testOpenAddressing_GetStringConstLen);
+    tcase_add_test(tcCore, testOpenAddressing_GetStringVarLen);
+    tcase_add_test(tcCore, testOpenAddressing_GetInt);
+    tcase_add_test(tcCore, testOpenAddressing_ManyKeys);
+    tcase_add_test(tcCore, testPackedValues_ManyKeys);
     suite_add_tcase(ret, tcCore);
     return ret;
 }
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <stdio.h>
+#include "../src/intern_pool.h"
+#include "../src/utils.h"
+
+#define N_DISTINCT_STRS 1000
+#define N_REPEATS 5
+
+static const char *testStrs[] = {
+    "GET", "POST", "GET", "", "/index.html", "GET", "POST", "200",
+};
+
+START_TEST(testInternStr)
+{
+    InternPool *pool;
+    int ids[LEN(testStrs)];
+
+    pool = newInternPool(-1);
+    ck_assert_msg(pool != NULL, "newInternPool() returned NULL");
+    for (size_t i = 0; i < LEN(testStrs); i++) {
+        ids[i] = internStr(pool, testStrs[i], strlen(testStrs[i]));
+        ck_assert_msg(ids[i] >= 0, "internStr() failed");
+    }
+    /* equal strings have equal ids, and ids are numbered in order */
+    ck_assert_msg(ids[0] == 0 && ids[1] == 1 && ids[2] == 0 && ids[5] == 0
+        && ids[6] == 1 && ids[3] == 2, "ids mismatch");
+    ck_assert_msg(getCountInternPool(pool) == 5, "count mismatch");
+    for (size_t i = 0; i < LEN(testStrs); i++) {
+        ck_assert_msg(getLengthInternPool(pool, ids[i]) == strlen(testStrs[i])
+            && !memcmp(internLookup(pool, ids[i]), testStrs[i],
+            strlen(testStrs[i])), "%s mismatch", testStrs[i]);
+    }
+    /* strings do not need to be null terminated */
+    ck_assert_msg(internStr(pool, "GETTER", 3) == ids[0],
+        "a prefix was not interned as its own string");
+    ck_assert_msg(internFind(pool, "POST", 4) == ids[1]
+        && internFind(pool, "PUT", 3) < 0, "internFind() mismatch");
+    ck_assert_msg(getCountInternPool(pool) == 5,
+        "internFind() added a string");
+    deleteInternPool(pool);
+}
+END_TEST
+
+START_TEST(testInternStr_ManyStrs)
+{
+    InternPool *pool;
+    char str[32];
+    size_t n;
+    size_t nBytes;
+
+    pool = newInternPool(1);
+    ck_assert_msg(pool != NULL, "newInternPool() returned NULL");
+    nBytes = 0;
+    for (int j = 0; j < N_REPEATS; j++) {
+        for (int i = 0; i < N_DISTINCT_STRS; i++) {
+            n = sprintf(str, "str%d", i);
+            nBytes += n;
+            ck_assert_msg(internStr(pool, str, n) == i,
+                "%s has the wrong id", str);
+        }
+    }
+    ck_assert_msg(getCountInternPool(pool) == N_DISTINCT_STRS,
+        "count mismatch");
+    ck_assert_msg(pool->internedBytes == nBytes
+        && getSizeVLArray(pool->strs->keys) == nBytes / N_REPEATS,
+        "byte counts mismatch");
+    for (int i = 0; i < N_DISTINCT_STRS; i++) {
+        n = sprintf(str, "str%d", i);
+        ck_assert_msg(getLengthInternPool(pool, i) == n
+            && !memcmp(internLookup(pool, i), str, n), "%s mismatch", str);
+    }
+    deleteInternPool(pool);
+}
+END_TEST
+
+Suite *
+intern_pool_suite()
+{
+    Suite *ret;
+    TCase *tcCore;
+
+    ret = suite_create("InternPool");
+    tcCore = tcase_create("Core");
+    tcase_add_test(tcCore, testInternStr);
+    tcase_add_test(tcCore, testInternStr_ManyStrs);
+    suite_add_tcase(ret, tcCore);
+    return ret;
+}
+
+int
+main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = intern_pool_suite();
+    sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return !number_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <stdio.h>
+#include "../src/io_sink.h"
+#include "../src/utils.h"
+
+#define N_WRITES 1000000
+#define BIG_WRITE_SIZE (1 << 20)
+
+/* the text that was written to fp */
+static char *
+readBack(FILE *fp, int *outLen)
+{
+    char *ret;
+
+    rewind(fp);
+    ret = readTextFile(fp, outLen);
+    ck_assert_msg(ret != NULL, "readTextFile() failed");
+    return ret;
+}
+
+/* many tiny writes, and a few large ones, in order and in few syscalls */
+START_TEST(testIOSinkFd)
+{
+    IOSink *sink;
+    FILE *fp;
+    char *big;
+    char *expected;
+    char *text;
+    char str[2] = { '0', ',' };
+    size_t n;
+    size_t nWrites;
+    int len;
+
+    fp = tmpfile();
+    ck_assert_msg(fp != NULL, "tmpfile() failed");
+    sink = newFdIOSink(fileno(fp));
+    ck_assert_msg(sink != NULL, "newFdIOSink() returned NULL");
+    big = malloc(BIG_WRITE_SIZE);
+    expected = malloc(N_WRITES * 2 + 3 * BIG_WRITE_SIZE);
+    ck_assert_msg(big != NULL && expected != NULL, "malloc() failed");
+    for (size_t i = 0; i < BIG_WRITE_SIZE; i++)
+        big[i] = 'a' + i % 26;
+    n = 0;
+    for (int i = 0; i < N_WRITES; i++) {
+        str[0] = '0' + i % 10;
+        ck_assert_msg(!writeIOSink(sink, str, 1 + i % 2),
+            "writeIOSink() failed");
+        memcpy(expected + n, str, 1 + i % 2);
+        n += 1 + i % 2;
+    }
+    nWrites = sink->nWrites;
+    ck_assert_msg(nWrites < 100, "%ld writes for tiny fragments", nWrites);
+    ck_assert_msg(!writeRefIOSink(sink, big, BIG_WRITE_SIZE)
+        && !writeIOSink(sink, big, 10) && !writeIOSink(sink, big, 0)
+        && !writeIOSink(sink, big, BIG_WRITE_SIZE),
+        "writing large fragments failed");
+    memcpy(expected + n, big, BIG_WRITE_SIZE);
+    memcpy(expected + n + BIG_WRITE_SIZE, big, 10);
+    memcpy(expected + n + BIG_WRITE_SIZE + 10, big, BIG_WRITE_SIZE);
+    n += 2 * BIG_WRITE_SIZE + 10;
+    ck_assert_msg(!deleteIOSink(sink), "deleteIOSink() failed");
+    text = readBack(fp, &len);
+    ck_assert_msg((size_t)len == n && !memcmp(text, expected, n),
+        "written text mismatch");
+    fclose(fp);
+    free(text);
+    free(expected);
+    free(big);
+}
+END_TEST
+
+/* output written to a FILE before the sink comes first */
+START_TEST(testIOSinkFILE)
+{
+    IOSink *sink;
+    FILE *fp;
+    char *text;
+    int len;
+
+    fp = tmpfile();
+    ck_assert_msg(fp != NULL, "tmpfile() failed");
+    fputs("head,", fp);
+    sink = newFILEIOSink(fp);
+    ck_assert_msg(sink != NULL, "newFILEIOSink() returned NULL");
+    ck_assert_msg(!writeIOSink(sink, "a,", 2)
+        && !writeRefIOSink(sink, "bb,", 3) && !flushIOSink(sink)
+        && !writeIOSink(sink, "ccc", 3), "writing to the sink failed");
+    ck_assert_msg(!deleteIOSink(sink), "deleteIOSink() failed");
+    fputs(",tail", fp);
+    fflush(fp);
+    text = readBack(fp, &len);
+    ck_assert_msg(len == 18 && !memcmp(text, "head,a,bb,ccc,tail", len),
+        "written text mismatch");
+    fclose(fp);
+    free(text);
+}
+END_TEST
+
+Suite *
+io_sink_suite()
+{
+    Suite *ret;
+    TCase *tcCore;
+
+    ret = suite_create("IOSink");
+    tcCore = tcase_create("Core");
+    tcase_add_test(tcCore, testIOSinkFd);
+    tcase_add_test(tcCore, testIOSinkFILE);
+    suite_add_tcase(ret, tcCore);
+    return ret;
+}
+
+int
+main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = io_sink_suite();
+    sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return !number_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -288,6 +288,146 @@ END_TEST
 // START_TEST(testLWSB_deleteLWStringBuilder) { } END_TEST
 // START_TEST(testLWSB_LWStringBuilderPrintInplace) { } END_TEST
 
+/* the cached string is extended as strings are pushed */
+START_TEST(testLWSB_get_string)
+{
+    LWStringBuilder *sb;
+    const char *str;
+    char buf[8];
+    size_t len;
+
+    sb = newLWSB();
+    str = LWStringBuilderGetString(sb, &len);
+    ck_assert_msg(str != NULL && len == 0 && !*str, "empty sb mismatch");
+    for (size_t i = 0; i < LEN(testingData1); i++) {
+        ck_assert_msg(!LWStringBuilderPushStr(sb, testingData1[i]),
+            "LWStringBuilderPushStr() failed");
+        str = LWStringBuilderGetString(sb, &len);
+        ck_assert_msg(str != NULL && len == LWStringBuilderGetSize(sb)
+            && !strncmp(str, testingData1Expect, len) && !str[len],
+            "string mismatch after push %ld", i);
+    }
+    ck_assert_msg(!LWStringBuilderPushStr(sb, "eeeee"),
+        "LWStringBuilderPushStr() failed");
+    str = LWStringBuilderGetString(sb, &len);
+    ck_assert_msg(len == strlen(testingData1Expect) + 5
+        && !strcmp(str + len - 5, "eeeee"), "string mismatch");
+    /* partial writes are null terminated */
+    ck_assert_msg(writeLWStringBuilder(sb, buf, 3) == 3
+        && !strcmp(buf, "abb"), "partial write mismatch");
+    deleteLWStringBuilder(sb);
+}
+END_TEST
+
+/* the pushed strings, and then the cached string, are written to a sink */
+START_TEST(testLWSB_write_sink)
+{
+    LWStringBuilder *sb;
+    IOSink *sink;
+    FILE *fp;
+    char *text;
+    int len;
+
+    sb = newLWSB();
+    for (size_t i = 0; i < LEN(testingData1); i++)
+        ck_assert_msg(!LWStringBuilderPushStr(sb, testingData1[i]),
+            "LWStringBuilderPushStr() failed");
+    fp = tmpfile();
+    ck_assert_msg(fp != NULL, "tmpfile() failed");
+    sink = newFILEIOSink(fp);
+    ck_assert_msg(sink != NULL, "newFILEIOSink() returned NULL");
+    ck_assert_msg(!LWStringBuilderWriteSink(sb, sink)
+        && LWStringBuilderGetString(sb, NULL) != NULL
+        && !LWStringBuilderWriteSink(sb, sink) && !deleteIOSink(sink),
+        "LWStringBuilderWriteSink() failed");
+    rewind(fp);
+    text = readTextFile(fp, &len);
+    ck_assert_msg(text != NULL
+        && (size_t)len == 2 * strlen(testingData1Expect)
+        && !strncmp(text, testingData1Expect, len / 2)
+        && !strncmp(text + len / 2, testingData1Expect, len / 2),
+        "written text mismatch");
+    fclose(fp);
+    free(text);
+    deleteLWStringBuilder(sb);
+}
+END_TEST
+
+/* numbers are formatted like printf() */
+START_TEST(testLWSB_push_numbers)
+{
+    LWStringBuilder *sb;
+    char *str;
+    size_t len;
+
+    sb = newLWSB();
+    ck_assert_msg(!LWStringBuilderPushInt(sb, -42)
+        && !LWStringBuilderPushDouble(sb, 0.1)
+        && !LWStringBuilderPushFmt(sb, "[%03d]", 7)
+        && !LWStringBuilderPushFmt(sb, "%300d", 1)
+        && !LWStringBuilderPushInt(sb, -42), "a formatted push failed");
+    str = LWStringBuilderToString(sb, &len);
+    ck_assert_msg(str != NULL && len == 3 + 3 + 5 + 300 + 3
+        && !strncmp(str, "-420.1[007]  ", 13)
+        && !strcmp(str + len - 4, "1-42"), "string mismatch");
+    free(str);
+    deleteLWStringBuilder(sb);
+}
+END_TEST
+
+/* strings of a given length are pushed whole, even if they contain NULs */
+START_TEST(testLWSB_push_nul)
+{
+    LWStringBuilder *sb;
+    char *str;
+    size_t len;
+
+    sb = newLWSB();
+    ck_assert_msg(!LWStringBuilderPushNStr(sb, "\0ab", 3)
+        && !LWStringBuilderPushNStr(sb, "x", 0)
+        && !LWStringBuilderPushFmt(sb, "%c%s", 0, "cd"),
+        "a push failed");
+    str = LWStringBuilderToString(sb, &len);
+    ck_assert_msg(str != NULL && len == 6 && LWStringBuilderGetSize(sb) == 6
+        && !memcmp(str, "\0ab\0cd", 6), "string mismatch");
+    free(str);
+    deleteLWStringBuilder(sb);
+}
+END_TEST
+
+/* sbs that share a pool store each string once */
+START_TEST(testLWSB_shared_pool)
+{
+    InternPool *pool;
+    LWStringBuilder *sbs[2];
+    char *str;
+    size_t len;
+
+    pool = newInternPool(-1);
+    ck_assert_msg(pool != NULL, "newInternPool() returned NULL");
+    for (size_t i = 0; i < LEN(sbs); i++) {
+        sbs[i] = newLWStringBuilderWithPool(pool);
+        ck_assert_msg(sbs[i] != NULL,
+            "newLWStringBuilderWithPool() returned NULL");
+        for (size_t j = 0; j < LEN(testingData1); j++) {
+            ck_assert_msg(!LWStringBuilderPushStr(sbs[i], testingData1[j]),
+                "LWStringBuilderPushStr() failed");
+        }
+    }
+    ck_assert_msg(getCountInternPool(pool) == LEN(testingData1) - 1,
+        "the strings were stored more than once");
+    for (size_t i = 0; i < LEN(sbs); i++) {
+        str = LWStringBuilderToString(sbs[i], &len);
+        ck_assert_msg(str != NULL, "LWStringBuilderToString() returned NULL");
+        ck_assert_msg(len == strlen(testingData1Expect)
+            && !strcmp(str, testingData1Expect), "string mismatch");
+        free(str);
+        deleteLWStringBuilder(sbs[i]);
+    }
+    deleteInternPool(pool);
+}
+END_TEST
+
 Suite *
 ht_suite()
 {
@@ -307,6 +447,11 @@ ht_suite()
     tcase_add_test(tcCore, testLWSB_testing_data_2_construct_no_outLen);
     tcase_add_test(tcCore, testLWSB_testing_data_3_construct);
     tcase_add_test(tcCore, testLWSB_testing_data_3_construct_no_outLen);
+    tcase_add_test(tcCore, testLWSB_shared_pool);
+    tcase_add_test(tcCore, testLWSB_get_string);
+    tcase_add_test(tcCore, testLWSB_write_sink);
+    tcase_add_test(tcCore, testLWSB_push_numbers);
+    tcase_add_test(tcCore, testLWSB_push_nul);
     suite_add_tcase(ret, tcCore);
     return ret;
 }
@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <stdio.h>
+#include "../src/string_builder.h"
+#include "../src/utils.h"
+
+#define N_PUSHES 100000
+/* larger than any chunk, so it is pushed into a chunk of its own */
+#define BIG_STR_SIZE (3 << 20)
+
+/*
+ * pushes strings and chars of many sizes into sb, and the same bytes into
+ * expected. returns the number of bytes pushed.
+ */
+static size_t
+pushTestData(StringBuilder *sb, char *expected)
+{
+    char str[64];
+    size_t n;
+    size_t ret;
+
+    srand(1);
+    ret = 0;
+    for (int i = 0; i < N_PUSHES; i++) {
+        if (i % 3 == 0) {
+            str[0] = 'a' + i % 26;
+            ck_assert_msg(!stringBuilderPushChar(sb, str[0]),
+                "stringBuilderPushChar() failed");
+            expected[ret++] = str[0];
+            continue;
+        }
+        n = rand() % sizeof(str);
+        for (size_t j = 0; j < n; j++)
+            str[j] = 'A' + rand() % 26;
+        ck_assert_msg(!stringBuilderPushNStr(sb, str, n),
+            "stringBuilderPushNStr() failed");
+        memcpy(expected + ret, str, n);
+        ret += n;
+    }
+    ck_assert_msg(!stringBuilderPushStr(sb, "end"),
+        "stringBuilderPushStr() failed");
+    memcpy(expected + ret, "end", 3);
+    return ret + 3;
+}
+
+START_TEST(testStringBuilderToString)
+{
+    StringBuilder *sb;
+    char *expected;
+    char *str;
+    size_t n;
+    size_t len;
+
+    sb = newStringBuilder();
+    ck_assert_msg(sb != NULL, "newStringBuilder() returned NULL");
+    str = stringBuilderToString(sb, &len);
+    ck_assert_msg(str != NULL && len == 0 && !*str, "empty sb mismatch");
+    free(str);
+    expected = malloc(N_PUSHES * 64 + BIG_STR_SIZE);
+    ck_assert_msg(expected != NULL, "malloc() failed");
+    n = pushTestData(sb, expected);
+    memset(expected + n, 'x', BIG_STR_SIZE);
+    ck_assert_msg(!stringBuilderPushNStr(sb, expected + n, BIG_STR_SIZE),
+        "a big string was not pushed");
+    n += BIG_STR_SIZE;
+    ck_assert_msg(stringBuilderGetSize(sb) == n, "size mismatch");
+    str = stringBuilderToString(sb, &len);
+    ck_assert_msg(str != NULL, "stringBuilderToString() returned NULL");
+    ck_assert_msg(len == n && !memcmp(str, expected, n) && str[n] == '\0',
+        "string mismatch");
+    free(str);
+    free(expected);
+    deleteStringBuilder(sb);
+}
+END_TEST
+
+START_TEST(testStringBuilderWriteFd)
+{
+    StringBuilder *sb;
+    FILE *fp;
+    char *expected;
+    char *text;
+    size_t n;
+    int len;
+
+    sb = newStringBuilder();
+    ck_assert_msg(sb != NULL, "newStringBuilder() returned NULL");
+    expected = malloc(N_PUSHES * 64);
+    ck_assert_msg(expected != NULL, "malloc() failed");
+    n = pushTestData(sb, expected);
+    fp = tmpfile();
+    ck_assert_msg(fp != NULL, "tmpfile() failed");
+    ck_assert_msg(!stringBuilderWriteFd(sb, fileno(fp)),
+        "stringBuilderWriteFd() failed");
+    rewind(fp);
+    text = readTextFile(fp, &len);
+    ck_assert_msg(text != NULL && (size_t)len == n
+        && !memcmp(text, expected, n), "written text mismatch");
+    fclose(fp);
+    free(text);
+    free(expected);
+    deleteStringBuilder(sb);
+}
+END_TEST
+
+/* numbers are formatted like printf(), across chunk boundaries */
+START_TEST(testStringBuilderPushNumbers)
+{
+    StringBuilder *sb;
+    char *expected;
+    char *str;
+    size_t n;
+    size_t len;
+
+    sb = newStringBuilder();
+    ck_assert_msg(sb != NULL, "newStringBuilder() returned NULL");
+    expected = malloc(N_PUSHES * 64);
+    ck_assert_msg(expected != NULL, "malloc() failed");
+    n = 0;
+    for (int i = 0; i < N_PUSHES; i++) {
+        ck_assert_msg(!stringBuilderPushInt(sb, (int64_t)i * -987654321)
+            && !stringBuilderPushDouble(sb, i / 8.0)
+            && !stringBuilderPushFmt(sb, " %s|%5d;", i % 2 ? "x" : "", i),
+            "a formatted push failed");
+        n += sprintf(expected + n, "%lld%.15g %s|%5d;",
+            (long long)i * -987654321, i / 8.0, i % 2 ? "x" : "", i);
+    }
+    ck_assert_msg(!stringBuilderPushFmt(sb, "%s", "")
+        && !stringBuilderPushFmt(sb, "%*d", BIG_STR_SIZE, 1),
+        "a formatted push failed");
+    /* the padded 1 does not fit in the last chunk */
+    n += BIG_STR_SIZE;
+    str = stringBuilderToString(sb, &len);
+    ck_assert_msg(str != NULL, "stringBuilderToString() returned NULL");
+    ck_assert_msg(len == n && !memcmp(str, expected, n - BIG_STR_SIZE)
+        && str[len - 2] == ' ' && str[len - 1] == '1', "string mismatch");
+    free(str);
+    free(expected);
+    deleteStringBuilder(sb);
+}
+END_TEST
+
+Suite *
+sb_suite()
+{
+    Suite *ret;
+    TCase *tcCore;
+
+    ret = suite_create("StringBuilder");
+    tcCore = tcase_create("Core");
+    tcase_add_test(tcCore, testStringBuilderToString);
+    tcase_add_test(tcCore, testStringBuilderWriteFd);
+    tcase_add_test(tcCore, testStringBuilderPushNumbers);
+    suite_add_tcase(ret, tcCore);
+    return ret;
+}
+
+int
+main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = sb_suite();
+    sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return !number_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
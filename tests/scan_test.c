@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <stdio.h>
+#include "../src/scan.h"
+#include "../src/utils.h"
+
+#define N_TEST_BYTES 1024
+
+static uint8_t testBytes[N_TEST_BYTES];
+
+/* byte at a time masks, used as the reference implementation */
+static uint64_t
+matchBytewise(const uint8_t *data, size_t n, uint8_t b)
+{
+    uint64_t ret;
+
+    ret = 0;
+    for (size_t i = 0; i < n; i++)
+        ret |= (uint64_t)(data[i] == b) << i;
+    return ret;
+}
+
+static void
+setupTestValues()
+{
+    static const uint8_t alphabet[] = {
+        ',', '"', '\n', '\r', 'a', '0', 0, 0xff,
+    };
+    uint32_t state;
+
+    /* mostly bytes that are scanned for */
+    state = 12345;
+    for (size_t i = 0; i < N_TEST_BYTES; i++) {
+        state = state * 1103515245 + 12345;
+        testBytes[i] = alphabet[(state >> 16) % LEN(alphabet)];
+    }
+}
+
+START_TEST(testScanBlock)
+{
+    ScanMasks masks;
+    const uint8_t *block;
+
+    printf("scan kernel: %s\n", getKernelNameScan());
+    for (size_t i = 0; i + SCAN_BLOCK_SIZE <= N_TEST_BYTES; i += 7) {
+        block = testBytes + i;
+        scanBlock(block, ',', &masks);
+        ck_assert_msg(masks.delimiters
+            == matchBytewise(block, SCAN_BLOCK_SIZE, ','),
+            "delimiter mask mismatch at offset %ld", i);
+        ck_assert_msg(masks.quotes
+            == matchBytewise(block, SCAN_BLOCK_SIZE, '"'),
+            "quote mask mismatch at offset %ld", i);
+        ck_assert_msg(masks.newlines
+            == matchBytewise(block, SCAN_BLOCK_SIZE, '\n'),
+            "newline mask mismatch at offset %ld", i);
+        ck_assert_msg(masks.returns
+            == matchBytewise(block, SCAN_BLOCK_SIZE, '\r'),
+            "return mask mismatch at offset %ld", i);
+        /* delimiters with the high bit set */
+        scanBlock(block, 0xff, &masks);
+        ck_assert_msg(masks.delimiters
+            == matchBytewise(block, SCAN_BLOCK_SIZE, 0xff),
+            "0xff mask mismatch at offset %ld", i);
+    }
+}
+END_TEST
+
+START_TEST(testScanPartialBlock)
+{
+    ScanMasks masks;
+
+    for (size_t n = 0; n < SCAN_BLOCK_SIZE; n++) {
+        /* the padding must not match a zero delimiter */
+        scanPartialBlock(testBytes, n, 0, &masks);
+        ck_assert_msg(masks.delimiters == matchBytewise(testBytes, n, 0),
+            "delimiter mask mismatch at length %ld", n);
+        ck_assert_msg(masks.quotes == matchBytewise(testBytes, n, '"'),
+            "quote mask mismatch at length %ld", n);
+    }
+}
+END_TEST
+
+START_TEST(testCountByteScan)
+{
+    size_t expected;
+
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t n = 0; n + offset <= N_TEST_BYTES; n += 13) {
+            expected = 0;
+            for (size_t i = 0; i < n; i++)
+                expected += testBytes[offset + i] == ',';
+            ck_assert_msg(countByteScan(testBytes + offset, n, ',')
+                == expected, "count mismatch at offset %ld length %ld",
+                offset, n);
+            ck_assert_msg(charCount(testBytes + offset, n, ',') == expected,
+                "charCount mismatch at offset %ld length %ld", offset, n);
+        }
+    }
+}
+END_TEST
+
+START_TEST(testBitHelpers)
+{
+    for (int i = 0; i < 64; i++) {
+        ck_assert_msg(lowestBitScan((uint64_t)1 << i | (uint64_t)1 << 63)
+            == i, "lowestBitScan mismatch at bit %d", i);
+        ck_assert_msg(popCountScan(~(uint64_t)0 >> i) == 64 - i,
+            "popCountScan mismatch at %d", i);
+    }
+}
+END_TEST
+
+Suite *
+scan_suite()
+{
+    Suite *ret;
+    TCase *tcCore;
+
+    ret = suite_create("Scan");
+    tcCore = tcase_create("Core");
+    tcase_add_test(tcCore, testScanBlock);
+    tcase_add_test(tcCore, testScanPartialBlock);
+    tcase_add_test(tcCore, testCountByteScan);
+    tcase_add_test(tcCore, testBitHelpers);
+    suite_add_tcase(ret, tcCore);
+    return ret;
+}
+
+int
+main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    setupTestValues();
+    s = scan_suite();
+    sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return !number_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,257 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <unistd.h>
+#include "../src/utils.h"
+
+#define N_RANDOM_NUMBERS 100000
+#define TEST_FILE_PATH "utils_test.tmp"
+/* a few times the read block size, and not a multiple of it */
+#define TEST_FILE_SIZE 5000
+
+static const char *testInts[] = {
+    "0", "-0", "+12", "12345678", "123456789", "-9223372036854775808",
+    "9223372036854775807", "00000000000000000000000000042",
+    /* zero padded, close to the limit */
+    "0000000100000000000000000", "00000009223372036854775807",
+    "-0000000000009223372036854775808",
+};
+static const char *testBadInts[] = {
+    "", "-", "+", "1.0", "12a", " 1", "9223372036854775808",
+    "-9223372036854775809", "99999999999999999999",
+    "00000009223372036854775808",
+};
+static const char *testDoubles[] = {
+    "0", "-0.0", "3.14159", "1e10", "1.5e-7", "0.1", ".5", "5.", "+7",
+    "1E+2", "123456789012345678", "9007199254740993", "12345678.87654321",
+    "1234567890123456789012", "2.2250738585072014e-308", "4.9e-324",
+    "1e300", "0.000001", "inf", "0x1p3", "0000000123456789012345.5",
+    "0.00000000123456789012345",
+};
+static const char *testBadDoubles[] = {
+    "", "-", ".", "abc", "1x", "1e", "1e+", " 1", "1 ", "--1",
+};
+
+START_TEST(testParseInt64)
+{
+    int64_t value;
+    char text[32];
+    size_t n;
+    long long expected;
+
+    for (size_t i = 0; i < LEN(testInts); i++) {
+        ck_assert_msg(!parseInt64(testInts[i], strlen(testInts[i]), &value)
+            && value == strtoll(testInts[i], NULL, 10),
+            "%s mismatch", testInts[i]);
+    }
+    for (size_t i = 0; i < LEN(testBadInts); i++) {
+        ck_assert_msg(parseInt64(testBadInts[i], strlen(testBadInts[i]),
+            &value), "%s was accepted", testBadInts[i]);
+    }
+    srand(1);
+    for (int i = 0; i < N_RANDOM_NUMBERS; i++) {
+        expected = ((long long)rand() << 32 ^ rand()) >> rand() % 32;
+        n = sprintf(text, "%lld", i % 2 ? -expected : expected);
+        ck_assert_msg(!parseInt64(text, n, &value)
+            && value == (i % 2 ? -expected : expected), "%s mismatch", text);
+    }
+}
+END_TEST
+
+/* every double is the same as the one strtod() makes */
+START_TEST(testParseDouble)
+{
+    double value;
+    double expected;
+    char text[64];
+    size_t n;
+
+    for (size_t i = 0; i < LEN(testDoubles); i++) {
+        expected = strtod(testDoubles[i], NULL);
+        ck_assert_msg(!parseDouble(testDoubles[i], strlen(testDoubles[i]),
+            &value) && !memcmp(&value, &expected, sizeof(double)),
+            "%s mismatch", testDoubles[i]);
+    }
+    ck_assert_msg(!parseDouble("nan", 3, &value) && isnan(value),
+        "nan mismatch");
+    for (size_t i = 0; i < LEN(testBadDoubles); i++) {
+        ck_assert_msg(parseDouble(testBadDoubles[i],
+            strlen(testBadDoubles[i]), &value), "%s was accepted",
+            testBadDoubles[i]);
+    }
+    srand(1);
+    for (int i = 0; i < N_RANDOM_NUMBERS; i++) {
+        n = sprintf(text, "%.*f", rand() % 8,
+            (rand() - RAND_MAX / 2) / (double)(1 + rand() % 1000));
+        if (i % 3 == 0)
+            n += sprintf(text + n, "e%d", rand() % 60 - 30);
+        expected = strtod(text, NULL);
+        ck_assert_msg(!parseDouble(text, n, &value)
+            && !memcmp(&value, &expected, sizeof(double)), "%s mismatch",
+            text);
+    }
+}
+END_TEST
+
+START_TEST(testFormatNumbers)
+{
+    static const int64_t ints[] = {
+        0, 7, -7, 10, 99, 100, -101, 123456789, INT64_MAX, INT64_MIN,
+    };
+    static const double doubles[] = {
+        0.0, -0.0, 0.1, 1.0 / 3, -2.5, 1e15, 1e16, 123456789012345.0,
+        9007199254740993.0, 2.2250738585072014e-308, 4.9e-324, 1e300,
+        INFINITY, -INFINITY,
+    };
+    char text[FORMAT_DOUBLE_MAX_SIZE + 1];
+    char expected[64];
+    double value;
+    double parsed;
+    size_t n;
+
+    for (size_t i = 0; i < LEN(ints); i++) {
+        n = formatInt64(text, ints[i]);
+        sprintf(expected, "%lld", (long long)ints[i]);
+        ck_assert_msg(n == strlen(expected) && !memcmp(text, expected, n),
+            "%s mismatch", expected);
+    }
+    srand(1);
+    for (int i = 0; i < N_RANDOM_NUMBERS; i++) {
+        value = (rand() - RAND_MAX / 2) / (double)(1 + rand() % 1000)
+            * pow(10, rand() % 40 - 20);
+        if (i < (int)LEN(doubles))
+            value = doubles[i];
+        n = formatDouble(text, value);
+        ck_assert_msg(n <= FORMAT_DOUBLE_MAX_SIZE, "too long");
+        text[n] = '\0';
+        parsed = strtod(text, NULL);
+        ck_assert_msg(!memcmp(&parsed, &value, sizeof(double)),
+            "%.17g was formatted as %s", value, text);
+        /* normal values use the first of %.15g, %.16g and %.17g */
+        sprintf(expected, "%.15g", value);
+        ck_assert_msg(fabs(value) < DBL_MIN || strtod(expected, NULL) != value
+            || !strcmp(text, expected), "%s is not %s", text, expected);
+    }
+    /* subnormals can need fewer than 15 digits */
+    n = formatDouble(text, 4.9406564584124654e-324);
+    ck_assert_msg(n == 6 && !memcmp(text, "5e-324", n), "5e-324 mismatch");
+    n = formatDouble(text, -1.5e-320);
+    ck_assert_msg(n == 9 && !memcmp(text, "-1.5e-320", n),
+        "-1.5e-320 mismatch");
+    n = formatDouble(text, NAN);
+    ck_assert_msg(!parseDouble(text, n, &parsed) && isnan(parsed),
+        "nan mismatch");
+}
+END_TEST
+
+/* writes n bytes of a pattern to fp */
+static void
+writeTestPattern(FILE *fp, size_t n)
+{
+    ck_assert_msg(fp != NULL, "could not make the test file");
+    for (size_t i = 0; i < n; i++)
+        fputc('a' + i % 26, fp);
+    fclose(fp);
+}
+
+/* whether data is the pattern, starting at its first'th byte */
+static int
+isTestPattern(const char *data, size_t n, size_t first)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (data[i] != 'a' + (int)((first + i) % 26))
+            return 0;
+    }
+    return 1;
+}
+
+START_TEST(testMapFile)
+{
+    MappedFile *file;
+
+    writeTestPattern(fopen(TEST_FILE_PATH, "wb"), TEST_FILE_SIZE);
+    file = mapFile(TEST_FILE_PATH, MapFileFlags_sequential);
+    ck_assert_msg(file != NULL, "mapFile() returned NULL");
+    ck_assert_msg(file->size == TEST_FILE_SIZE
+        && isTestPattern(file->data, file->size, 0), "mapped bytes mismatch");
+    unmapFile(file);
+    /* empty files can not be mapped, so they are read */
+    writeTestPattern(fopen(TEST_FILE_PATH, "wb"), 0);
+    file = mapFile(TEST_FILE_PATH, 0);
+    ck_assert_msg(file != NULL && file->size == 0 && !file->isMapped,
+        "empty file mismatch");
+    unmapFile(file);
+    remove(TEST_FILE_PATH);
+    ck_assert_msg(mapFile(TEST_FILE_PATH, 0) == NULL,
+        "a missing file was mapped");
+}
+END_TEST
+
+START_TEST(testReadTextFile)
+{
+    FILE *fp;
+    char *text;
+    int fds[2];
+    int n;
+
+    writeTestPattern(fopen(TEST_FILE_PATH, "wb"), TEST_FILE_SIZE);
+    fp = fopen(TEST_FILE_PATH, "rb");
+    ck_assert_msg(fp != NULL, "could not open the test file");
+    /* the rest of the file after a partial read */
+    fgetc(fp);
+    text = readTextFile(fp, &n);
+    fclose(fp);
+    ck_assert_msg(text != NULL, "readTextFile() returned NULL");
+    ck_assert_msg(n == TEST_FILE_SIZE - 1 && text[n] == '\0'
+        && isTestPattern(text, n, 1), "read text mismatch");
+    free(text);
+    remove(TEST_FILE_PATH);
+    /* a pipe has no size, so the buffer grows as it is read */
+    ck_assert_msg(!pipe(fds), "pipe() failed");
+    writeTestPattern(fdopen(fds[1], "wb"), TEST_FILE_SIZE);
+    fp = fdopen(fds[0], "rb");
+    text = readTextFile(fp, &n);
+    fclose(fp);
+    ck_assert_msg(text != NULL && n == TEST_FILE_SIZE
+        && isTestPattern(text, n, 0), "read pipe mismatch");
+    free(text);
+}
+END_TEST
+
+Suite *
+utils_suite()
+{
+    Suite *ret;
+    TCase *tcCore;
+
+    ret = suite_create("Utils");
+    tcCore = tcase_create("Core");
+    tcase_add_test(tcCore, testParseInt64);
+    tcase_add_test(tcCore, testParseDouble);
+    tcase_add_test(tcCore, testFormatNumbers);
+    tcase_add_test(tcCore, testMapFile);
+    tcase_add_test(tcCore, testReadTextFile);
+    suite_add_tcase(ret, tcCore);
+    return ret;
+}
+
+int
+main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = utils_suite();
+    sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return !number_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}